@@ -110,6 +110,18 @@ namespace math
   }
 
 
+  std::array<glm::vec4, frustum::SIDES_MAX> frustum::planes() const
+  {
+    std::array<glm::vec4, SIDES_MAX> planes;
+
+    for (std::size_t i = 0; i < SIDES_MAX; ++i)
+    {
+      planes[i] = glm::vec4(_planes[i].normal(), _planes[i].distance());
+    }
+
+    return planes;
+  }
+
   bool frustum::intersectsSphere ( const glm::vec3& position
                                  , const float& radius
                                  ) const
@@ -65,5 +65,8 @@ namespace math
     bool intersectsSphere ( const glm::vec3& position
                           , const float& radius
                           ) const;
+
+    //! normal in xyz and distance in w
+    std::array<glm::vec4, SIDES_MAX> planes() const;
   };
 }
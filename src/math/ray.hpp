@@ -27,6 +27,15 @@ namespace math
       return _origin + _direction * distance;
     }
 
+    glm::vec3 const& origin() const
+    {
+      return _origin;
+    }
+    glm::vec3 const& direction() const
+    {
+      return _direction;
+    }
+
   private:
      glm::vec3 _origin;
      glm::vec3 _direction;
@@ -0,0 +1,201 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/triangle_bvh.hpp>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  constexpr std::uint32_t max_triangles_per_leaf = 4;
+
+  glm::vec3 centroid (std::array<glm::vec3, 3> const& triangle)
+  {
+    return (triangle[0] + triangle[1] + triangle[2]) / 3.f;
+  }
+}
+
+namespace math
+{
+  void triangle_bvh::add_triangle (glm::vec3 const& v0, glm::vec3 const& v1, glm::vec3 const& v2)
+  {
+    _triangles.push_back ({v0, v1, v2});
+  }
+
+  void triangle_bvh::build()
+  {
+    _nodes.clear();
+
+    if (_triangles.empty())
+    {
+      return;
+    }
+
+    _nodes.reserve (2 * _triangles.size() / max_triangles_per_leaf + 1);
+    build (0, static_cast<std::uint32_t> (_triangles.size()));
+  }
+
+  std::uint32_t triangle_bvh::build (std::uint32_t first, std::uint32_t count)
+  {
+    std::uint32_t const index (static_cast<std::uint32_t> (_nodes.size()));
+    _nodes.emplace_back();
+
+    glm::vec3 min (std::numeric_limits<float>::max());
+    glm::vec3 max (std::numeric_limits<float>::lowest());
+    glm::vec3 centroid_min (std::numeric_limits<float>::max());
+    glm::vec3 centroid_max (std::numeric_limits<float>::lowest());
+
+    for (std::uint32_t i (first); i < first + count; ++i)
+    {
+      for (auto const& vertex : _triangles[i])
+      {
+        min = glm::min (min, vertex);
+        max = glm::max (max, vertex);
+      }
+
+      glm::vec3 const center (centroid (_triangles[i]));
+      centroid_min = glm::min (centroid_min, center);
+      centroid_max = glm::max (centroid_max, center);
+    }
+
+    _nodes[index].min = min;
+    _nodes[index].max = max;
+
+    glm::vec3 const spread (centroid_max - centroid_min);
+    int const axis (spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2);
+
+    if (count <= max_triangles_per_leaf || spread[axis] <= 0.f)
+    {
+      _nodes[index].first = first;
+      _nodes[index].count = count;
+      return index;
+    }
+
+    // median split along the largest extent of the centroids
+    std::uint32_t const half (count / 2);
+    std::nth_element ( _triangles.begin() + first
+                     , _triangles.begin() + first + half
+                     , _triangles.begin() + first + count
+                     , [axis] (std::array<glm::vec3, 3> const& lhs, std::array<glm::vec3, 3> const& rhs)
+                       {
+                         return centroid (lhs)[axis] < centroid (rhs)[axis];
+                       }
+                     );
+
+    build (first, half);
+    std::uint32_t const right (build (first + half, count - half));
+
+    _nodes[index].first = right;
+    _nodes[index].count = 0;
+
+    return index;
+  }
+
+  void triangle_bvh::intersect (ray const& ray, std::vector<float>* results) const
+  {
+    if (_nodes.empty())
+    {
+      return;
+    }
+
+    std::vector<std::uint32_t> stack (1, 0);
+
+    while (!stack.empty())
+    {
+      node const& current (_nodes[stack.back()]);
+      std::uint32_t const index (stack.back());
+      stack.pop_back();
+
+      if (!ray.intersect_bounds (current.min, current.max))
+      {
+        continue;
+      }
+
+      if (current.count)
+      {
+        for (std::uint32_t i (current.first); i < current.first + current.count; ++i)
+        {
+          if (auto distance = ray.intersect_triangle (_triangles[i][0], _triangles[i][1], _triangles[i][2]))
+          {
+            results->emplace_back (*distance);
+          }
+        }
+      }
+      else
+      {
+        stack.push_back (current.first);
+        stack.push_back (index + 1);
+      }
+    }
+  }
+
+  boost::optional<float> triangle_bvh::intersect_nearest (ray const& ray) const
+  {
+    boost::optional<float> nearest;
+
+    if (_nodes.empty())
+    {
+      return nearest;
+    }
+
+    std::vector<std::pair<float, std::uint32_t>> stack;
+
+    if (auto distance = ray.intersect_bounds (_nodes[0].min, _nodes[0].max))
+    {
+      stack.emplace_back (*distance, 0);
+    }
+
+    while (!stack.empty())
+    {
+      auto const entry (stack.back());
+      stack.pop_back();
+
+      if (nearest && entry.first > *nearest)
+      {
+        continue;
+      }
+
+      node const& current (_nodes[entry.second]);
+
+      if (current.count)
+      {
+        for (std::uint32_t i (current.first); i < current.first + current.count; ++i)
+        {
+          auto distance = ray.intersect_triangle (_triangles[i][0], _triangles[i][1], _triangles[i][2]);
+
+          if (distance && (!nearest || *distance < *nearest))
+          {
+            nearest = distance;
+          }
+        }
+
+        continue;
+      }
+
+      auto left (ray.intersect_bounds (_nodes[entry.second + 1].min, _nodes[entry.second + 1].max));
+      auto right (ray.intersect_bounds (_nodes[current.first].min, _nodes[current.first].max));
+
+      // the nearer child is visited first
+      if (left && right && *left < *right)
+      {
+        stack.emplace_back (*right, current.first);
+        stack.emplace_back (*left, entry.second + 1);
+      }
+      else
+      {
+        if (left)
+        {
+          stack.emplace_back (*left, entry.second + 1);
+        }
+        if (right)
+        {
+          stack.emplace_back (*right, current.first);
+        }
+      }
+    }
+
+    return nearest;
+  }
+}
@@ -0,0 +1,46 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/ray.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace math
+{
+  //! bounding volume hierarchy over a static triangle soup, for ray queries
+  class triangle_bvh
+  {
+  public:
+    void add_triangle (glm::vec3 const& v0, glm::vec3 const& v1, glm::vec3 const& v2);
+    //! to call once every triangle is added, queries before find nothing
+    void build();
+
+    bool empty() const { return _nodes.empty(); }
+
+    //! appends the distance of every triangle hit by the ray
+    void intersect (ray const&, std::vector<float>* results) const;
+    boost::optional<float> intersect_nearest (ray const&) const;
+
+  private:
+    struct node
+    {
+      glm::vec3 min;
+      glm::vec3 max;
+      //! leaf: its triangles are [first, first + count)
+      //! inner node: the left child follows it, the right one is at first
+      std::uint32_t first;
+      std::uint32_t count;
+    };
+
+    std::uint32_t build (std::uint32_t first, std::uint32_t count);
+
+    std::vector<node> _nodes;
+    std::vector<std::array<glm::vec3, 3>> _triangles;
+  };
+}
@@ -7,8 +7,101 @@
 #include <noggit/ContextObject.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <noggit/Log.h>
+#include <noggit/parallel_for.hpp>
+#include <algorithm>
 #include <cstring>
 
+namespace
+{
+  // favor speed, it's done at the end of every action
+  constexpr int compression_level = 1;
+
+  constexpr int alphamap_bytes_size = 64 * 64 + 1;
+
+  template<typename T>
+    QByteArray raw_bytes(T const& data)
+  {
+    return QByteArray(reinterpret_cast<char const*>(&data), sizeof(T));
+  }
+
+  QByteArray alphamap_bytes(std::array<boost::optional<std::array<std::uint8_t, 64 * 64>>, 3> const& alphamaps)
+  {
+    // fixed layout so the layers line up in the xor of two states
+    QByteArray bytes(3 * alphamap_bytes_size, '\0');
+    char* out = bytes.data();
+
+    for (auto const& alphamap : alphamaps)
+    {
+      if (alphamap)
+      {
+        *out = 1;
+        std::memcpy(out + 1, alphamap->data(), 64 * 64);
+      }
+      out += alphamap_bytes_size;
+    }
+
+    return bytes;
+  }
+
+  void xor_bytes(QByteArray& data, QByteArray const& other)
+  {
+    char* out = data.data();
+    char const* in = other.constData();
+
+    for (int i = 0, size = std::min(data.size(), other.size()); i < size; ++i)
+    {
+      out[i] ^= in[i];
+    }
+  }
+
+  noggit::TextureChangeCache texture_change_cache(TextureSet* texture_set)
+  {
+    noggit::TextureChangeCache cache;
+
+    cache.n_textures = texture_set->num();
+    cache.alphamaps = alphamap_bytes(texture_set->applied_alphamaps());
+    std::memcpy(&cache.layers_info, texture_set->getMCLYEntries(), sizeof(ENTRY_MCLY) * 4);
+
+    for (int i = 0; i < cache.n_textures; ++i)
+    {
+      cache.textures.push_back(texture_set->filename(i));
+    }
+
+    return cache;
+  }
+
+  template<typename T>
+    void release(std::vector<T>& data)
+  {
+    std::vector<T>().swap(data);
+  }
+}
+
+noggit::ChunkDataDelta::ChunkDataDelta(QByteArray const& pre, QByteArray const& post)
+: _pre(qCompress(pre, compression_level))
+{
+  QByteArray delta(post);
+  xor_bytes(delta, pre);
+  _delta = qCompress(delta, compression_level);
+}
+
+QByteArray noggit::ChunkDataDelta::data(bool post) const
+{
+  QByteArray pre(qUncompress(_pre));
+
+  if (!post)
+    return pre;
+
+  QByteArray data(qUncompress(_delta));
+  xor_bytes(data, pre);
+  return data;
+}
+
+std::size_t noggit::ChunkDataDelta::memoryUsage() const
+{
+  return sizeof(ChunkDataDelta) + _pre.size() + _delta.size();
+}
+
 
 noggit::Action::Action(MapView* map_view)
 : QObject()
@@ -54,27 +147,47 @@ void noggit::Action::undo(bool redo)
 
   if (_flags & ActionFlags::eCHUNKS_TERRAIN)
   {
-    for (auto& pair : redo ? _chunk_terrain_post : _chunk_terrain_pre)
+    std::vector<MapChunk*> chunks;
+    for (auto& pair : _chunk_terrain)
     {
-      std::memcpy(&pair.first->mVertices, pair.second.data(), 145 * 3 * sizeof(float));
+      QByteArray const data(pair.second.data(redo));
+      std::memcpy(&pair.first->mVertices, data.constData(), 145 * 3 * sizeof(float));
 
       pair.first->registerChunkUpdate(ChunkUpdateFlags::VERTEX);
-
-    }
-    for (auto& pair : redo ? _chunk_terrain_post : _chunk_terrain_pre)
-    {
-      _map_view->getWorld()->recalc_norms(pair.first);
-      pair.first->registerChunkUpdate(ChunkUpdateFlags::NORMALS);
+      chunks.emplace_back(pair.first);
     }
+    _map_view->getWorld()->recalc_norms(chunks);
     _map_view->getWorld()->updateVertexCenter();
   }
   if (_flags & ActionFlags::eCHUNKS_TEXTURE)
   {
-    for (auto& pair : redo ? _chunk_texture_post : _chunk_texture_pre)
+    auto& caches = redo ? _chunk_texture_post : _chunk_texture_pre;
+
+    for (std::size_t i = 0; i < caches.size(); ++i)
     {
+      auto& pair = caches[i];
       auto texture_set = pair.first->getTextureSet();
-      *texture_set->getAlphamaps() = pair.second.alphamaps;
-      *texture_set->getTempAlphamaps() = pair.second.tmp_edit_values;
+
+      QByteArray alphamaps(_chunk_texture_alphamaps[i].data(redo));
+
+      for (int layer = 0; layer < 3; ++layer)
+      {
+        auto& alphamap = (*texture_set->getAlphamaps())[layer];
+        char* layer_data = alphamaps.data() + layer * alphamap_bytes_size;
+
+        if (*layer_data)
+        {
+          alphamap.emplace();
+          alphamap->setAlpha(reinterpret_cast<unsigned char*>(layer_data + 1));
+        }
+        else
+        {
+          alphamap = boost::none;
+        }
+      }
+
+      // the pending edits were applied when the state got saved
+      *texture_set->getTempAlphamaps() = boost::none;
       std::memcpy(texture_set->getMCLYEntries(), &pair.second.layers_info, sizeof(ENTRY_MCLY) * 4);
       texture_set->setNTextures(pair.second.n_textures);
 
@@ -88,14 +201,14 @@ void noggit::Action::undo(bool redo)
       }
 
       texture_set->markDirty();
-      texture_set->apply_alpha_changes();
     }
   }
   if (_flags & ActionFlags::eCHUNKS_VERTEX_COLOR)
   {
-    for (auto& pair : redo ? _chunk_vertex_color_post : _chunk_vertex_color_pre)
+    for (auto& pair : _chunk_vertex_color)
     {
-      std::memcpy(&pair.first->mccv, pair.second.data(), 145 * 3 * sizeof(float));
+      QByteArray const data(pair.second.data(redo));
+      std::memcpy(&pair.first->mccv, data.constData(), 145 * 3 * sizeof(float));
       pair.first->registerChunkUpdate(ChunkUpdateFlags::MCCV);;
     }
   }
@@ -154,6 +267,9 @@ void noggit::Action::undo(bool redo)
       }
     }
     _object_operations = std::move(new_operation_map);
+
+    // the transformed objects may be selected
+    _map_view->getWorld()->update_selection_pivot();
   }
   if (_flags & ActionFlags::eCHUNKS_HOLES)
   {
@@ -194,9 +310,10 @@ void noggit::Action::undo(bool redo)
   }
   if (_flags & ActionFlags::eCHUNK_SHADOWS)
   {
-    for (auto& pair : redo ? _chunk_shadow_map_post : _chunk_shadow_map_pre)
+    for (auto& pair : _chunk_shadow_map)
     {
-      std::memcpy(&pair.first->_shadow_map, pair.second.data(), 64 * 64 * sizeof(uint8_t));
+      QByteArray const data(pair.second.data(redo));
+      std::memcpy(&pair.first->_shadow_map, data.constData(), 64 * 64 * sizeof(uint8_t));
       pair.first->update_shadows();
     }
   }
@@ -358,53 +475,62 @@ unsigned noggit::Action::handleObjectTransformed(unsigned uid, bool redo)
 
 void noggit::Action::finish()
 {
+  // compressing the heavy states is independent for each chunk
   if (_flags & ActionFlags::eCHUNKS_TERRAIN)
   {
-    _chunk_terrain_post.resize(_chunk_terrain_pre.size());
+    _chunk_terrain.resize(_chunk_terrain_pre.size());
 
-    for (int i = 0; i < _chunk_terrain_pre.size(); ++i)
-    {
-      auto& post =_chunk_terrain_post.at(i);
-      auto& pre = _chunk_terrain_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->mVertices, 145 * 3 * sizeof(float));
-    }
+    noggit::parallel_for
+      ( _chunk_terrain_pre.size()
+      , [&] (std::size_t i)
+        {
+          auto& pre = _chunk_terrain_pre[i];
+          _chunk_terrain[i] = std::make_pair
+            (pre.first, ChunkDataDelta(raw_bytes(pre.second), raw_bytes(pre.first->mVertices)));
+        }
+      );
+
+    release(_chunk_terrain_pre);
+    _chunk_terrain_pre_index.clear();
   }
   if (_flags & ActionFlags::eCHUNKS_TEXTURE)
   {
     _chunk_texture_post.reserve(_chunk_texture_pre.size());
 
-    for (int i = 0; i < _chunk_texture_pre.size(); ++i)
+    for (auto& pre : _chunk_texture_pre)
     {
-      auto& pre = _chunk_texture_pre.at(i);
-
-      TextureChangeCache cache;
-      auto texture_set = pre.first->getTextureSet();
-
-      cache.n_textures = texture_set->num();
-      cache.alphamaps = *texture_set->getAlphamaps();
-      cache.tmp_edit_values = *texture_set->getTempAlphamaps();
-      std::memcpy(&cache.layers_info, texture_set->getMCLYEntries(), sizeof(ENTRY_MCLY) * 4);
+      _chunk_texture_post.emplace_back(pre.first, texture_change_cache(pre.first->getTextureSet()));
+    }
 
-      for (int j = 0; j < cache.n_textures; ++j)
-      {
-        cache.textures.push_back(texture_set->filename(j));
-      }
+    _chunk_texture_alphamaps.resize(_chunk_texture_pre.size());
 
-      _chunk_texture_post.emplace_back(std::make_pair(pre.first, std::move(cache)));
-    }
+    noggit::parallel_for
+      ( _chunk_texture_pre.size()
+      , [&] (std::size_t i)
+        {
+          auto& pre = _chunk_texture_pre[i].second.alphamaps;
+          auto& post = _chunk_texture_post[i].second.alphamaps;
+          _chunk_texture_alphamaps[i] = ChunkDataDelta(pre, post);
+          pre = QByteArray();
+          post = QByteArray();
+        }
+      );
   }
   if (_flags & ActionFlags::eCHUNKS_VERTEX_COLOR)
   {
-    _chunk_vertex_color_post.resize(_chunk_vertex_color_pre.size());
+    _chunk_vertex_color.resize(_chunk_vertex_color_pre.size());
 
-    for (int i = 0; i < _chunk_vertex_color_pre.size(); ++i)
-    {
-      auto& post =_chunk_vertex_color_post.at(i);
-      auto& pre = _chunk_vertex_color_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->mccv, 145 * 3 * sizeof(float));
-    }
+    noggit::parallel_for
+      ( _chunk_vertex_color_pre.size()
+      , [&] (std::size_t i)
+        {
+          auto& pre = _chunk_vertex_color_pre[i];
+          _chunk_vertex_color[i] = std::make_pair
+            (pre.first, ChunkDataDelta(raw_bytes(pre.second), raw_bytes(pre.first->mccv)));
+        }
+      );
+
+    release(_chunk_vertex_color_pre);
   }
   if (_flags & ActionFlags::eOBJECTS_TRANSFORMED)
   {
@@ -488,29 +614,84 @@ void noggit::Action::finish()
   }
   if (_flags & ActionFlags::eCHUNK_SHADOWS)
   {
-    _chunk_shadow_map_post.resize(_chunk_shadow_map_pre.size());
+    _chunk_shadow_map.resize(_chunk_shadow_map_pre.size());
 
-    for (int i = 0; i < _chunk_shadow_map_pre.size(); ++i)
-    {
-      auto& post =_chunk_shadow_map_post.at(i);
-      auto& pre = _chunk_shadow_map_pre.at(i);
-      post.first = pre.first;
-      std::memcpy(post.second.data(), &post.first->_shadow_map, 64 * 64 * sizeof(std::uint8_t));
-    }
+    noggit::parallel_for
+      ( _chunk_shadow_map_pre.size()
+      , [&] (std::size_t i)
+        {
+          auto& pre = _chunk_shadow_map_pre[i];
+          _chunk_shadow_map[i] = std::make_pair
+            (pre.first, ChunkDataDelta(raw_bytes(pre.second), raw_bytes(pre.first->_shadow_map)));
+        }
+      );
+
+    release(_chunk_shadow_map_pre);
   }
 
+  _registered_chunks = tsl::robin_map<MapChunk*, unsigned>();
+  computeMemoryUsage();
+
   if (_post)
     (_map_view->*_post)();
 }
 
-float* noggit::Action::getChunkTerrainOriginalData(MapChunk* chunk)
+void noggit::Action::computeMemoryUsage()
 {
-  for (auto& pair : _chunk_terrain_pre)
+  _memory_usage = sizeof(Action);
+
+  for (auto const& deltas : {&_chunk_terrain, &_chunk_vertex_color, &_chunk_shadow_map})
+  {
+    for (auto const& pair : *deltas)
+    {
+      _memory_usage += sizeof(pair.first) + pair.second.memoryUsage();
+    }
+  }
+  for (auto const& delta : _chunk_texture_alphamaps)
+  {
+    _memory_usage += delta.memoryUsage();
+  }
+  for (auto const& caches : {&_chunk_texture_pre, &_chunk_texture_post})
+  {
+    for (auto const& pair : *caches)
+    {
+      _memory_usage += sizeof(pair);
+
+      for (auto const& filename : pair.second.textures)
+      {
+        _memory_usage += sizeof(filename) + filename.capacity();
+      }
+    }
+  }
+  for (auto const& liquids : {&_chunk_liquid_pre, &_chunk_liquid_post})
   {
-    if (pair.first == chunk)
-      return pair.second.data();
+    for (auto const& pair : *liquids)
+    {
+      _memory_usage += sizeof(pair) + pair.second.size() * sizeof(liquid_layer);
+    }
   }
-  return nullptr;
+
+  _memory_usage += (_transformed_objects_pre.size() + _transformed_objects_post.size()
+                   + _removed_objects_pre.size() + _added_objects_pre.size()
+                   ) * sizeof(std::pair<unsigned, ObjectInstanceCache>);
+  _memory_usage += (_chunk_holes_pre.size() + _chunk_holes_post.size()
+                   + _chunk_area_id_pre.size() + _chunk_area_id_post.size()
+                   ) * sizeof(std::pair<MapChunk*, int>);
+  _memory_usage += (_chunk_flags_pre.size() + _chunk_flags_post.size())
+                 * sizeof(std::pair<MapChunk*, mcnk_flags>);
+  _memory_usage += (_vertex_selection_pre.vertices_selected.size()
+                   + _vertex_selection_post.vertices_selected.size()
+                   ) * sizeof(glm::vec3*);
+}
+
+float* noggit::Action::getChunkTerrainOriginalData(MapChunk* chunk)
+{
+  auto const it = _chunk_terrain_pre_index.find(chunk);
+
+  if (it == _chunk_terrain_pre_index.end())
+    return nullptr;
+
+  return _chunk_terrain_pre[it->second].second.data();
 }
 
 void noggit::Action::setDelta(float delta)
@@ -544,18 +725,27 @@ void noggit::Action::setPostCallback(auto(MapView::*method)()->void)
 /* Registrators */
 /* ============ */
 
+bool noggit::Action::registerChunk(MapChunk* chunk, ActionFlags flag)
+{
+  unsigned& registered = _registered_chunks[chunk];
+
+  if (registered & flag)
+    return false;
+
+  registered |= flag;
+  return true;
+}
+
 void noggit::Action::registerChunkTerrainChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_TERRAIN;
 
-  for (auto& pair : _chunk_terrain_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_TERRAIN))
+    return;
 
   std::array<float, 145 * 3> data{};
   std::memcpy(data.data(), &chunk->mVertices, 145 * 3 * sizeof(float));
+  _chunk_terrain_pre_index[chunk] = _chunk_terrain_pre.size();
   _chunk_terrain_pre.emplace_back(std::make_pair(chunk, data));
   //LogDebug << "Chunk: " << chunk->px << "_" << chunk->py << "on tile: " << chunk->mt->index.x << "_" << chunk->mt->index.z << std::endl;
 }
@@ -564,37 +754,18 @@ void noggit::Action::registerChunkTextureChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_TEXTURE;
 
-  for (auto& pair : _chunk_texture_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
-
-  TextureChangeCache cache;
-  auto texture_set = chunk->getTextureSet();
-
-  cache.n_textures = texture_set->num();
-  cache.alphamaps = *texture_set->getAlphamaps();
-  cache.tmp_edit_values = *texture_set->getTempAlphamaps();
-  std::memcpy(&cache.layers_info, texture_set->getMCLYEntries(), sizeof(ENTRY_MCLY) * 4);
-
-  for (int i = 0; i < cache.n_textures; ++i)
-  {
-    cache.textures.push_back(texture_set->filename(i));
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_TEXTURE))
+    return;
 
-  _chunk_texture_pre.emplace_back(std::make_pair(chunk, std::move(cache)));
+  _chunk_texture_pre.emplace_back(chunk, texture_change_cache(chunk->getTextureSet()));
 }
 
 void noggit::Action::registerChunkVertexColorChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_VERTEX_COLOR;
 
-  for (auto& pair : _chunk_vertex_color_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_VERTEX_COLOR))
+    return;
 
   std::array<float, 145 * 3> data{};
   std::memcpy(data.data(), &chunk->mccv, 145 * 3 * sizeof(float));
@@ -653,11 +824,8 @@ void noggit::Action::registerChunkHoleChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_HOLES;
 
-  for (auto& pair : _chunk_holes_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_HOLES))
+    return;
   _chunk_holes_pre.emplace_back(std::make_pair(chunk, chunk->holes));
 }
 
@@ -665,11 +833,8 @@ void noggit::Action::registerChunkAreaIDChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_AREAID;
 
-  for (auto& pair : _chunk_area_id_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_AREAID))
+    return;
   _chunk_area_id_pre.emplace_back(std::make_pair(chunk, chunk->areaID));
 }
 
@@ -677,11 +842,8 @@ void noggit::Action::registerChunkFlagChange(MapChunk *chunk)
 {
   _flags |= ActionFlags::eCHUNKS_FLAGS;
 
-  for (auto& pair : _chunk_flags_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_FLAGS))
+    return;
   _chunk_flags_pre.emplace_back(std::make_pair(chunk, chunk->header_flags));
 }
 
@@ -689,11 +851,8 @@ void noggit::Action::registerChunkLiquidChange(MapChunk* chunk)
 {
   _flags |= ActionFlags::eCHUNKS_WATER;
 
-  for (auto& pair : _chunk_liquid_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNKS_WATER))
+    return;
   _chunk_liquid_pre.emplace_back(std::make_pair(chunk, *chunk->liquid_chunk()->getLayers()));
 }
 
@@ -712,11 +871,8 @@ void noggit::Action::registerChunkShadowChange(MapChunk *chunk)
 {
   _flags |= ActionFlags::eCHUNK_SHADOWS;
 
-  for (auto& pair : _chunk_shadow_map_pre)
-  {
-    if (pair.first == chunk)
-      return;
-  }
+  if (!registerChunk(chunk, ActionFlags::eCHUNK_SHADOWS))
+    return;
 
   std::array<uint8_t , 64 * 64> data;
   std::memcpy(data.data(), &chunk->_shadow_map, 64 * 64 * sizeof(std::uint8_t));
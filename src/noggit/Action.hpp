@@ -16,6 +16,7 @@
 #include <noggit/liquid_layer.hpp>
 #include <noggit/ChunkWater.hpp>
 #include <QObject>
+#include <QByteArray>
 
 class MapView;
 class MapChunk;
@@ -59,11 +60,30 @@ namespace noggit
     {
       size_t n_textures;
       std::vector<std::string> textures;
-      std::array<boost::optional<Alphamap>, 3> alphamaps;
-      boost::optional<tmp_edit_alpha_values> tmp_edit_values;
+      //! the 3 layers with the temporary edit values applied, on the heap
+      //! so they are freed once compressed into a ChunkDataDelta when the
+      //! action is finished
+      QByteArray alphamaps;
       ENTRY_MCLY layers_info[4];
     };
 
+    //! some data of a chunk before and after an action: the former is
+    //! compressed, the latter stored as its compressed xor with the former
+    //! so whatever the action left untouched costs next to nothing
+    class ChunkDataDelta
+    {
+    public:
+      ChunkDataDelta() = default;
+      ChunkDataDelta(QByteArray const& pre, QByteArray const& post);
+
+      QByteArray data(bool post) const;
+      std::size_t memoryUsage() const;
+
+    private:
+      QByteArray _pre;
+      QByteArray _delta;
+    };
+
     struct ObjectInstanceCache
     {
       std::string filename;
@@ -106,6 +126,9 @@ namespace noggit
         bool getTag() { return _tag; };
         void setTag(bool tag) { _tag = tag; };
 
+        //! approximate bytes held by the finished action
+        std::size_t memoryUsage() const { return _memory_usage; };
+
         bool checkAdressTag(std::uintptr_t address) { return std::find(_address_tag.begin(), _address_tag.end(), address) != _address_tag.end(); };
         void tagAdress(std::uintptr_t address) { _address_tag.push_back(address); }
 
@@ -128,6 +151,11 @@ namespace noggit
 
 
     private:
+        //! false if the chunk's data for that flag is already registered
+        bool registerChunk(MapChunk* chunk, ActionFlags flag);
+
+        void computeMemoryUsage();
+
         bool _tag = false;
         std::vector<std::uintptr_t> _address_tag;
 
@@ -136,12 +164,20 @@ namespace noggit
         unsigned _flags;
         unsigned _modality_controls = ActionModalityControllers::eNONE;
         MapView* _map_view;
+
+        //! flags of the data registered for each chunk
+        tsl::robin_map<MapChunk*, unsigned> _registered_chunks;
+        std::size_t _memory_usage = 0;
+
+        // the heavy pre states are only held raw while the action runs
         std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_terrain_pre;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_terrain_post;
+        tsl::robin_map<MapChunk*, std::size_t> _chunk_terrain_pre_index;
+        std::vector<std::pair<MapChunk*, ChunkDataDelta>> _chunk_terrain;
         std::vector<std::pair<MapChunk*, TextureChangeCache>> _chunk_texture_pre;
         std::vector<std::pair<MapChunk*, TextureChangeCache>> _chunk_texture_post;
+        std::vector<ChunkDataDelta> _chunk_texture_alphamaps;
         std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_vertex_color_pre;
-        std::vector<std::pair<MapChunk*, std::array<float, 145 * 3>>> _chunk_vertex_color_post;
+        std::vector<std::pair<MapChunk*, ChunkDataDelta>> _chunk_vertex_color;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _transformed_objects_pre;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _transformed_objects_post;
         std::vector<std::pair<unsigned, ObjectInstanceCache>> _removed_objects_pre;
@@ -159,7 +195,7 @@ namespace noggit
         VertexSelectionCache _vertex_selection_post;
 
         std::vector<std::pair<MapChunk*, std::array<std::uint8_t, 64 * 64>>> _chunk_shadow_map_pre;
-        std::vector<std::pair<MapChunk*, std::array<std::uint8_t, 64 * 64>>> _chunk_shadow_map_post;
+        std::vector<std::pair<MapChunk*, ChunkDataDelta>> _chunk_shadow_map;
 
         bool _vertex_selection_recorded = false;
 
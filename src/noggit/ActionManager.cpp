@@ -2,10 +2,18 @@
 
 #include "ActionManager.hpp"
 #include <noggit/MapView.h>
+#include <QtCore/QSettings>
 #include <cmath>
 
 using namespace noggit;
 
+ActionManager::ActionManager()
+: QObject()
+{
+  QSettings settings;
+  _memory_budget = settings.value("undo_memory_budget_mb", 512).toULongLong() * 1024 * 1024;
+}
+
 std::deque<Action*>* ActionManager::getActionStack()
 {
   return &_action_stack;
@@ -46,6 +54,52 @@ unsigned ActionManager::limit() const
   return _limit;
 }
 
+void ActionManager::setMemoryBudget(std::size_t bytes)
+{
+  _memory_budget = bytes;
+
+  // the undone actions are kept for redo, as is the newest one
+  while (_memory_usage > _memory_budget && _action_stack.size() > _undo_index + 1)
+  {
+    dropOldestAction();
+  }
+
+  emit memoryUsageChanged();
+}
+
+std::size_t ActionManager::memoryBudget() const
+{
+  return _memory_budget;
+}
+
+std::size_t ActionManager::memoryUsage() const
+{
+  return _memory_usage;
+}
+
+void ActionManager::addToHistory(Action* action)
+{
+  _memory_usage += action->memoryUsage();
+
+  // the new action is kept whatever its size
+  while (_memory_usage > _memory_budget && _action_stack.size() > 1)
+  {
+    dropOldestAction();
+  }
+
+  emit addedAction(action);
+  emit memoryUsageChanged();
+}
+
+void ActionManager::dropOldestAction()
+{
+  Action* old_action = _action_stack.front();
+  _memory_usage -= old_action->memoryUsage();
+  delete old_action;
+  _action_stack.pop_front();
+  emit popFront();
+}
+
 void ActionManager::purge()
 {
   for (auto& action : _action_stack)
@@ -54,7 +108,9 @@ void ActionManager::purge()
   }
   _action_stack.clear();
   _undo_index = 0;
+  _memory_usage = 0;
   emit purged();
+  emit memoryUsageChanged();
 }
 
 Action* ActionManager::beginAction(MapView* map_view
@@ -71,6 +127,7 @@ Action* ActionManager::beginAction(MapView* map_view
     {
       for (int i = 0; i < _undo_index; ++i)
       {
+        _memory_usage -= _action_stack.back()->memoryUsage();
         delete _action_stack.back();
         _action_stack.pop_back();
         emit popBack();
@@ -79,12 +136,9 @@ Action* ActionManager::beginAction(MapView* map_view
     }
 
     // prevent undo stack overflow
-    if (_action_stack.size() == _limit)
+    if (_limit && _action_stack.size() >= _limit)
     {
-      Action* old_action = _action_stack.front();
-      delete old_action;
-      _action_stack.pop_front();
-      emit popFront();
+      dropOldestAction();
     }
   }
 
@@ -108,7 +162,7 @@ void ActionManager::endAction()
   _cur_action->finish();
   if (!(_cur_action->getFlags() & eDO_NOT_WRITE_HISTORY))
   {
-    emit addedAction(_cur_action);
+    addToHistory(_cur_action);
   }
   else
   {
@@ -133,7 +187,7 @@ void ActionManager::endActionOnModalityMismatch(unsigned modality_controls)
     _cur_action->finish();
     if (!(_cur_action->getFlags() & eDO_NOT_WRITE_HISTORY))
     {
-      emit addedAction(_cur_action);
+      addToHistory(_cur_action);
     }
     else
     {
@@ -5,6 +5,7 @@
 
 #include <QObject>
 #include <deque>
+#include <cstddef>
 #include <stdexcept>
 #include <noggit/Action.hpp>
 
@@ -39,13 +40,24 @@ namespace noggit
 
         void endActionOnModalityMismatch(unsigned modality_controls);
 
+        //! maximum number of actions kept, 0 for no limit but the memory budget
         void setLimit(unsigned limit);
 
+        //! oldest actions get dropped once the history holds more bytes than that
+        void setMemoryBudget(std::size_t bytes);
+
         void purge();
 
         [[nodiscard]]
         unsigned limit() const;
 
+        [[nodiscard]]
+        std::size_t memoryBudget() const;
+
+        //! approximate bytes held by the finished actions of the history
+        [[nodiscard]]
+        std::size_t memoryUsage() const;
+
         void undo();
         void redo();
 
@@ -59,13 +71,19 @@ namespace noggit
       void currentActionChanged(unsigned index);
       void onActionBegin(Action* action);
       void onActionEnd(Action* action);
+      void memoryUsageChanged();
 
 
     private:
-        ActionManager() : QObject() {}
+        ActionManager();
+
+        void addToHistory(Action* action);
+        void dropOldestAction();
 
         std::deque<Action*> _action_stack;
-        unsigned _limit = 30;
+        unsigned _limit = 0;
+        std::size_t _memory_budget;
+        std::size_t _memory_usage = 0;
         Action* _cur_action = nullptr;
         unsigned _undo_index = 0;
 
@@ -2,10 +2,11 @@
 
 #pragma once
 #include <noggit/MPQ.h>
+#include <noggit/animation_keys.hpp>
 #include <noggit/ModelHeaders.h>
 #include <math/interpolation.hpp>
+#include <algorithm>
 #include <cassert>
-#include <map>
 #include <vector>
 #include <memory>
 #include <glm/gtc/quaternion.hpp>
@@ -56,6 +57,11 @@ namespace Animation
   //! \note AnimatedType is the type of data getting animated.
   //! \note DataType is the type of data stored.
   //! \note The conversion from DataType to AnimatedType is done via Animation::Conversion.
+  //! \note The tracks of all animations are stored one after the other in
+  //! flat arrays, found through a table indexed by the animation id. A
+  //! track remembers the last key it played from, so playback moving forward
+  //! finds its key in constant time and jumps fall back to a binary search.
+  //! A value must not be evaluated from several threads at once.
   template<class AnimatedType, class DataType = AnimatedType>
   class M2Value
   {
@@ -63,8 +69,15 @@ namespace Animation
     typedef uint32_t TimestampType;
     typedef uint32_t AnimationIdType;
 
-    typedef std::vector<AnimatedType> AnimatedTypeVectorType;
-    typedef std::vector<TimestampType> TimestampTypeVectorType;
+    struct Track
+    {
+      uint32_t first_time = 0;
+      uint32_t time_count = 0;
+      uint32_t first_value = 0;
+      uint32_t value_count = 0;
+      //! the key of the last evaluation, relative to first_time
+      mutable uint32_t cursor = 0;
+    };
 
     Animation::Conversion<DataType, AnimatedType> _conversion;
 
@@ -74,25 +87,26 @@ namespace Animation
 
     Animation::Interpolation::Type::Type_t _interpolationType;
 
-    std::map<AnimationIdType, TimestampTypeVectorType> times;
-    std::map<AnimationIdType, AnimatedTypeVectorType> data;
+    std::vector<Track> _tracks;
+    std::vector<TimestampType> _times;
+    std::vector<AnimatedType> _values;
 
-    // for nonlinear interpolations:
-    std::map<AnimationIdType, AnimatedTypeVectorType> in;
-    std::map<AnimationIdType, AnimatedTypeVectorType> out;
+    // for nonlinear interpolations, in the same order as _values:
+    std::vector<AnimatedType> _in;
+    std::vector<AnimatedType> _out;
 
   public:
-    bool uses(AnimationIdType anim)
+    bool uses(AnimationIdType anim) const
     {
       if (_globalSequenceID != NO_GLOBAL_SEQUENCE)
       {
         anim = AnimationIdType();
       }
 
-      return !data[anim].empty();
+      return anim < _tracks.size() && _tracks[anim].value_count;
     }
 
-    AnimatedType getValue (AnimationIdType anim, TimestampType time, int animtime)
+    AnimatedType getValue (AnimationIdType anim, TimestampType time, int animtime) const
     {
       if (_globalSequenceID != NO_GLOBAL_SEQUENCE)
       {
@@ -107,68 +121,54 @@ namespace Animation
         anim = AnimationIdType();
       }
 
-      TimestampTypeVectorType& timestampVector = times[anim];
-      AnimatedTypeVectorType& dataVector = data[anim];
-      AnimatedTypeVectorType& inVector = in[anim];
-      AnimatedTypeVectorType& outVector = out[anim];
-
-      if (dataVector.empty())
+      if (anim >= _tracks.size() || !_tracks[anim].value_count)
       {
         return AnimatedType();
       }
 
-      AnimatedType result = dataVector[0];
+      Track const& track = _tracks[anim];
+      AnimatedType const* values = &_values[track.first_value];
 
-      if (!timestampVector.empty())
+      if (!track.time_count)
       {
-        TimestampType max_time = timestampVector.back();
-        if (max_time > 0)
-        {
-          time %= max_time;
-        }
-        else
-        {
-          time = TimestampType();
-        }
+        return values[0];
+      }
 
-        size_t pos = 0;
-        for (size_t i = 0; i < timestampVector.size() - 1; ++i)
-        {
-          if (time >= timestampVector[i] && time < timestampVector[i + 1])
-          {
-            pos = i;
-            break;
-          }
-        }
+      TimestampType const* times = &_times[track.first_time];
 
-        if (pos == timestampVector.size() - 1 || _interpolationType == Animation::Interpolation::Type::NONE)
-        {
-          result = dataVector[pos];
-        }
-        else
-        {
-          TimestampType t1 = timestampVector[pos];
-          TimestampType t2 = timestampVector[pos + 1];
-          const float percentage = (time - t1) / static_cast<float>(t2 - t1);
+      TimestampType max_time = times[track.time_count - 1];
+      if (max_time > 0)
+      {
+        time %= max_time;
+      }
+      else
+      {
+        time = TimestampType();
+      }
 
-          switch (_interpolationType)
-          {
-          case Animation::Interpolation::Type::LINEAR:
-          {
-            result = math::interpolation::linear (percentage, dataVector[pos], dataVector[pos + 1]);
-          }
-            break;
+      size_t const pos = Animation::find_key (times, track.time_count, time, track.cursor);
 
-          case Animation::Interpolation::Type::HERMITE:
-          {
-            result = math::interpolation::hermite(percentage, dataVector[pos], dataVector[pos + 1], inVector[pos], outVector[pos]);
-          }
-            break;
-          }
-        }
+      if (pos == track.time_count - 1 || _interpolationType == Animation::Interpolation::Type::NONE)
+      {
+        return values[pos];
       }
 
-      return result;
+      TimestampType t1 = times[pos];
+      TimestampType t2 = times[pos + 1];
+      const float percentage = (time - t1) / static_cast<float>(t2 - t1);
+
+      switch (_interpolationType)
+      {
+      case Animation::Interpolation::Type::LINEAR:
+        return math::interpolation::linear (percentage, values[pos], values[pos + 1]);
+
+      case Animation::Interpolation::Type::HERMITE:
+        return math::interpolation::hermite ( percentage, values[pos], values[pos + 1]
+                                            , _in[track.first_value + pos], _out[track.first_value + pos]
+                                            );
+      }
+
+      return values[0];
     }
 
     //! \todo Use a vector of MPQFile& for the anim files instead for safety.
@@ -188,16 +188,36 @@ namespace Animation
       const AnimationBlockHeader* timestampHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsTimes);
       const AnimationBlockHeader* keyHeaders = file.get<AnimationBlockHeader>(animationBlock.ofsKeys);
 
+      _tracks.resize (std::max (animationBlock.nTimes, animationBlock.nKeys));
+
+      size_t time_count = 0;
+      size_t value_count = 0;
+      for (size_t j = 0; j < animationBlock.nTimes; ++j)
+      {
+        time_count += timestampHeaders[j].nEntries;
+      }
+      for (size_t j = 0; j < animationBlock.nKeys; ++j)
+      {
+        value_count += keyHeaders[j].nEntries;
+      }
+
+      _times.reserve (time_count);
+      _values.reserve (value_count);
+      if (_interpolationType == Animation::Interpolation::Type::HERMITE)
+      {
+        _in.reserve (value_count);
+        _out.reserve (value_count);
+      }
+
       for (size_t j = 0; j < animationBlock.nTimes; ++j)
       {
         const TimestampType* timestamps = j < animation_files.size() && animation_files[j] ?
           animation_files[j]->get<TimestampType>(timestampHeaders[j].ofsEntries) :
           file.get<TimestampType>(timestampHeaders[j].ofsEntries);
 
-        for (size_t i = 0; i < timestampHeaders[j].nEntries; ++i)
-        {
-          times[j].push_back(timestamps[i]);
-        }
+        _tracks[j].first_time = static_cast<uint32_t> (_times.size());
+        _tracks[j].time_count = timestampHeaders[j].nEntries;
+        _times.insert (_times.end(), timestamps, timestamps + timestampHeaders[j].nEntries);
       }
 
       for (size_t j = 0; j < animationBlock.nKeys; ++j)
@@ -206,23 +226,27 @@ namespace Animation
           animation_files[j]->get<DataType>(keyHeaders[j].ofsEntries) :
           file.get<DataType>(keyHeaders[j].ofsEntries);
 
+        _tracks[j].first_value = static_cast<uint32_t> (_values.size());
+
         switch (_interpolationType)
         {
         case Animation::Interpolation::Type::NONE:
         case Animation::Interpolation::Type::LINEAR:
           for (size_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i]));
+            _values.push_back(_conversion(keys[i]));
           }
+          _tracks[j].value_count = keyHeaders[j].nEntries;
           break;
 
         case Animation::Interpolation::Type::HERMITE:
           for (size_t i = 0; i < keyHeaders[j].nEntries; ++i)
           {
-            data[j].push_back(_conversion(keys[i * 3]));
-            in[j].push_back(_conversion(keys[i * 3 + 1]));
-            out[j].push_back(_conversion(keys[i * 3 + 2]));
+            _values.push_back(_conversion(keys[i * 3]));
+            _in.push_back(_conversion(keys[i * 3 + 1]));
+            _out.push_back(_conversion(keys[i * 3 + 2]));
           }
+          _tracks[j].value_count = keyHeaders[j].nEntries;
           break;
         }
       }
@@ -230,30 +254,17 @@ namespace Animation
 
     void apply(AnimatedType function(const AnimatedType))
     {
-      switch (_interpolationType)
+      for (auto& value : _values)
       {
-      case Animation::Interpolation::Type::NONE:
-      case Animation::Interpolation::Type::LINEAR:
-        for (size_t i = 0; i < data.size(); ++i)
-        {
-          for (size_t j = 0; j < data[i].size(); ++j)
-          {
-            data[i][j] = function(data[i][j]);
-          }
-        }
-        break;
-
-      case Animation::Interpolation::Type::HERMITE:
-        for (size_t i = 0; i < data.size(); ++i)
-        {
-          for (size_t j = 0; j < data[i].size(); ++j)
-          {
-            data[i][j] = function(data[i][j]);
-            in[i][j] = function(in[i][j]);
-            out[i][j] = function(out[i][j]);
-          }
-        }
-        break;
+        value = function(value);
+      }
+      for (auto& value : _in)
+      {
+        value = function(value);
+      }
+      for (auto& value : _out)
+      {
+        value = function(value);
       }
     }
   };
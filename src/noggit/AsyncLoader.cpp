@@ -8,59 +8,77 @@
 #include <algorithm>
 #include <list>
 
+namespace
+{
+  thread_local AsyncLoader const* current_loader = nullptr;
+  thread_local std::size_t current_worker = 0;
+
+  int loader_thread_count()
+  {
+    QSettings settings;
+    int const configured = settings.value("async_loader_threads", 0).toInt();
+
+    if (configured > 0)
+    {
+      return configured;
+    }
+
+    return std::max (2, static_cast<int> (std::thread::hardware_concurrency()) - 1);
+  }
+}
+
+AsyncLoader& AsyncLoader::instance()
+{
+  static AsyncLoader async_loader(loader_thread_count());
+  return async_loader;
+}
+
 bool AsyncLoader::is_loading()
 {
-  std::lock_guard<std::mutex> const lock (_guard);
-  return !_currently_loading.empty();
+  return _loading.load() > 0;
 }
 
-void AsyncLoader::process()
+void AsyncLoader::process (std::size_t worker)
 {
-  AsyncObject* object = nullptr;
+  current_loader = this;
+  current_worker = worker;
 
   QSettings settings;
   bool additional_log = settings.value("additional_file_loading_log", false).toBool();
 
   while (!_stop)
   {
-    {    
-      std::unique_lock<std::mutex> lock (_guard);
+    ticket_ptr const ticket (take (worker));
+
+    if (!ticket)
+    {
+      std::unique_lock<std::mutex> lock (_pending_guard);
 
-      _state_changed.wait 
+      _work_available.wait
       ( lock
       , [&]
         {
-          return !!_stop || std::any_of ( _to_load.begin(), _to_load.end()
-                                        , [](auto const& to_load) { return !to_load.empty(); }
-                                        );
+          return !!_stop || _pending.load() > 0;
         }
       );
 
-      if (_stop)
-      {
-        return;
-      }
-
-      for (auto& to_load : _to_load)
-      {
-        if (to_load.empty())
-        {
-          continue;
-        }
-
-        object = to_load.front();
-        _currently_loading.emplace_back (object);
-        to_load.pop_front();
+      continue;
+    }
 
-        break;
-      }
+    // skip entries of objects cancelled, loaded by another entry or re-prioritized
+    int expected = async_load_ticket::queued;
+    if (!ticket->state.compare_exchange_strong (expected, async_load_ticket::loading))
+    {
+      continue;
     }
 
+    AsyncObject* object = ticket->object;
+    ++_loading;
+
     try
     {
       if (additional_log)
       {
-        std::lock_guard<std::mutex> const lock(_guard);
         LogDebug << "Loading '" << object->filename << "'" << std::endl;
       }
 
@@ -68,59 +86,140 @@ void AsyncLoader::process()
 
       if (additional_log)
       {
-        std::lock_guard<std::mutex> const lock(_guard);
         LogDebug << "Loaded  '" << object->filename << "'" << std::endl;
       }
-
-      {
-        std::lock_guard<std::mutex> const lock (_guard);
-        _currently_loading.remove (object);
-        _state_changed.notify_all();
-      }
     }
     catch (...)
     {
-      std::lock_guard<std::mutex> const lock(_guard);
-
       object->error_on_loading();
 
       if (object->is_required_when_saving())
       {
         _important_object_failed_loading = true;
       }
+    }
 
-      _currently_loading.remove(object);
+    {
+      std::lock_guard<std::mutex> const lock (_loaded_guard);
+      ticket->priority = static_cast<int> (async_priority::count);
+      ticket->state = async_load_ticket::idle;
+      --_loading;
     }
+    _loaded.notify_all();
   }
 }
 
-void AsyncLoader::queue_for_load (AsyncObject* object)
+void AsyncLoader::push (ticket_ptr ticket, async_priority priority)
 {
-  std::lock_guard<std::mutex> const lock (_guard);
-  _to_load[(size_t)object->loading_priority()].push_back (object);
-  _state_changed.notify_one();
+  std::size_t const queue = current_loader == this
+                          ? current_worker
+                          : _next_queue++ % _queues.size();
+
+  // count it before it becomes visible so take() never underflows _pending
+  {
+    std::lock_guard<std::mutex> const lock (_pending_guard);
+    ++_pending;
+  }
+
+  {
+    std::lock_guard<std::mutex> const lock (_queues[queue]->guard);
+    _queues[queue]->to_load[(size_t)priority].emplace_back (std::move (ticket));
+  }
+
+  _work_available.notify_one();
 }
 
-void AsyncLoader::ensure_deletable (AsyncObject* object)
+AsyncLoader::ticket_ptr AsyncLoader::take (std::size_t worker)
 {
-  std::unique_lock<std::mutex> lock (_guard);
-  _state_changed.wait
-  ( lock
-  , [&]
+  for (std::size_t priority = 0; priority < (size_t)async_priority::count; ++priority)
+  {
+    for (std::size_t i = 0; i < _queues.size(); ++i)
     {
-      auto& to_load = _to_load[(size_t)object->loading_priority()];
-      auto const& it = std::find (to_load.begin(), to_load.end(), object);
-      
-      // don't load it if it's just to delete it afterward
-      if (it != to_load.end())
+      bool const own = i == 0;
+      auto& queue = *_queues[(worker + i) % _queues.size()];
+
+      std::lock_guard<std::mutex> const lock (queue.guard);
+      auto& to_load = queue.to_load[priority];
+
+      if (to_load.empty())
+      {
+        continue;
+      }
+
+      ticket_ptr ticket;
+      if (own)
       {
-        to_load.erase(it);
-        return true;
+        ticket = std::move (to_load.front());
+        to_load.pop_front();
       }
       else
       {
-        return std::find (_currently_loading.begin(), _currently_loading.end(), object) == _currently_loading.end();
+        ticket = std::move (to_load.back());
+        to_load.pop_back();
       }
+
+      --_pending;
+      return ticket;
+    }
+  }
+
+  return nullptr;
+}
+
+void AsyncLoader::queue_for_load (AsyncObject* object)
+{
+  auto const& ticket = object->_load_ticket;
+
+  int expected = async_load_ticket::idle;
+  if (!ticket->state.compare_exchange_strong (expected, async_load_ticket::queued))
+  {
+    // already queued or being loaded
+    return;
+  }
+
+  async_priority const priority = object->loading_priority();
+  ticket->priority = static_cast<int> (priority);
+  push (ticket, priority);
+}
+
+void AsyncLoader::prioritize (AsyncObject* object, async_priority priority)
+{
+  auto const& ticket = object->_load_ticket;
+
+  if (ticket->state.load() != async_load_ticket::queued)
+  {
+    return;
+  }
+
+  // queue it once more, whichever entry comes first loads it
+  int current = ticket->priority.load();
+  while (static_cast<int> (priority) < current)
+  {
+    if (ticket->priority.compare_exchange_weak (current, static_cast<int> (priority)))
+    {
+      push (ticket, priority);
+      return;
+    }
+  }
+}
+
+void AsyncLoader::ensure_deletable (AsyncObject* object)
+{
+  auto& state = object->_load_ticket->state;
+
+  // don't load it if it's just to delete it afterward
+  int expected = async_load_ticket::queued;
+  if (state.compare_exchange_strong (expected, async_load_ticket::cancelled))
+  {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock (_loaded_guard);
+  _loaded.wait
+  ( lock
+  , [&]
+    {
+      return state.load() != async_load_ticket::loading;
     }
   );
 }
@@ -128,16 +227,26 @@ void AsyncLoader::ensure_deletable (AsyncObject* object)
 AsyncLoader::AsyncLoader(int numThreads)
   : _stop (false)
 {
+  numThreads = std::max (1, numThreads);
+
   for (int i = 0; i < numThreads; ++i)
   {
-    _threads.emplace_back (&AsyncLoader::process, this);
+    _queues.emplace_back (std::make_unique<worker_queue>());
+  }
+
+  for (int i = 0; i < numThreads; ++i)
+  {
+    _threads.emplace_back (&AsyncLoader::process, this, static_cast<std::size_t> (i));
   }
 }
 
 AsyncLoader::~AsyncLoader()
 {
-  _stop = true;
-  _state_changed.notify_all();
+  {
+    std::lock_guard<std::mutex> const lock (_pending_guard);
+    _stop = true;
+  }
+  _work_available.notify_all();
 
   for (auto& thread : _threads)
   {
@@ -7,25 +7,31 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 class AsyncLoader
 {
 public:
-  static AsyncLoader& instance()
-  {
-    static AsyncLoader async_loader(2);
-    return async_loader;
-  }
+  //! sized by the "async_loader_threads" setting, 0 picks one thread per
+  //! core minus the one used for rendering
+  static AsyncLoader& instance();
 
-  //! Ownership is _not_ transferred. Call ensure_deletable to ensure 
+  //! Ownership is _not_ transferred. Call ensure_deletable to ensure
   //! that a previously enqueued object can be destroyed.
   void queue_for_load (AsyncObject*);
-  
+
   void ensure_deletable (AsyncObject*);
 
+  //! moves a queued object up to the given priority, eg. because it is
+  //! close to the camera. does nothing if it is loading or loaded already.
+  void prioritize (AsyncObject*, async_priority);
+
   bool is_loading();
 
   AsyncLoader(int numThreads);
@@ -35,13 +41,33 @@ public:
   void reset_object_fail() { _important_object_failed_loading = false; }
 
 private:
-  void process();
+  using ticket_ptr = std::shared_ptr<async_load_ticket>;
+
+  //! each thread prefers its own queue and steals from the others when
+  //! it runs dry, always taking the most important work available
+  struct worker_queue
+  {
+    std::mutex guard;
+    std::array<std::deque<ticket_ptr>, (size_t)async_priority::count> to_load;
+  };
+
+  void process (std::size_t worker);
+  void push (ticket_ptr, async_priority);
+  ticket_ptr take (std::size_t worker);
 
-  std::mutex _guard;
-  std::condition_variable _state_changed;
   std::atomic<bool> _stop;
-  std::array<std::list<AsyncObject*>, (size_t)async_priority::count> _to_load;
-  std::list<AsyncObject*> _currently_loading;
+  std::vector<std::unique_ptr<worker_queue>> _queues;
+  std::atomic<std::size_t> _next_queue = {0};
+
+  //! entries in _queues, including stale ones not yet skipped
+  std::atomic<std::size_t> _pending = {0};
+  std::mutex _pending_guard;
+  std::condition_variable _work_available;
+
+  std::atomic<std::size_t> _loading = {0};
+  std::mutex _loaded_guard;
+  std::condition_variable _loaded;
+
   std::list<std::thread> _threads;
-  bool _important_object_failed_loading = false;
+  std::atomic<bool> _important_object_failed_loading = {false};
 };
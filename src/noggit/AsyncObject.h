@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -17,10 +18,36 @@ enum class async_priority : int
   count
 };
 
+class AsyncObject;
+
+//! shared between an object and the loader queues, so that queue entries
+//! of cancelled or already loaded objects can be skipped without touching
+//! the (possibly deleted) object itself
+struct async_load_ticket
+{
+  enum state : int
+  {
+    idle,
+    queued,
+    loading,
+    cancelled
+  };
+
+  async_load_ticket (AsyncObject* object_) : object (object_) {}
+
+  AsyncObject* const object;
+  std::atomic<int> state = {idle};
+  //! highest priority the object has been queued with, see AsyncLoader::prioritize
+  std::atomic<int> priority = {static_cast<int> (async_priority::count)};
+};
+
 class AsyncObject
 {
 private: 
   bool _loading_failed = false;
+  std::shared_ptr<async_load_ticket> const _load_ticket = std::make_shared<async_load_ticket> (this);
+
+  friend class AsyncLoader;
 protected:
   std::atomic<bool> finished = {false};
   std::mutex _mutex;
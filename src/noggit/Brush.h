@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 class Brush
 {
 private:
@@ -16,5 +18,7 @@ public:
   float getHardness() const;
   float getRadius() const;
   float getValue(float dist) const;
+  //! getValue for count distances at once
+  void getValues(float const* dists, float* values, std::size_t count) const;
   void init();
 };
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <noggit/ChunkWater.hpp>
+#include <noggit/chunk_writer.hpp>
 #include <noggit/TileWater.hpp>
 #include <noggit/liquid_layer.hpp>
 #include <noggit/MPQ.h>
@@ -114,7 +115,40 @@ void ChunkWater::fromFile(MPQFile &f, size_t basePos)
 }
 
 
-void ChunkWater::save(sExtendableArray& adt, int base_pos, int& header_pos, int& current_pos)
+std::size_t ChunkWater::save_size()
+{
+  // remove empty layers
+  cleanup();
+
+  if (!hasData(0))
+  {
+    return 0;
+  }
+
+  std::size_t size = sizeof(MH2O_Render) + sizeof(MH2O_Information) * _layers.size();
+
+  for (liquid_layer const& layer : _layers)
+  {
+    size += layer.save_size();
+  }
+
+  return size;
+}
+
+std::size_t ChunkWater::memory_usage() const
+{
+  std::size_t usage = sizeof(ChunkWater)
+    + (_layers.capacity() - _layers.size()) * sizeof(liquid_layer);
+
+  for (liquid_layer const& layer : _layers)
+  {
+    usage += layer.memory_usage();
+  }
+
+  return usage;
+}
+
+void ChunkWater::save(noggit::chunk_writer& adt, std::size_t base_pos, std::size_t& header_pos)
 {
   MH2O_Header header;
 
@@ -124,25 +158,19 @@ void ChunkWater::save(sExtendableArray& adt, int base_pos, int& header_pos, int&
   if (hasData(0))
   {
     header.nLayers = _layers.size();
-    header.ofsRenderMask = current_pos - base_pos;
-    adt.Insert(current_pos, sizeof(MH2O_Render), reinterpret_cast<char*>(&Render));
-    current_pos += sizeof(MH2O_Render);
-
-    header.ofsInformation = current_pos - base_pos;
-    int info_pos = current_pos;
-
-    std::size_t info_size = sizeof(MH2O_Information) * _layers.size();
-    current_pos += info_size;
+    header.ofsRenderMask = adt.position() - base_pos;
+    adt.write(Render);
 
-    adt.Extend(info_size);
+    header.ofsInformation = adt.position() - base_pos;
+    std::size_t info_pos = adt.skip(sizeof(MH2O_Information) * _layers.size());
 
     for (liquid_layer& layer : _layers)
     {
-      layer.save(adt, base_pos, info_pos, current_pos);
+      layer.save(adt, base_pos, info_pos);
     }
   }
 
-  memcpy(adt.GetPointer<char>(header_pos), &header, sizeof(MH2O_Header));
+  *adt.at<MH2O_Header>(header_pos) = header;
   header_pos += sizeof(MH2O_Header);
 }
 
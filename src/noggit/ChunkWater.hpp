@@ -9,10 +9,14 @@
 #include <set>
 
 class MPQFile;
-class sExtendableArray;
 class MapChunk;
 class TileWater;
 
+namespace noggit
+{
+  class chunk_writer;
+}
+
 class ChunkWater
 {
 public:
@@ -26,7 +30,11 @@ public:
 
   void from_mclq(std::vector<mclq>& layers);
   void fromFile(MPQFile &f, size_t basePos);
-  void save(sExtendableArray& adt, int base_pos, int& header_pos, int& current_pos);
+  //! removes the empty layers, save() writes this many bytes after the header
+  std::size_t save_size();
+  void save(noggit::chunk_writer& adt, std::size_t base_pos, std::size_t& header_pos);
+
+  std::size_t memory_usage() const;
 
   bool is_visible ( const float& cull_distance
                   , const math::frustum& frustum
@@ -84,6 +84,8 @@ void DBCFile::save()
   stream.write(reinterpret_cast<char*>(data.data()), data.size());
   stream.write(stringTable.data(), stringSize);
   stream.close();
+
+  MPQFile::project_file_created (filename);
 }
 
 DBCFile::Record DBCFile::addRecord(size_t id, size_t id_field)
@@ -2,21 +2,383 @@
 
 #include <noggit/Log.h>
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstring>
-#include <ctime>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<int> gLogMinimumSeverity = {static_cast<int>(LogSeverity::Debug)};
+
+namespace
+{
+  struct RecordHeader
+  {
+    std::uint64_t time;
+    const char* file;
+    int line;
+    LogSeverity severity;
+    std::size_t size;
+  };
+
+  //! written by its thread only and read by the writer only, so neither
+  //! side needs a lock. records which do not fit anymore are dropped
+  class RecordBuffer
+  {
+  public:
+    static constexpr std::size_t capacity = 1 << 16;
+
+    //! returns whether the buffer is getting full
+    bool push(RecordHeader const& header, const char* text)
+    {
+      std::size_t const head = _head.load(std::memory_order_relaxed);
+      std::size_t const size = sizeof(header) + header.size;
+
+      if (size > capacity - (head - _tail.load(std::memory_order_acquire)))
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      copy_in(head, &header, sizeof(header));
+      copy_in(head + sizeof(header), text, header.size);
+      _head.store(head + size, std::memory_order_release);
+
+      return head + size - _tail.load(std::memory_order_relaxed) > capacity / 2;
+    }
+
+    template<typename Fun>
+      void drain(std::string& text, Fun&& fun)
+    {
+      std::size_t tail = _tail.load(std::memory_order_relaxed);
+      std::size_t const head = _head.load(std::memory_order_acquire);
+
+      while (tail != head)
+      {
+        RecordHeader header;
+        copy_out(tail, &header, sizeof(header));
+        text.resize(header.size);
+        copy_out(tail + sizeof(header), &text[0], header.size);
+
+        tail += sizeof(header) + header.size;
+        _tail.store(tail, std::memory_order_release);
+
+        fun(header, text);
+      }
+    }
+
+    bool empty() const
+    {
+      return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t take_dropped()
+    {
+      return _dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+  private:
+    void copy_in(std::size_t position, const void* data, std::size_t size)
+    {
+      std::size_t const offset = position % capacity;
+      std::size_t const first = std::min(size, capacity - offset);
+      std::memcpy(&_data[offset], data, first);
+      std::memcpy(&_data[0], static_cast<const char*>(data) + first, size - first);
+    }
+    void copy_out(std::size_t position, void* data, std::size_t size) const
+    {
+      std::size_t const offset = position % capacity;
+      std::size_t const first = std::min(size, capacity - offset);
+      std::memcpy(data, &_data[offset], first);
+      std::memcpy(static_cast<char*>(data) + first, &_data[0], size - first);
+    }
+
+    std::array<char, capacity> _data;
+    //! bytes ever pushed and popped, the positions in _data are modulo capacity
+    std::atomic<std::size_t> _head = {0};
+    std::atomic<std::size_t> _tail = {0};
+    std::atomic<std::uint64_t> _dropped = {0};
+  };
+
+  class Logger
+  {
+  public:
+    static Logger& instance()
+    {
+      static Logger logger;
+      return logger;
+    }
+
+    std::shared_ptr<RecordBuffer> add_buffer()
+    {
+      auto buffer = std::make_shared<RecordBuffer>();
+
+      std::lock_guard<std::mutex> const lock(_buffers_guard);
+      _buffers.push_back(buffer);
+      return buffer;
+    }
+
+    std::uint64_t time() const
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now() - _start).count();
+    }
+
+    void wake_up()
+    {
+      _wake_up.notify_one();
+    }
+
+    void write_to(const char* filename)
+    {
+      std::lock_guard<std::mutex> const lock(_write_guard);
+
+      _file.open(filename, std::ios_base::out | std::ios_base::trunc);
+      if (_file)
+      {
+        std::cout.rdbuf(_file.rdbuf());
+        std::clog.rdbuf(_file.rdbuf());
+        std::cerr.rdbuf(_file.rdbuf());
+      }
+    }
+
+    void write_pending()
+    {
+      std::lock_guard<std::mutex> const lock(_write_guard);
+
+      std::vector<std::shared_ptr<RecordBuffer>> buffers;
+      {
+        std::lock_guard<std::mutex> const buffers_lock(_buffers_guard);
+        buffers = _buffers;
+      }
+
+      bool written = false;
+
+      for (auto const& buffer : buffers)
+      {
+        buffer->drain
+          ( _text
+          , [&] (RecordHeader const& header, std::string const& text)
+            {
+              write(header, text);
+              written = true;
+            }
+          );
+
+        if (std::uint64_t dropped = buffer->take_dropped())
+        {
+          std::cerr << time() << " - " << dropped << " log records were dropped, the queue of their thread was full" << std::endl;
+          written = true;
+        }
+      }
+
+      if (written)
+      {
+        std::cout.flush();
+        std::clog.flush();
+        std::cerr.flush();
+      }
+
+      // the buffers of exited threads go once written, the only references
+      // left then being _buffers and the copy above
+      std::lock_guard<std::mutex> const buffers_lock(_buffers_guard);
+      for (auto it = _buffers.begin(); it != _buffers.end();)
+      {
+        if (it->use_count() == 2 && (*it)->empty())
+        {
+          it = _buffers.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+  private:
+    Logger()
+      : _start(std::chrono::steady_clock::now())
+      , _original_buffers{std::cout.rdbuf(), std::clog.rdbuf(), std::cerr.rdbuf()}
+      , _writer([this] { run(); })
+    {}
+
+    ~Logger()
+    {
+      _stop = true;
+      _wake_up.notify_one();
+      _writer.join();
+
+      std::cout.rdbuf(_original_buffers[0]);
+      std::clog.rdbuf(_original_buffers[1]);
+      std::cerr.rdbuf(_original_buffers[2]);
+    }
+
+    void run()
+    {
+      for (;;)
+      {
+        bool const stop = _stop;
+
+        write_pending();
+
+        if (stop)
+        {
+          return;
+        }
+
+        // woken up early for errors and filling buffers only
+        std::unique_lock<std::mutex> lock(_wake_up_guard);
+        _wake_up.wait_for(lock, std::chrono::milliseconds(50));
+      }
+    }
+
+    static void write(RecordHeader const& header, std::string const& text)
+    {
+      const char* file = strrchr(header.file, '/') ? strrchr(header.file, '/') : strrchr(header.file, '\\');
+      file = file ? file + 1 : header.file;
+
+      switch (header.severity)
+      {
+      case LogSeverity::Error:
+        std::cerr << header.time << " - (" << file << ":" << header.line << "): [Error] " << text;
+        break;
+      case LogSeverity::Debug:
+        std::clog << header.time << " - (" << file << ":" << header.line << "): [Debug] " << text;
+        break;
+      case LogSeverity::Info:
+        std::cout << header.time << " - (" << file << ":" << header.line << "): " << text;
+        break;
+      }
+    }
+
+    std::chrono::steady_clock::time_point const _start;
+    std::array<std::streambuf*, 3> _original_buffers;
+    std::ofstream _file;
+
+    std::mutex _buffers_guard;
+    std::vector<std::shared_ptr<RecordBuffer>> _buffers;
+
+    //! the writer and FlushLogging() take turns draining the buffers
+    std::mutex _write_guard;
+    std::string _text;
+
+    std::atomic<bool> _stop = {false};
+    std::mutex _wake_up_guard;
+    std::condition_variable _wake_up;
+    std::thread _writer;
+  };
+
+  //! collects the message of the thread's current record
+  class RecordStream : public std::streambuf
+  {
+  public:
+    RecordStream()
+      : _buffer(Logger::instance().add_buffer())
+      , _stream(this)
+    {}
+
+    ~RecordStream()
+    {
+      commit();
+    }
+
+    std::ostream& begin(LogSeverity severity, const char * pFile, int pLine)
+    {
+      // a record not ended with a flush ends with the next one
+      commit();
+
+      _header.time = Logger::instance().time();
+      _header.file = pFile;
+      _header.line = pLine;
+      _header.severity = severity;
+      _open = true;
+
+      return _stream;
+    }
+
+  protected:
+    int_type overflow(int_type c) override
+    {
+      if (!traits_type::eq_int_type(c, traits_type::eof()))
+      {
+        _text.push_back(traits_type::to_char_type(c));
+      }
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+      _text.append(s, n);
+      return n;
+    }
+
+    int sync() override
+    {
+      commit();
+      return 0;
+    }
+
+  private:
+    void commit()
+    {
+      if (!_open)
+      {
+        return;
+      }
+
+      _header.size = _text.size();
+      bool const filling_up = _buffer->push(_header, _text.data());
+      _text.clear();
+      _open = false;
+
+      if (filling_up || _header.severity == LogSeverity::Error)
+      {
+        Logger::instance().wake_up();
+      }
+    }
+
+    std::shared_ptr<RecordBuffer> _buffer;
+    RecordHeader _header;
+    std::string _text;
+    bool _open = false;
+    std::ostream _stream;
+  };
+
+  std::ostream& record(LogSeverity severity, const char * pFile, int pLine)
+  {
+    thread_local RecordStream stream;
+    return stream.begin(severity, pFile, pLine);
+  }
+}
 
 std::ostream& _LogError(const char * pFile, int pLine)
 {
-  return std::cerr << clock() * 1000 / CLOCKS_PER_SEC << " - (" << ((strrchr(pFile, '/') ? strrchr(pFile, '/') : (strrchr(pFile, '\\') ? strrchr(pFile, '\\') : pFile - 1)) + 1) << ":" << pLine << "): [Error] ";
+  return record(LogSeverity::Error, pFile, pLine);
 }
 std::ostream& _LogDebug(const char * pFile, int pLine)
 {
-  return std::clog << clock() * 1000 / CLOCKS_PER_SEC << " - (" << ((strrchr(pFile, '/') ? strrchr(pFile, '/') : (strrchr(pFile, '\\') ? strrchr(pFile, '\\') : pFile - 1)) + 1) << ":" << pLine << "): [Debug] ";
+  return record(LogSeverity::Debug, pFile, pLine);
 }
 std::ostream& _Log(const char * pFile, int pLine)
 {
-  return std::cout << clock() * 1000 / CLOCKS_PER_SEC << " - (" << ((strrchr(pFile, '/') ? strrchr(pFile, '/') : (strrchr(pFile, '\\') ? strrchr(pFile, '\\') : pFile - 1)) + 1) << ":" << pLine << "): ";
+  return record(LogSeverity::Info, pFile, pLine);
+}
+
+void SetLogSeverity(LogSeverity minimum)
+{
+  gLogMinimumSeverity = static_cast<int>(minimum);
+}
+
+void FlushLogging()
+{
+  Logger::instance().write_pending();
 }
 
 #if DEBUG__LOGGINGTOCONSOLE
@@ -25,19 +387,9 @@ void InitLogging()
   LogDebug << "Logging to console window." << std::endl;
 }
 #else
-namespace
-{
-  std::ofstream gLogStream;
-}
 void InitLogging()
 {
   // Set up log.
-  gLogStream.open("log.txt", std::ios_base::out | std::ios_base::trunc);
-  if (gLogStream)
-  {
-    std::cout.rdbuf(gLogStream.rdbuf());
-    std::clog.rdbuf(gLogStream.rdbuf());
-    std::cerr.rdbuf(gLogStream.rdbuf());
-  }
+  Logger::instance().write_to("log.txt");
 }
 #endif
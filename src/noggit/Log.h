@@ -2,14 +2,36 @@
 
 #pragma once
 
+#include <atomic>
 #include <iostream>
 
+enum class LogSeverity
+{
+  Debug,
+  Info,
+  Error,
+};
+
+//! the records are queued per thread and written by a background thread,
+//! an std::endl (or any flush) ends the record
 std::ostream& _LogError(const char * pFile, int pLine);
 std::ostream& _LogDebug(const char * pFile, int pLine);
 std::ostream& _Log(const char * pFile, int pLine);
 
-#define LogError _LogError( __FILE__, __LINE__ )
-#define LogDebug _LogDebug( __FILE__, __LINE__ )
-#define Log _Log( __FILE__, __LINE__ )
+extern std::atomic<int> gLogMinimumSeverity;
+
+inline bool LogEnabled(LogSeverity severity)
+{
+  return static_cast<int>(severity) >= gLogMinimumSeverity.load(std::memory_order_relaxed);
+}
+
+// the message of a filtered out record is not even evaluated
+#define LogError if (!LogEnabled(LogSeverity::Error)) {} else _LogError( __FILE__, __LINE__ )
+#define LogDebug if (!LogEnabled(LogSeverity::Debug)) {} else _LogDebug( __FILE__, __LINE__ )
+#define Log if (!LogEnabled(LogSeverity::Info)) {} else _Log( __FILE__, __LINE__ )
 
 void InitLogging();
+void SetLogSeverity(LogSeverity minimum);
+//! writes the queued records on the calling thread, for when the process
+//! might not exit normally
+void FlushLogging();
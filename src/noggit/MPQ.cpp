@@ -3,22 +3,33 @@
 #include <noggit/AsyncLoader.h> // AsyncLoader
 #include <noggit/Log.h>
 #include <noggit/MPQ.h>
+#include <external/tracy/Tracy.hpp>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
 #include <QtCore/QSettings>
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstdio>
+#include <cctype>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <list>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace
@@ -28,13 +39,339 @@ namespace
   ArchivesMap _openArchives;
 
   boost::mutex gListfileLoadingMutex;
-  boost::mutex gMPQFileMutex;
+
+  std::size_t max_readers_per_archive()
+  {
+    // every handle holds its own copy of the archive tables, don't go overboard
+    return std::max (2u, std::min (8u, std::thread::hardware_concurrency()));
+  }
+
+  // case and separator insensitive, so lookups never build a normalized copy
+  char normalized_filename_char (char c)
+  {
+    return c == '/' ? '\\' : static_cast<char> (std::toupper (static_cast<unsigned char> (c)));
+  }
+
+  struct normalized_filename_hash
+  {
+    std::size_t operator() (std::string_view filename) const
+    {
+      std::uint64_t hash (14695981039346656037ull);
+      for (char c : filename)
+      {
+        hash ^= static_cast<unsigned char> (normalized_filename_char (c));
+        hash *= 1099511628211ull;
+      }
+      return static_cast<std::size_t> (hash);
+    }
+  };
+
+  struct normalized_filename_equal
+  {
+    bool operator() (std::string_view lhs, std::string_view rhs) const
+    {
+      return lhs.size() == rhs.size()
+        && std::equal ( lhs.begin(), lhs.end(), rhs.begin()
+                      , [] (char l, char r)
+                        {
+                          return normalized_filename_char (l) == normalized_filename_char (r);
+                        }
+                      );
+    }
+  };
+}
+
+namespace
+{
+  constexpr auto mpq_crypt_table ([]
+  {
+    std::array<std::uint32_t, 0x500> table {};
+    std::uint32_t seed (0x00100001);
+
+    for (std::uint32_t index1 (0); index1 < 0x100; ++index1)
+    {
+      for (std::uint32_t index2 (index1), i (0); i < 5; ++i, index2 += 0x100)
+      {
+        seed = (seed * 125 + 3) % 0x2AAAAB;
+        std::uint32_t const high ((seed & 0xFFFF) << 16);
+        seed = (seed * 125 + 3) % 0x2AAAAB;
+        table[index2] = high | (seed & 0xFFFF);
+      }
+    }
+
+    return table;
+  }());
+
+  //! both name hashes the archive hash table files an entry under
+  std::uint64_t mpq_filename_hash (std::string_view filename)
+  {
+    std::uint32_t a1 (0x7FED7FED), a2 (0xEEEEEEEE);
+    std::uint32_t b1 (0x7FED7FED), b2 (0xEEEEEEEE);
+
+    for (char c : filename)
+    {
+      std::uint32_t const ch (static_cast<unsigned char> (normalized_filename_char (c)));
+      a1 = mpq_crypt_table[0x100 + ch] ^ (a1 + a2);
+      a2 = ch + a1 + a2 + (a2 << 5) + 3;
+      b1 = mpq_crypt_table[0x200 + ch] ^ (b1 + b2);
+      b2 = ch + b1 + b2 + (b2 << 5) + 3;
+    }
+
+    return (std::uint64_t (a1) << 32) | b1;
+  }
+
+  //! an entry of the archive hash table
+  struct mpq_hash_entry
+  {
+    std::uint32_t name_a;
+    std::uint32_t name_b;
+    std::uint32_t locale_and_platform;
+    std::uint32_t block_index;
+  };
+  static_assert (sizeof (mpq_hash_entry) == 16, "hash table entries are 16 bytes");
+
+  constexpr std::uint32_t mpq_hash_entry_deleted = 0xFFFFFFFE;
+
+  //! the spelling StormLib expects, built on the stack for any sane length
+  class stormlib_filename
+  {
+  public:
+    explicit stormlib_filename (std::string const& filename)
+    {
+      if (filename.size() < sizeof (_buffer))
+      {
+        std::transform (filename.begin(), filename.end(), _buffer, &normalized_filename_char);
+        _buffer[filename.size()] = '\0';
+        _name = _buffer;
+      }
+      else
+      {
+        _long_name = noggit::mpq::normalized_filename_insane (filename);
+        _name = _long_name.c_str();
+      }
+    }
+
+    stormlib_filename (stormlib_filename const&) = delete;
+    stormlib_filename& operator= (stormlib_filename const&) = delete;
+
+    char const* c_str() const { return _name; }
+
+  private:
+    char _buffer[MAX_PATH];
+    std::string _long_name;
+    char const* _name;
+  };
+
+  //! the loose files of the project directory, listed on first use. opens
+  //! and existence checks look them up instead of asking the file system.
+  class project_files
+  {
+  public:
+    //! where the file is on disk, if the project has it
+    boost::optional<boost::filesystem::path> find (std::string_view filename)
+    {
+      return listed ( [&]() -> boost::optional<boost::filesystem::path>
+                      {
+                        auto const it (_files.find (filename));
+                        if (it == _files.end())
+                        {
+                          return boost::none;
+                        }
+                        return _root / std::string (*it);
+                      }
+                    );
+    }
+
+    bool contains (std::string_view filename)
+    {
+      return listed ([&] { return _files.count (filename) != 0; });
+    }
+
+    //! where the file is or would be saved to
+    boost::filesystem::path save_path (std::string const& filename)
+    {
+      if (auto path = find (filename))
+      {
+        return *path;
+      }
+
+      return listed ([&] { return _root / noggit::mpq::normalized_filename (filename); });
+    }
+
+    void add (std::string const& filename)
+    {
+      std::unique_lock<std::shared_mutex> const lock (_mutex);
+
+      // not listed yet, listing will find it
+      if (_listed && !_files.count (filename))
+      {
+        _names.emplace_back (noggit::mpq::normalized_filename (filename));
+        _files.emplace (_names.back());
+      }
+    }
+
+    //! the name stays allocated until the next reload, removing is rare
+    void remove (std::string const& filename)
+    {
+      std::unique_lock<std::shared_mutex> const lock (_mutex);
+      _files.erase (filename);
+    }
+
+    void reload()
+    {
+      std::unique_lock<std::shared_mutex> const lock (_mutex);
+      _listed = false;
+      _files.clear();
+      _names.clear();
+    }
+
+  private:
+    template<typename Function>
+      auto listed (Function&& function) -> decltype (function())
+    {
+      {
+        std::shared_lock<std::shared_mutex> const lock (_mutex);
+        if (_listed)
+        {
+          return function();
+        }
+      }
+
+      std::unique_lock<std::shared_mutex> const lock (_mutex);
+      if (!_listed)
+      {
+        list();
+      }
+      return function();
+    }
+
+    void list()
+    {
+      QSettings settings;
+      _root = boost::filesystem::path (settings.value ("project/path").toString().toStdString());
+
+      std::string const root (_root.string());
+      boost::system::error_code ec;
+
+      for ( boost::filesystem::recursive_directory_iterator entry (_root, ec), end
+          ; !ec && entry != end
+          ; entry.increment (ec)
+          )
+      {
+        if (!boost::filesystem::is_regular_file (entry->status()))
+        {
+          continue;
+        }
+
+        // entries are the root with names appended, keep the relative part
+        // in the spelling found on disk
+        std::string const path (entry->path().string());
+        std::size_t const separator (path.find_first_not_of ("/\\", root.size()));
+        _names.emplace_back (path.substr (separator == std::string::npos ? path.size() : separator));
+        _files.emplace (_names.back());
+      }
+
+      LogDebug << "Listed " << _files.size() << " files in project " << _root << std::endl;
+
+      _listed = true;
+    }
+
+    std::shared_mutex _mutex;
+    bool _listed = false;
+    boost::filesystem::path _root;
+    //! owns the names the views in _files refer to, never moves them
+    std::deque<std::string> _names;
+    std::unordered_set<std::string_view, normalized_filename_hash, normalized_filename_equal> _files;
+  };
+
+  project_files& loose_project_files()
+  {
+    static project_files files;
+    return files;
+  }
+}
+
+//! maps the name hash of every file of every archive to the archive it is
+//! read from. archive priority is resolved while building: later archives
+//! patch earlier ones, so they overwrite the owner. once built, a lookup
+//! is a hash of the name and a miss is final.
+struct mpq_file_index
+{
+  //! the archive to read the file from, null if no archive holds it
+  MPQArchive const* find (std::string_view filename) const
+  {
+    auto const it (_files.find (mpq_filename_hash (filename)));
+    return it == _files.end() ? nullptr : it->second;
+  }
+
+  //! the archives have to outlive the index
+  template<typename Archives>
+    static std::shared_ptr<mpq_file_index const> build (Archives const& archives)
+  {
+    auto index (std::make_shared<mpq_file_index>());
+
+    std::size_t files (0);
+    for (auto const& entry : archives)
+    {
+      files += entry.second->_file_hashes.size();
+    }
+    index->_files.reserve (files);
+
+    for (auto const& entry : archives)
+    {
+      MPQArchive const& archive (*entry.second);
+
+      for (std::uint64_t hash : archive._file_hashes)
+      {
+        index->_files.insert_or_assign (hash, &archive);
+      }
+    }
+
+    return index;
+  }
+
+private:
+  std::unordered_map<std::uint64_t, MPQArchive const*> _files;
+};
+
+namespace
+{
+  boost::mutex gFileIndexMutex;
+  std::shared_ptr<mpq_file_index const> gFileIndex;
+  //! held while building, so a single index is built per set of archives
+  boost::mutex gFileIndexBuildMutex;
+
+  std::shared_ptr<mpq_file_index const> current_file_index()
+  {
+    boost::mutex::scoped_lock lock (gFileIndexMutex);
+    return gFileIndex;
+  }
+
+  void set_file_index (std::shared_ptr<mpq_file_index const> index)
+  {
+    boost::mutex::scoped_lock lock (gFileIndexMutex);
+    gFileIndex = std::move (index);
+  }
+
+  //! builds the index unless another thread did already, to call once
+  //! every archive finished loading
+  void build_file_index()
+  {
+    boost::mutex::scoped_lock lock (gFileIndexBuildMutex);
+
+    if (!current_file_index())
+    {
+      set_file_index (mpq_file_index::build (_openArchives));
+    }
+  }
 }
 
 std::unordered_set<std::string> gListfile;
 
 void MPQArchive::loadMPQ (AsyncLoader* loader, std::string const& filename, bool doListfile)
 {
+  set_file_index (nullptr);
+
   _openArchives.emplace_back (filename, std::make_unique<MPQArchive> (filename, doListfile));
   loader->queue_for_load(_openArchives.back().second.get());
 }
@@ -42,6 +379,10 @@ void MPQArchive::loadMPQ (AsyncLoader* loader, std::string const& filename, bool
 MPQArchive::MPQArchive(std::string const& filename, bool doListfile)
   : AsyncObject(filename)
   ,_archiveHandle(nullptr)
+  ,_max_readers(max_readers_per_archive())
+  ,_reader_count(0)
+  ,_mpq_header_offset(0)
+  ,_hash_table_read(false)
 {
   if (!SFileOpenArchive (filename.c_str(), 0, MPQ_OPEN_NO_LISTFILE | STREAM_FLAG_READ_ONLY, &_archiveHandle))
   {
@@ -53,49 +394,166 @@ MPQArchive::MPQArchive(std::string const& filename, bool doListfile)
     LogDebug << "Opened archive " << filename << std::endl;
   }
 
+  {
+    boost::system::error_code size_error, time_error;
+    auto const size (boost::filesystem::file_size (filename, size_error));
+    auto const time (boost::filesystem::last_write_time (filename, time_error));
+
+    std::stringstream version;
+    version << filename << " " << (size_error ? 0 : size) << " " << (time_error ? 0 : time);
+    _version = version.str();
+  }
+
+  _readers.emplace_back (_archiveHandle);
+  _idle_readers.emplace_back (_archiveHandle);
+  _reader_count = 1;
+
+  DWORD hash_table_size = 0;
+  if (SFileGetFileInfo (_archiveHandle, SFileMpqHashTableSize, &hash_table_size, sizeof (hash_table_size), nullptr))
+  {
+    std::vector<mpq_hash_entry> hash_table (hash_table_size);
+    if (SFileGetFileInfo ( _archiveHandle, SFileMpqHashTable, hash_table.data()
+                         , static_cast<DWORD> (hash_table.size() * sizeof (mpq_hash_entry)), nullptr
+                         )
+       )
+    {
+      for (auto const& entry : hash_table)
+      {
+        // skips free and deleted entries
+        if (entry.block_index < mpq_hash_entry_deleted)
+        {
+          _file_hashes.emplace_back ((std::uint64_t (entry.name_a) << 32) | entry.name_b);
+        }
+      }
+      _hash_table_read = true;
+    }
+  }
+
+  if (!_hash_table_read)
+  {
+    LogDebug << "Could not read the hash table of " << filename << ", indexing the files its listfile names" << std::endl;
+  }
+
+  ULONGLONG header_offset = 0;
+  if (SFileGetFileInfo (_archiveHandle, SFileMpqHeaderOffset, &header_offset, sizeof (header_offset), nullptr))
+  {
+    try
+    {
+      boost::interprocess::file_mapping const file (filename.c_str(), boost::interprocess::read_only);
+      _mapping = std::make_shared<boost::interprocess::mapped_region> (file, boost::interprocess::read_only);
+      _mpq_header_offset = header_offset;
+    }
+    catch (boost::interprocess::interprocess_exception const& e)
+    {
+      LogDebug << "Could not map archive " << filename << ", falling back to copying reads: " << e.what() << std::endl;
+    }
+  }
+
   finished = !doListfile;
 }
 
+bool MPQArchive::mappedView (HANDLE fileHandle, char const** data, std::size_t* size) const
+{
+  if (!_mapping)
+  {
+    return false;
+  }
+
+  DWORD flags = 0;
+  DWORD file_size = 0;
+  DWORD compressed_size = 0;
+  ULONGLONG byte_offset = 0;
+
+  if ( !SFileGetFileInfo (fileHandle, SFileInfoFlags, &flags, sizeof (flags), nullptr)
+    || !SFileGetFileInfo (fileHandle, SFileInfoFileSize, &file_size, sizeof (file_size), nullptr)
+    || !SFileGetFileInfo (fileHandle, SFileInfoCompressedSize, &compressed_size, sizeof (compressed_size), nullptr)
+    || !SFileGetFileInfo (fileHandle, SFileInfoByteOffset, &byte_offset, sizeof (byte_offset), nullptr)
+     )
+  {
+    return false;
+  }
+
+  // only plain stored files are laid out contiguously in the archive
+  if ( !(flags & MPQ_FILE_EXISTS)
+    || (flags & (MPQ_FILE_COMPRESS_MASK | MPQ_FILE_ENCRYPTED | MPQ_FILE_PATCH_FILE | MPQ_FILE_DELETE_MARKER))
+    || compressed_size != file_size
+     )
+  {
+    return false;
+  }
+
+  std::uint64_t const begin (_mpq_header_offset + byte_offset);
+  if (begin + file_size > _mapping->get_size())
+  {
+    return false;
+  }
+
+  *data = static_cast<char const*> (_mapping->get_address()) + begin;
+  *size = file_size;
+
+  return true;
+}
+
 void MPQArchive::finishLoading()
 {
   if (finished)
     return;
 
-  HANDLE fh;
-
-  boost::mutex::scoped_lock lock2(gMPQFileMutex);
   boost::mutex::scoped_lock lock(gListfileLoadingMutex);
 
-  if (SFileOpenFileEx(_archiveHandle, "(listfile)", 0, &fh))
-  {
-    size_t filesize = SFileGetFileSize(fh, nullptr); //last nullptr for newer version of StormLib
+  // may have been finished by allFinishLoading() while waiting for the lock
+  if (finished)
+    return;
 
-    std::vector<char> readbuffer (filesize);
-    SFileReadFile(fh, readbuffer.data(), filesize, nullptr, nullptr); //last nullptrs for newer version of StormLib
-    SFileCloseFile(fh);
+  if (_archiveHandle)
+  {
+    scoped_reader const reader (*this);
+    HANDLE fh;
 
-    std::string current;
-    for (char c : readbuffer)
+    if (SFileOpenFileEx(reader.handle(), "(listfile)", 0, &fh))
     {
-      if (c == '\r')
-      {
-        continue;
-      }
-      if (c == '\n')
+      size_t filesize = SFileGetFileSize(fh, nullptr); //last nullptr for newer version of StormLib
+
+      std::vector<char> readbuffer (filesize);
+      SFileReadFile(fh, readbuffer.data(), filesize, nullptr, nullptr); //last nullptrs for newer version of StormLib
+      SFileCloseFile(fh);
+
+      auto const add_file
+        ( [&] (std::string const& listed)
+          {
+            gListfile.emplace (noggit::mpq::normalized_filename (listed));
+
+            // listfiles may name files the archive doesn't actually contain
+            if (!_hash_table_read && SFileHasFile (reader.handle(), stormlib_filename (listed).c_str()))
+            {
+              _file_hashes.emplace_back (mpq_filename_hash (listed));
+            }
+          }
+        );
+
+      std::string current;
+      for (char c : readbuffer)
       {
-        gListfile.emplace (noggit::mpq::normalized_filename (current));
-        current.resize (0);
+        if (c == '\r')
+        {
+          continue;
+        }
+        if (c == '\n')
+        {
+          add_file (current);
+          current.resize (0);
+        }
+        else
+        {
+          current += c;
+        }
       }
-      else
+
+      if (!current.empty())
       {
-        current += c;
+        add_file (current);
       }
     }
-
-    if (!current.empty())
-    {
-      gListfile.emplace (noggit::mpq::normalized_filename (current));
-    }
   }
 
   finished = true;
@@ -104,13 +562,78 @@ void MPQArchive::finishLoading()
   if (MPQArchive::allFinishedLoading())
   {
     LogDebug << "Completed listfile loading: " << gListfile.size() << " files\n";
+
+    build_file_index();
   }
 }
 
+MPQArchive::scoped_reader::scoped_reader (MPQArchive const& archive)
+  : _archive (archive)
+  , _handle (archive.acquire_reader())
+{}
+
+MPQArchive::scoped_reader::~scoped_reader()
+{
+  _archive.release_reader (_handle);
+}
+
+HANDLE MPQArchive::acquire_reader() const
+{
+  std::unique_lock<std::mutex> lock (_readers_guard);
+
+  _reader_released.wait
+    ( lock
+    , [&]
+      {
+        return !_idle_readers.empty() || _reader_count < _max_readers;
+      }
+    );
+
+  if (_idle_readers.empty())
+  {
+    // opening reads the archive tables, don't block the other readers meanwhile
+    ++_reader_count;
+    lock.unlock();
+
+    HANDLE handle (nullptr);
+    bool const opened
+      (SFileOpenArchive (filename.c_str(), 0, MPQ_OPEN_NO_LISTFILE | STREAM_FLAG_READ_ONLY, &handle));
+
+    lock.lock();
+
+    if (opened)
+    {
+      _readers.emplace_back (handle);
+      return handle;
+    }
+
+    LogError << "Could not open additional reader for archive " << filename
+             << ", sharing the " << _readers.size() << " existing ones" << std::endl;
+
+    _max_readers = --_reader_count;
+    _reader_released.wait (lock, [&] { return !_idle_readers.empty(); });
+  }
+
+  HANDLE handle (_idle_readers.back());
+  _idle_readers.pop_back();
+  return handle;
+}
+
+void MPQArchive::release_reader (HANDLE handle) const
+{
+  {
+    std::lock_guard<std::mutex> const lock (_readers_guard);
+    _idle_readers.emplace_back (handle);
+  }
+  _reader_released.notify_one();
+}
+
 MPQArchive::~MPQArchive()
 {
-  if (_archiveHandle)
-    SFileCloseArchive(_archiveHandle);
+  for (HANDLE reader : _readers)
+  {
+    SFileCloseArchive(reader);
+  }
 }
 
 bool MPQArchive::allFinishedLoading()
@@ -133,42 +656,42 @@ void MPQArchive::allFinishLoading()
 
 void MPQArchive::unloadAllMPQs()
 {
+  set_file_index (nullptr);
   _openArchives.clear();
 }
 
 bool MPQArchive::hasFile(std::string const& filename) const
 {
-  return SFileHasFile(_archiveHandle, noggit::mpq::normalized_filename_insane (filename).c_str());
-}
-
-void MPQArchive::unloadMPQ(std::string const& filename)
-{
-  for (auto it = _openArchives.begin(); it != _openArchives.end(); ++it)
+  if (!_archiveHandle)
   {
-    if (it->first == filename)
-    {
-      _openArchives.erase(it);
-    }
+    return false;
   }
+
+  scoped_reader const reader (*this);
+  return SFileHasFile(reader.handle(), noggit::mpq::normalized_filename_insane (filename).c_str());
 }
 
-bool MPQArchive::openFile(std::string const& filename, HANDLE* fileHandle) const
+void MPQArchive::unloadMPQ(std::string const& filename)
 {
-  assert(fileHandle);
-  return SFileOpenFileEx(_archiveHandle, noggit::mpq::normalized_filename_insane (filename).c_str(), 0, fileHandle);
+  set_file_index (nullptr);
+
+  _openArchives.remove_if ( [&] (ArchiveEntry const& archive)
+                            {
+                              return archive.first == filename;
+                            }
+                          );
 }
 
 namespace
 {
-  boost::filesystem::path getDiskPath (std::string const& pFilename)
-  {
-    QSettings settings;
-    return boost::filesystem::path (settings.value ("project/path").toString().toStdString())
-      / noggit::mpq::normalized_filename (pFilename);
-  }
-
   bool existsInMPQ (std::string const& filename)
   {
+    if (auto const index = current_file_index())
+    {
+      return index->find (filename) != nullptr;
+    }
+
+    // archives are still loading, there is no index to ask yet
     return std::any_of ( _openArchives.begin(), _openArchives.end()
                        , [&] (ArchiveEntry const& archive)
                          {
@@ -183,48 +706,120 @@ namespace
 */
 MPQFile::MPQFile(std::string const& filename)
   : eof(true)
+  , _data(nullptr)
+  , _size(0)
   , pointer(0)
   , External(false)
-  , _disk_path (getDiskPath (filename))
+  , _filename (filename)
 {
+  ZoneScoped;
+
   if (filename.empty())
     throw std::runtime_error("MPQFile: filename empty");
 
-  boost::mutex::scoped_lock lock(gMPQFileMutex);
-
-  std::ifstream input(_disk_path.string(), std::ios_base::binary | std::ios_base::in);
-  if (input.is_open())
+  boost::system::error_code ec;
+  auto const disk_path (loose_project_files().find (filename));
+  auto const disk_size (disk_path ? boost::filesystem::file_size (*disk_path, ec) : 0);
+  if (disk_path && !ec)
   {
     External = true;
     eof = false;
 
-    input.seekg(0, std::ios::end);
-    buffer.resize (input.tellg());
-    input.seekg(0, std::ios::beg);
+    // empty files can't be mapped, but there is nothing to read either
+    if (disk_size == 0)
+    {
+      return;
+    }
+
+    try
+    {
+      boost::interprocess::file_mapping const file (disk_path->string().c_str(), boost::interprocess::read_only);
+      _mapping = std::make_shared<boost::interprocess::mapped_region> (file, boost::interprocess::read_only);
+      _data = static_cast<char const*> (_mapping->get_address());
+      _size = _mapping->get_size();
+      return;
+    }
+    catch (boost::interprocess::interprocess_exception const& e)
+    {
+      LogDebug << "Could not map " << *disk_path << ", reading it instead: " << e.what() << std::endl;
+    }
+
+    std::ifstream input(disk_path->string(), std::ios_base::binary | std::ios_base::in);
+    if (input.is_open())
+    {
+      buffer.resize (disk_size);
+      input.read(buffer.data(), buffer.size());
+      input.close();
 
-    input.read(buffer.data(), buffer.size());
+      _data = buffer.data();
+      _size = buffer.size();
+      return;
+    }
 
-    input.close();
-    return;
+    External = false;
+    eof = true;
   }
 
-  for (ArchivesMap::reverse_iterator i = _openArchives.rbegin(); i != _openArchives.rend(); ++i)
+  stormlib_filename const mpq_filename (filename);
+
+  if (auto const index = current_file_index())
   {
-    HANDLE fileHandle;
+    MPQArchive const* archive (index->find (filename));
 
-    if (!i->second->openFile(filename, &fileHandle))
-      continue;
+    if (archive && readFromArchive (*archive, mpq_filename.c_str()))
+    {
+      return;
+    }
+  }
+  else
+  {
+    // archives are still loading, there is no index to ask yet
+    for (ArchivesMap::reverse_iterator i = _openArchives.rbegin(); i != _openArchives.rend(); ++i)
+    {
+      if (readFromArchive (*i->second, mpq_filename.c_str()))
+      {
+        return;
+      }
+    }
+  }
 
-    eof = false;
+  //LogError << "File '" << filename << "' does not exist." << std::endl;
+  throw std::invalid_argument ("File '" + filename + "' does not exist.");
+}
+
+bool MPQFile::readFromArchive (MPQArchive const& archive, char const* stormlib_filename)
+{
+  if (!archive._archiveHandle)
+  {
+    return false;
+  }
+
+  MPQArchive::scoped_reader const reader (archive);
+  HANDLE fileHandle;
+
+  if (!SFileOpenFileEx(reader.handle(), stormlib_filename, 0, &fileHandle))
+  {
+    return false;
+  }
+
+  eof = false;
+
+  if (archive.mappedView (fileHandle, &_data, &_size))
+  {
+    _mapping = archive._mapping;
+  }
+  else
+  {
     buffer.resize (SFileGetFileSize(fileHandle, nullptr));
     SFileReadFile(fileHandle, buffer.data(), buffer.size(), nullptr, nullptr); //last nullptrs for newer version of StormLib
-    SFileCloseFile(fileHandle);
 
-    return;
+    _data = buffer.data();
+    _size = buffer.size();
   }
 
-  //LogError << "File '" << filename << "' does not exist." << std::endl;
-  throw std::invalid_argument ("File '" + filename + "' does not exist.");
+  SFileCloseFile(fileHandle);
+
+  return true;
 }
 
 MPQFile::~MPQFile()
@@ -238,7 +833,88 @@ bool MPQFile::exists (std::string const& filename)
 }
 bool MPQFile::existsOnDisk (std::string const& filename)
 {
-  return boost::filesystem::exists (getDiskPath (filename));
+  return loose_project_files().contains (filename);
+}
+
+boost::optional<std::string> MPQFile::version (std::string const& filename)
+{
+  std::stringstream version;
+
+  if (auto const disk_path = loose_project_files().find (filename))
+  {
+    boost::system::error_code size_error, time_error;
+    auto const size (boost::filesystem::file_size (*disk_path, size_error));
+    auto const time (boost::filesystem::last_write_time (*disk_path, time_error));
+
+    // unreadable files are looked up in the archives, as when opening them
+    if (!size_error && !time_error)
+    {
+      version << "disk " << size << " " << time;
+      return version.str();
+    }
+  }
+
+  MPQArchive const* archive (nullptr);
+
+  if (auto const index = current_file_index())
+  {
+    archive = index->find (filename);
+  }
+  else
+  {
+    for (auto i (_openArchives.rbegin()); i != _openArchives.rend() && !archive; ++i)
+    {
+      if (i->second->hasFile (filename))
+      {
+        archive = i->second.get();
+      }
+    }
+  }
+
+  if (!archive || !archive->_archiveHandle)
+  {
+    return boost::none;
+  }
+
+  stormlib_filename const mpq_filename (filename);
+  MPQArchive::scoped_reader const reader (*archive);
+  HANDLE fileHandle;
+
+  if (!SFileOpenFileEx (reader.handle(), mpq_filename.c_str(), 0, &fileHandle))
+  {
+    return boost::none;
+  }
+
+  // the crc is only known if the archive has attributes, the position and
+  // sizes change as well when an archive is rebuilt
+  ULONGLONG byte_offset = 0;
+  DWORD file_size = 0;
+  DWORD compressed_size = 0;
+  DWORD crc = 0;
+  SFileGetFileInfo (fileHandle, SFileInfoByteOffset, &byte_offset, sizeof (byte_offset), nullptr);
+  SFileGetFileInfo (fileHandle, SFileInfoFileSize, &file_size, sizeof (file_size), nullptr);
+  SFileGetFileInfo (fileHandle, SFileInfoCompressedSize, &compressed_size, sizeof (compressed_size), nullptr);
+  SFileGetFileInfo (fileHandle, SFileInfoCRC32, &crc, sizeof (crc), nullptr);
+  SFileCloseFile (fileHandle);
+
+  version << archive->_version << " " << byte_offset << " " << file_size
+          << " " << compressed_size << " " << crc;
+  return version.str();
+}
+
+void MPQFile::project_file_created (std::string const& filename)
+{
+  loose_project_files().add (filename);
+}
+
+void MPQFile::project_file_removed (std::string const& filename)
+{
+  loose_project_files().remove (filename);
+}
+
+void MPQFile::reload_project_files()
+{
+  loose_project_files().reload();
 }
 
 size_t MPQFile::read(void* dest, size_t bytes)
@@ -247,12 +923,12 @@ size_t MPQFile::read(void* dest, size_t bytes)
     return 0;
 
   size_t rpos = pointer + bytes;
-  if (rpos > buffer.size()) {
-    bytes = buffer.size() - pointer;
+  if (rpos > _size) {
+    bytes = _size - pointer;
     eof = true;
   }
 
-  memcpy(dest, &(buffer[pointer]), bytes);
+  memcpy(dest, _data + pointer, bytes);
 
   pointer = rpos;
 
@@ -267,13 +943,13 @@ bool MPQFile::isEof() const
 void MPQFile::seek(size_t offset)
 {
   pointer = offset;
-  eof = (pointer >= buffer.size());
+  eof = (pointer >= _size);
 }
 
 void MPQFile::seekRelative(size_t offset)
 {
   pointer += offset;
-  eof = (pointer >= buffer.size());
+  eof = (pointer >= _size);
 }
 
 void MPQFile::close()
@@ -283,7 +959,7 @@ void MPQFile::close()
 
 size_t MPQFile::getSize() const
 {
-  return buffer.size();
+  return _size;
 }
 
 size_t MPQFile::getPos() const
@@ -293,19 +969,29 @@ size_t MPQFile::getPos() const
 
 char const* MPQFile::getBuffer() const
 {
-  return buffer.data();
+  return _data;
 }
 
 char const* MPQFile::getPointer() const
 {
-  return buffer.data() + pointer;
+  return _data + pointer;
 }
 
-void MPQFile::SaveFile()
+bool MPQFile::SaveFile()
 {
-  LogDebug << "Save file to: " << _disk_path << std::endl;
+  // never write a file through a view of its own old contents
+  if (_mapping)
+  {
+    buffer.assign (_data, _data + _size);
+    _mapping.reset();
+    _data = buffer.data();
+  }
 
-  auto const directory_name (_disk_path.parent_path());
+  boost::filesystem::path const disk_path (loose_project_files().save_path (_filename));
+
+  LogDebug << "Save file to: " << disk_path << std::endl;
+
+  auto const directory_name (disk_path.parent_path());
   boost::system::error_code ec;
   boost::filesystem::create_directories (directory_name, ec);
   if (ec)
@@ -313,16 +999,41 @@ void MPQFile::SaveFile()
     LogError << "Creating directory \"" << directory_name << "\" failed: " << ec << ". Saving is highly likely to fail." << std::endl;
   }
 
-  std::ofstream output(_disk_path.string(), std::ios_base::binary | std::ios_base::out);
+  // written next to the file then renamed over it, so an interrupted
+  // save leaves either the old file or the new one
+  auto const temporary_path
+    (directory_name / boost::filesystem::unique_path (disk_path.filename().string() + ".%%%%%%.tmp"));
+
+  std::ofstream output(temporary_path.string(), std::ios_base::binary | std::ios_base::out);
   if (output.is_open())
   {
-    Log << "Saving file \"" << _disk_path << "\"." << std::endl;
+    Log << "Saving file \"" << disk_path << "\"." << std::endl;
 
-    output.write(buffer.data(), buffer.size());
+    output.write(_data, _size);
     output.close();
 
+    if (!output)
+    {
+      LogError << "Writing \"" << temporary_path << "\" failed, \"" << disk_path << "\" was not saved." << std::endl;
+      boost::filesystem::remove (temporary_path, ec);
+      return false;
+    }
+
+    boost::filesystem::rename (temporary_path, disk_path, ec);
+    if (ec)
+    {
+      LogError << "Replacing \"" << disk_path << "\" failed: " << ec.message() << std::endl;
+      boost::filesystem::remove (temporary_path, ec);
+      return false;
+    }
+
+    loose_project_files().add (_filename);
     External = true;
+    return true;
   }
+
+  LogError << "Could not open \"" << temporary_path << "\" to save \"" << disk_path << "\"." << std::endl;
+  return false;
 }
 
 namespace noggit
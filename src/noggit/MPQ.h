@@ -7,7 +7,13 @@
 #include <StormLib.h>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -17,19 +23,77 @@ class AsyncLoader;
 class MPQArchive;
 class MPQFile;
 
+namespace boost
+{
+  namespace interprocess
+  {
+    class mapped_region;
+  }
+}
+
 extern std::unordered_set<std::string> gListfile;
 
 class MPQArchive : public AsyncObject
 {
   HANDLE _archiveHandle;
 
+  //! StormLib handles are not safe to read from concurrently, so every
+  //! reading thread borrows its own handle to the same archive. Handles
+  //! are opened on demand up to _max_readers and reused afterwards.
+  class scoped_reader
+  {
+  public:
+    scoped_reader (MPQArchive const& archive);
+    ~scoped_reader();
+
+    scoped_reader (scoped_reader const&) = delete;
+    scoped_reader& operator= (scoped_reader const&) = delete;
+
+    HANDLE handle() const { return _handle; }
+
+  private:
+    MPQArchive const& _archive;
+    HANDLE _handle;
+  };
+
+  HANDLE acquire_reader() const;
+  void release_reader (HANDLE) const;
+
+  mutable std::size_t _max_readers;
+  mutable std::size_t _reader_count;
+  mutable std::mutex _readers_guard;
+  mutable std::condition_variable _reader_released;
+  mutable std::vector<HANDLE> _idle_readers;
+  mutable std::vector<HANDLE> _readers;
+
+  //! read-only view of the whole archive on disk, used to hand out
+  //! uncompressed files without copying them. null if mapping failed.
+  std::shared_ptr<boost::interprocess::mapped_region const> _mapping;
+  std::uint64_t _mpq_header_offset;
+
+  //! name hashes of the files the archive holds, as its hash table files
+  //! them. the global file index is built from them once all archives
+  //! finished loading, they are not changed afterwards.
+  std::vector<std::uint64_t> _file_hashes;
+  //! false if the hash table could not be read, the names listed by the
+  //! listfile are hashed instead
+  bool _hash_table_read;
+  //! path, size and modification time of the archive on disk
+  std::string _version;
+
+  //! sets data and size to the file's bytes inside _mapping if the file
+  //! is stored plain (not compressed, encrypted or patched)
+  bool mappedView ( HANDLE fileHandle
+                  , char const** data
+                  , std::size_t* size
+                  ) const;
+
 public:
   MPQArchive(const std::string& filename, bool doListfile);
 
   ~MPQArchive();
 
   bool hasFile(const std::string& filename) const;
-  bool openFile(const std::string& filename, HANDLE* fileHandle) const;
 
   void finishLoading();
   virtual void waitForChildrenLoaded() override {};
@@ -42,19 +106,27 @@ public:
   static void unloadMPQ(const std::string& filename);
 
   friend class MPQFile;
+  friend struct mpq_file_index;
 };
 
 
 class MPQFile
 {
   bool eof;
+  //! owns the data if it had to be copied, otherwise empty
   std::vector<char> buffer;
+  //! keeps the loose file or archive mapping alive while borrowed
+  std::shared_ptr<boost::interprocess::mapped_region const> _mapping;
+  char const* _data;
+  size_t _size;
   size_t pointer;
 
 
   bool External;
-  boost::filesystem::path _disk_path;
-  std::string _mpq_path;
+  //! name relative to the project directory, SaveFile writes there
+  std::string _filename;
+
+  bool readFromArchive (MPQArchive const& archive, char const* stormlib_filename);
 
 public:
   explicit MPQFile(const std::string& pFilename);  // filenames are not case sensitive, the are if u dont use a filesystem which is kinda shitty...
@@ -83,19 +155,44 @@ public:
   template<typename T>
   const T* get(size_t offset) const
   {
-    return reinterpret_cast<T const*>(buffer.data() + offset);
+    return reinterpret_cast<T const*>(_data + offset);
   }
 
   void setBuffer (std::vector<char> const& vec)
   {
     buffer = vec;
+    _mapping.reset();
+    _data = buffer.data();
+    _size = buffer.size();
+  }
+  void setBuffer (std::vector<char>&& vec)
+  {
+    buffer = std::move (vec);
+    _mapping.reset();
+    _data = buffer.data();
+    _size = buffer.size();
   }
 
-  void SaveFile();
+  //! writes the buffer to the file in the project directory, false if
+  //! it could not be written. the previous file is kept in that case
+  bool SaveFile();
 
   static bool exists (std::string const& filename);
   static bool existsOnDisk (std::string const& filename);
 
+  //! where the file is read from and how it is stored there, e.g. its
+  //! size and modification time on disk: changes when the content does,
+  //! without reading it. none if the file does not exist
+  static boost::optional<std::string> version (std::string const& filename);
+
+  //! the project directory is listed once rather than asked for every
+  //! file. SaveFile keeps the listing up to date, files written or removed
+  //! by other means have to be announced.
+  static void project_file_created (std::string const& filename);
+  static void project_file_removed (std::string const& filename);
+  //! lists the project directory again, e.g. after the path changed
+  static void reload_project_files();
+
   friend class MPQArchive;
 };
 
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #include <math/frustum.hpp>
 #include <noggit/Brush.h>
+#include <noggit/chunk_writer.hpp>
 #include <noggit/TileWater.hpp>
 #include <noggit/Log.h>
 #include <noggit/MapChunk.h>
@@ -8,6 +9,7 @@
 #include <noggit/Misc.h>
 #include <noggit/World.h>
 #include <noggit/alphamap.hpp>
+#include <noggit/terrain_blur.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/TexturingGUI.h>
@@ -605,178 +607,9 @@ void MapChunk::recalcExtents()
   }
 }
 
-glm::vec3 MapChunk::getNeighborVertex(int i, unsigned dir)
-{
-  // i - vertex index
-  // 0 - up_left
-  // 1 - up_right
-  // 2 - down_left
-  // 3 - down_right
-
-  // Returns a neighboring vertex,
-  // if one does not exist,
-  // returns a virtual vertex with the height that equals to the height of MapChunks's vertex i.
-
-  constexpr float half_unit = UNITSIZE / 2.f;
-  static constexpr std::array xdiff{-half_unit, half_unit, half_unit, -half_unit};
-  static constexpr std::array zdiff{-half_unit, -half_unit, half_unit, half_unit};
-
-  static constexpr std::array idiff{-9, -8, 9, 8};
-
-  float vertex_x = mVertices[i].x + xdiff[dir];
-  float vertex_z = mVertices[i].z + zdiff[dir];
-
-  tile_index tile({vertex_x, 0, vertex_z});
-  glm::vec3 result{};
-
-  if (tile.x == mt->index.x && tile.z == mt->index.z)
-  {
-    mt->getVertexInternal(vertex_x, vertex_z, &result);
-  }
-  else if (mt->_world->mapIndex.tileLoaded(tile))
-  {
-    mt->_world->mapIndex.getTile(tile)->getVertexInternal(vertex_x, vertex_z, &result);
-  }
-  else
-  {
-    result = {vertex_x, mVertices[i].y,  vertex_z};
-  }
-
-  return result;
-
-  /*
-  if ((i >= 1 && i <= 7 && dir < 2 && !py)
-      || (i >= 137 && i <= 143 && (dir == 2 || dir == 3) && py == 15)
-      || (!i && (dir < 2 && !py || (!dir || dir == 3) && !px))
-      || (i == 8 && ((dir == 1 || dir == 2) && px == 15) || dir < 2 && !py)
-      || (i == 136 && ((dir == 3 || dir == 2) && py == 15) || (!dir || dir == 3) && !px)
-      || (i == 144 && ((dir == 3 || dir == 2) && py == 15) || ((dir == 1 || dir == 2) && px == 15))
-      || (!(i % 17) && (!dir || dir == 3) && !px)
-      || (!(i % 25) && (dir == 1 || dir == 2) && px == 15))
-  {
-    float vertex_x = mVertices[i].x + xdiff[dir];
-    float vertex_z = mVertices[i].z + zdiff[dir];
-
-    tile_index tile({vertex_x, 0, vertex_z});
-
-    if (!mt->_world->mapIndex.tileLoaded(tile))
-    {
-      return glm::vec3( mVertices[i].x + xdiff[dir], mVertices[i].y, mVertices[i].z + zdiff[dir]);
-    }
-
-    glm::vec3 vertex{};
-    mt->_world->mapIndex.getTile(tile)->getVertexInternal(mVertices[i].x + xdiff[dir], mVertices[i].z + zdiff[dir], &vertex);
-
-    return glm::vec3( mVertices[i].x + xdiff[dir], vertex.y, mVertices[i].z + zdiff[dir]);
-
-  }
-
-  switch (dir)
-  {
-    case 0:
-    {
-      if (!i)
-        return mt->getChunk(px - 1, py - 1)->mVertices[135];
-      else if (i == 136)
-        return mt->getChunk(px - 1, py)->mVertices[135];
-      else if (i == 8)
-        return mt->getChunk(px, py - 1)->mVertices[135];
-      else if (i >= 1 && i <= 7)
-        return mt->getChunk(px, py - 1)->mVertices[127 + i];
-      else if (!(i % 17))
-        return mt->getChunk(px - 1, py)->mVertices[i - 1];
-      break;
-    }
-    case 1:
-    {
-      if (!i)
-        return mt->getChunk(px, py - 1)->mVertices[128];
-      else if (i == 144)
-        return mt->getChunk(px + 1, py)->mVertices[128];
-      else if (i == 8)
-        return mt->getChunk(px + 1, py - 1)->mVertices[128];
-      else if (i >= 1 && i <= 7)
-        return mt->getChunk(px, py - 1)->mVertices[128 + i];
-      else if (!(i % 17 % 8) && i % 17 != 16 && i % 17)
-        return mt->getChunk(px + 1, py)->mVertices[i - 8];
-      break;
-    }
-    case 2:
-    {
-      if (i == 136)
-        return mt->getChunk(px, py + 1)->mVertices[9];
-      else if (i == 144)
-        return mt->getChunk(px + 1, py + 1)->mVertices[9];
-      else if (i == 8)
-        return mt->getChunk(px + 1, py)->mVertices[9];
-      else if (!(i % 17 % 8) && i % 17 != 16 && i && i % 17)
-        return mt->getChunk(px + 1, py)->mVertices[i + 9];
-      else if (i >= 137 && i <= 143)
-        return mt->getChunk(px, py + 1)->mVertices[i - 127];
-
-      break;
-    }
-    case 3:
-    {
-      if (!i)
-        return mt->getChunk(px - 1, py)->mVertices[16];
-      else if (i == 136)
-        return mt->getChunk(px - 1, py + 1)->mVertices[16];
-      else if (i == 144)
-        return mt->getChunk(px, py + 1)->mVertices[16];
-      else if (!(i % 17))
-        return mt->getChunk(px - 1, py)->mVertices[i + 16];
-      else if (i >= 137 && i <= 143)
-        return mt->getChunk(px, py + 1)->mVertices[i - 128];
-      break;
-    }
-  }
-
-  return mVertices[i + idiff[dir]];
-
-  */
-}
-
 void MapChunk::recalcNorms()
 {
-  // 0 - up_left
-  // 1 - up_right
-  // 2 - down_left
-  // 3 - down_right
-
-  auto& tile_buffer = mt->getChunkHeightmapBuffer();
-  int chunk_start = (px * 16 + py) * mapbufsize * 4;
-
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    glm::vec3 const P1 (getNeighborVertex(i, 0)); // up_left
-    glm::vec3 const P2 (getNeighborVertex(i, 1)); // up_right
-    glm::vec3 const P3 (getNeighborVertex(i, 2)); // down_left
-    glm::vec3 const P4 (getNeighborVertex(i, 3)); // down_right
-
-    glm::vec3 const N1 = glm::cross((P2 - mVertices[i]) , (P1 - mVertices[i]));
-    glm::vec3 const N2 = glm::cross((P3 - mVertices[i]) , (P2 - mVertices[i]));
-    glm::vec3 const N3 = glm::cross((P4 - mVertices[i]) , (P3 - mVertices[i]));
-    glm::vec3 const N4 = glm::cross((P1 - mVertices[i]) , (P4 - mVertices[i]));
-
-    glm::vec3 Norm (N1 + N2 + N3 + N4);
-    Norm = glm::normalize(Norm);
-
-    Norm.x = std::floor(Norm.x * 127) / 127;
-    Norm.y = std::floor(Norm.y * 127) / 127;
-    Norm.z = std::floor(Norm.z * 127) / 127;
-
-    //! \todo: find out why recalculating normals without changing the terrain result in slightly different normals
-
-    int pixel_start = chunk_start + i * 4;
-    tile_buffer[pixel_start] = -Norm.z;
-    tile_buffer[pixel_start + 1] = Norm.y;
-    tile_buffer[pixel_start + 2] = -Norm.x;
-
-  }
-
-  registerChunkUpdate(ChunkUpdateFlags::NORMALS);
-
+  mt->recalcNorms ({this});
 }
 
 void MapChunk::updateNormalsData()
@@ -1050,7 +883,7 @@ bool MapChunk::blurTerrain ( glm::vec3 const& pos
                            , float radius
                            , int BrushType
                            , flatten_mode const& mode
-                           , std::function<boost::optional<float> (float, float)> height
+                           , noggit::terrain_blur const& blur
                            )
 {
   bool changed (false);
@@ -1069,28 +902,14 @@ bool MapChunk::blurTerrain ( glm::vec3 const& pos
       continue;
     }
 
-    int Rad = (int)(radius / UNITSIZE);
-    float TotalHeight = 0;
-    float TotalWeight = 0;
-    for (int j = -Rad * 2; j <= Rad * 2; ++j)
+    auto const average (blur.average (mVertices[i]));
+
+    if (!average)
     {
-      float tz = pos.z + j * UNITSIZE / 2;
-      for (int k = -Rad; k <= Rad; ++k)
-      {
-        float tx = pos.x + k*UNITSIZE + (j % 2) * UNITSIZE / 2.0f;
-        float dist2 = misc::dist (tx, tz, mVertices[i].x, mVertices[i].z);
-        if (dist2 > radius)
-          continue;
-        auto h (height (tx, tz));
-        if (h)
-        {
-          TotalHeight += (1.0f - dist2 / radius) * h.get();
-          TotalWeight += (1.0f - dist2 / radius);
-        }
-      }
+      continue;
     }
 
-    float target = TotalHeight / TotalWeight;
+    float const target = average.get();
     float& y = mVertices[i].y;
 
     if ((target > y && !mode.raise) || (target < y && !mode.lower))
@@ -1360,18 +1179,48 @@ void MapChunk::setFlag(bool changeto, uint32_t flag)
   registerChunkUpdate(ChunkUpdateFlags::FLAGS);
 }
 
-void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, std::vector<WMOInstance> &lObjectInstances, std::vector<ModelInstance>& lModelInstances)
+void MapChunk::prepare_save(save_data& data)
+{
+  data.alphamaps.clear();
+
+  if (texture_set)
+  {
+    data.alphamaps = texture_set->save_alpha(use_big_alphamap);
+  }
+}
+
+std::size_t MapChunk::save_size(save_data const& data) const
 {
-  int lID;
-  int lMCNK_Size = 0x80;
-  int lMCNK_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0x80);  // This is only the size of the header. More chunks will increase the size.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCNK', lMCNK_Size);
-  lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].offset = lCurrentPosition; // check this
+  std::size_t size = 8 + 0x80;
 
-                                                                                                   // MCNK data
-  lADTFile.Insert(lCurrentPosition + 8, 0x80, reinterpret_cast<char*>(&(header)));
-  MapChunkHeader *lMCNK_header = lADTFile.GetPointer<MapChunkHeader>(lCurrentPosition + 8);
+  size += 8 + mapbufsize * 4; // MCVT
+  size += hasMCCV ? 8 + mapbufsize * sizeof(unsigned int) : 0; // MCCV
+  size += 8 + mapbufsize * 3 + 13; // MCNR
+  size += 8 + (texture_set ? texture_set->num() * 0x10 : 0); // MCLY
+  size += 8 + 4 * (data.doodad_refs.size() + data.object_refs.size()); // MCRF
+  size += has_shadows() ? 8 + 0x200 : 0; // MCSH
+
+  size += 8; // MCAL
+  for (auto const& alpha : data.alphamaps)
+  {
+    size += alpha.size();
+  }
+
+  size += 8; // MCSE
+
+  return size;
+}
+
+void MapChunk::save(noggit::chunk_writer& adt, std::size_t mcin_position, std::map<std::string, int> const& textures, save_data const& data)
+{
+  std::size_t const lMCNK_Position = adt.begin_chunk('MCNK');
+  adt.at<MCIN>(mcin_position + 8)->mEntries[py * 16 + px].offset = lMCNK_Position; // check this
+
+  // MCNK data
+  adt.write(header);
+
+  auto mcnk_header = [&] { return adt.at<MapChunkHeader>(lMCNK_Position + 8); };
+  MapChunkHeader *lMCNK_header = mcnk_header();
 
   header_flags.flags.do_not_fix_alpha_map = 1;
 
@@ -1415,59 +1264,34 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
     *reinterpret_cast<std::uint64_t*>(lMCNK_header->doodadStencil) = 0;
   }
 
-  lCurrentPosition += 8 + 0x80;
-
   // MCVT
-  int lMCVT_Size = mapbufsize * 4;
-
-  lADTFile.Extend(8 + lMCVT_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCVT', lMCVT_Size);
-
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsHeight = lCurrentPosition - lMCNK_Position;
-
-  float* lHeightmap = lADTFile.GetPointer<float>(lCurrentPosition + 8);
+  mcnk_header()->ofsHeight = adt.chunk('MCVT', mapbufsize * 4) - lMCNK_Position;
 
   for (int i = 0; i < mapbufsize; ++i)
-    lHeightmap[i] = mVertices[i].y - mVertices[0].y;
-
-  lCurrentPosition += 8 + lMCVT_Size;
-  lMCNK_Size += 8 + lMCVT_Size;
+    adt.write(mVertices[i].y - mVertices[0].y);
 
   // MCCV
-  int lMCCV_Size = 0;
   if (hasMCCV)
   {
-    lMCCV_Size = mapbufsize * sizeof(unsigned int);
-    lADTFile.Extend(8 + lMCCV_Size);
-    SetChunkHeader(lADTFile, lCurrentPosition, 'MCCV', lMCCV_Size);
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsMCCV = lCurrentPosition - lMCNK_Position;
-
-    unsigned int *lmccv = lADTFile.GetPointer<unsigned int>(lCurrentPosition + 8);
+    mcnk_header()->ofsMCCV = adt.chunk('MCCV', mapbufsize * sizeof(unsigned int)) - lMCNK_Position;
 
     for (int i = 0; i < mapbufsize; ++i)
     {
-      *lmccv++ = ((unsigned char)(mccv[i].z * 127.0f) & 0xFF)
+      unsigned int const mccv_value = ((unsigned char)(mccv[i].z * 127.0f) & 0xFF)
         + (((unsigned char)(mccv[i].y * 127.0f) & 0xFF) << 8)
         + (((unsigned char)(mccv[i].x * 127.0f) & 0xFF) << 16);
+      adt.write(mccv_value);
     }
-
-    lCurrentPosition += 8 + lMCCV_Size;
-    lMCNK_Size += 8 + lMCCV_Size;
   }
   else
   {
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsMCCV = 0;
+    mcnk_header()->ofsMCCV = 0;
   }
 
   // MCNR
-  int lMCNR_Size = mapbufsize * 3;
-
-  lADTFile.Extend(8 + lMCNR_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCNR', lMCNR_Size);
+  mcnk_header()->ofsNormal = adt.chunk('MCNR', mapbufsize * 3) - lMCNK_Position;
 
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsNormal = lCurrentPosition - lMCNK_Position;
-
-  char * lNormals = lADTFile.GetPointer<char>(lCurrentPosition + 8);
+  char* lNormals = adt.at<char>(adt.skip(mapbufsize * 3));
 
   auto& tile_buffer = mt->getChunkHeightmapBuffer();
   int chunk_start = (px * 16 + py) * mapbufsize * 4;
@@ -1481,42 +1305,26 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
     lNormals[i * 3 + 2] = static_cast<char>(tile_buffer[pixel_start + 2] * 127);
   }
 
-  lCurrentPosition += 8 + lMCNR_Size;
-  lMCNK_Size += 8 + lMCNR_Size;
-  //        }
-
   // Unknown MCNR bytes
   // These are not in as we have data or something but just to make the files more blizzlike.
-  //        {
-  lADTFile.Extend(13);
-  lCurrentPosition += 13;
-  lMCNK_Size += 13;
-  //        }
+  adt.skip(13);
 
   // MCLY
-  //        {
   size_t lMCLY_Size = texture_set ? texture_set->num() * 0x10 : 0;
 
-  lADTFile.Extend(8 + lMCLY_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCLY', lMCLY_Size);
-
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsLayer = lCurrentPosition - lMCNK_Position;
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nLayers = texture_set ? texture_set->num() : 0;
-
-  std::vector<std::vector<uint8_t>> alphamaps;
+  mcnk_header()->ofsLayer = adt.chunk('MCLY', lMCLY_Size) - lMCNK_Position;
+  mcnk_header()->nLayers = texture_set ? texture_set->num() : 0;
 
   int lMCAL_Size = 0;
 
   if (texture_set)
   {
-    alphamaps = texture_set->save_alpha(use_big_alphamap);
-
     // MCLY data
     for (size_t j = 0; j < texture_set->num(); ++j)
     {
-      ENTRY_MCLY * lLayer = lADTFile.GetPointer<ENTRY_MCLY>(lCurrentPosition + 8 + 0x10 * j);
+      ENTRY_MCLY * lLayer = adt.at<ENTRY_MCLY>(adt.skip(0x10));
 
-      lLayer->textureID = lTextures.find(texture_set->filename(j))->second;
+      lLayer->textureID = textures.find(texture_set->filename(j))->second;
       lLayer->flags = texture_set->flag(j);
       lLayer->ofsAlpha = lMCAL_Size;
       lLayer->effectID = texture_set->effect(j);
@@ -1531,138 +1339,65 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
         //! \todo find out why compression fuck up textures ingame
         lLayer->flags &= ~FLAG_ALPHA_COMPRESSED;
 
-        lMCAL_Size += alphamaps[j - 1].size();
+        lMCAL_Size += data.alphamaps[j - 1].size();
       }
     }
-
   }
 
-  lCurrentPosition += 8 + lMCLY_Size;
-  lMCNK_Size += 8 + lMCLY_Size;
-  //        }
-
   // MCRF
-  //        {
-  std::list<int> lDoodadIDs;
-  std::list<int> lObjectIDs;
-
-  std::array<glm::vec3, 2> lChunkExtents;
-  lChunkExtents[0] = glm::vec3(xbase, 0.0f, zbase);
-  lChunkExtents[1] = glm::vec3(xbase + CHUNKSIZE, 0.0f, zbase + CHUNKSIZE);
-
-  // search all wmos that are inside this chunk
-  lID = 0;
-  for(auto const& wmo : lObjectInstances)
-  {
-    if (wmo.isInsideRect(&lChunkExtents))
-    {
-      lObjectIDs.push_back(lID);
-    }
-
-    lID++;
-  }
-
-  // search all models that are inside this chunk
-  lID = 0;
-  for(auto const& model : lModelInstances)
-  {
-    if (model.isInsideRect(&lChunkExtents))
-    {
-      lDoodadIDs.push_back(lID);
-    }
-    lID++;
-  }
-
-  int lMCRF_Size = 4 * (lDoodadIDs.size() + lObjectIDs.size());
-  lADTFile.Extend(8 + lMCRF_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCRF', lMCRF_Size);
+  int lMCRF_Size = 4 * (data.doodad_refs.size() + data.object_refs.size());
 
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsRefs = lCurrentPosition - lMCNK_Position;
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nDoodadRefs = lDoodadIDs.size();
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nMapObjRefs = lObjectIDs.size();
+  mcnk_header()->ofsRefs = adt.chunk('MCRF', lMCRF_Size) - lMCNK_Position;
+  mcnk_header()->nDoodadRefs = data.doodad_refs.size();
+  mcnk_header()->nMapObjRefs = data.object_refs.size();
 
   // MCRF data
-  int *lReferences = lADTFile.GetPointer<int>(lCurrentPosition + 8);
-
-  lID = 0;
-  for (std::list<int>::iterator it = lDoodadIDs.begin(); it != lDoodadIDs.end(); ++it)
-  {
-    lReferences[lID] = *it;
-    lID++;
-  }
-
-  for (std::list<int>::iterator it = lObjectIDs.begin(); it != lObjectIDs.end(); ++it)
-  {
-    lReferences[lID] = *it;
-    lID++;
-  }
-
-  lCurrentPosition += 8 + lMCRF_Size;
-  lMCNK_Size += 8 + lMCRF_Size;
-  //        }
+  adt.write(data.doodad_refs.data(), 4 * data.doodad_refs.size());
+  adt.write(data.object_refs.data(), 4 * data.object_refs.size());
 
   // MCSH
   if (has_shadows())
   {
     header_flags.flags.has_mcsh = 1;
 
-    int lMCSH_Size = 0x200;
-    lADTFile.Extend(8 + lMCSH_Size);
-    SetChunkHeader(lADTFile, lCurrentPosition, 'MCSH', lMCSH_Size);
-
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsShadow = lCurrentPosition - lMCNK_Position;
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->sizeShadow = 0x200;
-
-    char * lLayer = lADTFile.GetPointer<char>(lCurrentPosition + 8);
+    mcnk_header()->ofsShadow = adt.chunk('MCSH', 0x200) - lMCNK_Position;
+    mcnk_header()->sizeShadow = 0x200;
 
     auto shadow_map = compressed_shadow_map();
-    memcpy(lLayer, shadow_map.data(), 0x200);
-
-    lCurrentPosition += 8 + lMCSH_Size;
-    lMCNK_Size += 8 + lMCSH_Size;
+    adt.write(shadow_map.data(), 0x200);
   }
   else
   {
     header_flags.flags.has_mcsh = 0;
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsShadow = 0;
-    lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->sizeShadow = 0;
+    mcnk_header()->ofsShadow = 0;
+    mcnk_header()->sizeShadow = 0;
   }
 
   // MCAL
-  lADTFile.Extend(8 + lMCAL_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCAL', lMCAL_Size);
-
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsAlpha = lCurrentPosition - lMCNK_Position;
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->sizeAlpha = 8 + lMCAL_Size;
-
-  char * lAlphaMaps = lADTFile.GetPointer<char>(lCurrentPosition + 8);
+  mcnk_header()->ofsAlpha = adt.chunk('MCAL', lMCAL_Size) - lMCNK_Position;
+  mcnk_header()->sizeAlpha = 8 + lMCAL_Size;
 
-  for (auto& alpha : alphamaps)
+  for (auto const& alpha : data.alphamaps)
   {
-    memcpy(lAlphaMaps, alpha.data(), alpha.size());
-    lAlphaMaps += alpha.size();
+    adt.write(alpha.data(), alpha.size());
   }
 
-  lCurrentPosition += 8 + lMCAL_Size;
-  lMCNK_Size += 8 + lMCAL_Size;
-  //        }
-
   //! Don't write anything MCLQ related anymore...
 
 
   // MCSE
   int lMCSE_Size = 0;
-  lADTFile.Extend(8 + lMCSE_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCSE', lMCSE_Size);
 
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsSndEmitters = lCurrentPosition - lMCNK_Position;
-  lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->nSndEmitters = lMCSE_Size / 0x1C;
+  mcnk_header()->ofsSndEmitters = adt.chunk('MCSE', lMCSE_Size) - lMCNK_Position;
+  mcnk_header()->nSndEmitters = lMCSE_Size / 0x1C;
 
-  lCurrentPosition += 8 + lMCSE_Size;
-  lMCNK_Size += 8 + lMCSE_Size;
+  adt.end_chunk(lMCNK_Position);
+  adt.at<MCIN>(mcin_position + 8)->mEntries[py * 16 + px].size = adt.position() - lMCNK_Position;
+}
 
-  lADTFile.GetPointer<sChunkHeader>(lMCNK_Position)->mSize = lMCNK_Size;
-  lADTFile.GetPointer<MCIN>(lMCIN_Position + 8)->mEntries[py * 16 + px].size = lMCNK_Size + sizeof (sChunkHeader);
+std::size_t MapChunk::memory_usage() const
+{
+  return sizeof(MapChunk) + (texture_set ? texture_set->memory_usage() : 0);
 }
 
 
@@ -27,7 +27,11 @@ namespace math
 }
 class Brush;
 class ChunkWater;
-class sExtendableArray;
+namespace noggit
+{
+  class chunk_writer;
+  class terrain_blur;
+}
 class QPixmap;
 
 using StripType = uint16_t;
@@ -133,13 +137,12 @@ public:
   void recalcExtents();
   void recalcNorms();
   void updateNormalsData();
-  glm::vec3 getNeighborVertex(int i, unsigned dir);
 
   //! \todo implement Action stack for these
   bool changeTerrain(glm::vec3 const& pos, float change, float radius, int BrushType, float inner_radius);
   bool flattenTerrain(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const glm::vec3& origin, math::degrees angle, math::degrees orientation);
   bool blurTerrain ( glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode
-                   , std::function<boost::optional<float> (float, float)> height
+                   , noggit::terrain_blur const& blur
                    );
 
   bool changeTerrainProcessVertex(glm::vec3 const& pos, glm::vec3 const& vertex, float& dt, float radiusOuter, float radiusInner, int brushType);
@@ -179,8 +182,22 @@ public:
 
   void clearHeight();
 
-  //! \todo this is ugly create a build struct or sth
-  void save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, std::vector<WMOInstance> &lObjectInstances, std::vector<ModelInstance>& lModelInstances);
+  //! what save() writes which is computed before the sizes, once
+  struct save_data
+  {
+    std::vector<std::vector<uint8_t>> alphamaps;
+    //! indices in the tile's MDDF and MODF of the instances on the chunk
+    std::vector<int> doodad_refs;
+    std::vector<int> object_refs;
+  };
+
+  void prepare_save(save_data& data);
+  //! the size of the MCNK written by save(), header included
+  std::size_t save_size(save_data const& data) const;
+  void save(noggit::chunk_writer& adt, std::size_t mcin_position, std::map<std::string, int> const& textures, save_data const& data);
+
+  //! the chunk and its texture set, the liquids are owned by the tile
+  std::size_t memory_usage() const;
 
   // fix the gaps with the chunk to the left
   bool fixGapLeft(const MapChunk* chunk);
@@ -10,6 +10,7 @@
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/World.h>
 #include <noggit/alphamap.hpp>
+#include <noggit/chunk_writer.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/ui/TexturingGUI.h>
@@ -19,7 +20,9 @@
 
 #include <QtCore/QSettings>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <list>
 #include <map>
 #include <string>
@@ -77,6 +80,50 @@ MapTile::~MapTile()
   _world->remove_models_if_needed(uids);
 }
 
+std::size_t MapTile::memory_usage() const
+{
+  std::size_t usage = sizeof(MapTile)
+    + _draw_calls.capacity() * sizeof(MapTileDrawCall)
+    + uids.capacity() * sizeof(std::uint32_t)
+    + Water.memory_usage() - sizeof(TileWater);
+
+  for (auto const* filenames : {&mTextureFilenames, &mModelFilenames, &mWMOFilenames})
+  {
+    usage += filenames->capacity() * sizeof(std::string);
+
+    for (std::string const& filename : *filenames)
+    {
+      usage += filename.capacity();
+    }
+  }
+
+  for (auto const& instances : object_instances)
+  {
+    usage += sizeof(instances) + instances.second.capacity() * sizeof(SceneObject*);
+  }
+
+  for (std::size_t z = 0; z < 16; ++z)
+  {
+    for (std::size_t x = 0; x < 16; ++x)
+    {
+      if (mChunks[z][x])
+      {
+        usage += mChunks[z][x]->memory_usage();
+      }
+    }
+  }
+
+  if (_uploaded)
+  {
+    // see uploadTextures()
+    usage += mapbufsize * 256 * (sizeof(glm::vec4) + sizeof(glm::vec3))
+      + 64 * 64 * 256 * (4 + 1)
+      + sizeof(_chunk_instance_data);
+  }
+
+  return usage;
+}
+
 void MapTile::waitForChildrenLoaded()
 {
   for (auto& instance : object_instances)
@@ -506,6 +553,10 @@ void MapTile::draw (opengl::scoped::use_program& mcnk_shader
 
     _selected = is_selected;
 
+    // alphamaps are gathered from all the chunks and uploaded at once
+    static std::vector<std::uint8_t> alphamap_texels (256 * 64 * 64 * 4);
+    std::array<bool, 256> alphamap_updated {};
+
     for (int i = 0; i < 256; ++i)
     {
       int chunk_x = i / 16;
@@ -519,10 +570,12 @@ void MapTile::draw (opengl::scoped::use_program& mcnk_shader
 
       if (flags & ChunkUpdateFlags::ALPHAMAP || _requires_sampler_reset || _texture_not_loaded)
       {
-        gl.activeTexture(GL_TEXTURE0 + 3);
-        gl.bindTexture(GL_TEXTURE_2D_ARRAY, _alphamap_tex);
-        alphamap_bound = true;
-        chunk->texture_set->uploadAlphamapData();
+        std::size_t const layer (chunk->px * 16 + chunk->py);
+
+        if (chunk->texture_set->writeAlphamapTexels(&alphamap_texels[layer * 64 * 64 * 4]))
+        {
+          alphamap_updated[layer] = true;
+        }
 
         if (!_split_drawcall && !fillSamplers(chunk.get(), i, _draw_calls.size() - 1))
         {
@@ -598,6 +651,34 @@ void MapTile::draw (opengl::scoped::use_program& mcnk_shader
 
     }
 
+    // one upload per run of consecutive updated layers
+    for (std::size_t first = 0; first < 256;)
+    {
+      if (!alphamap_updated[first])
+      {
+        ++first;
+        continue;
+      }
+
+      std::size_t last = first + 1;
+      while (last < 256 && alphamap_updated[last])
+      {
+        ++last;
+      }
+
+      if (!alphamap_bound)
+      {
+        gl.activeTexture(GL_TEXTURE0 + 3);
+        gl.bindTexture(GL_TEXTURE_2D_ARRAY, _alphamap_tex);
+        alphamap_bound = true;
+      }
+
+      gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, first, 64, 64, last - first
+                      , GL_RGBA, GL_UNSIGNED_BYTE, &alphamap_texels[first * 64 * 64 * 4]);
+
+      first = last;
+    }
+
     _requires_sampler_reset = false;
 
 
@@ -908,23 +989,214 @@ void MapTile::getVertexInternal(float x, float z, glm::vec3* v)
   mChunks[ycol][xcol]->getVertexInternal(x, z, v);
 }
 
+void MapTile::recalcNorms (std::vector<MapChunk*> const& chunks)
+{
+  ZoneScoped;
+
+  if (chunks.empty())
+  {
+    return;
+  }
+
+  // the chunks' bounding region, in chunks
+  std::size_t begin_x = 16, begin_z = 16, end_x = 0, end_z = 0;
+  std::vector<std::pair<std::size_t, std::size_t>> positions;
+
+  for (MapChunk* chunk : chunks)
+  {
+    std::size_t const x (static_cast<std::size_t> ((chunk->xbase - xbase) / CHUNKSIZE + 0.5f));
+    std::size_t const z (static_cast<std::size_t> ((chunk->zbase - zbase) / CHUNKSIZE + 0.5f));
+
+    assert (x < 16 && z < 16 && mChunks[z][x].get() == chunk);
+
+    positions.emplace_back (x, z);
+    begin_x = std::min (begin_x, x);
+    begin_z = std::min (begin_z, z);
+    end_x = std::max (end_x, x + 1);
+    end_z = std::max (end_z, z + 1);
+  }
+
+  // outer vertices (9x9 per chunk) are surrounded by inner ones (8x8 per
+  // chunk) and the other way around. the outer grid covers the region, the
+  // inner one has an additional vertex all around it taken from the
+  // neighboring chunks, or tiles when these are loaded
+  std::size_t const width (8 * (end_x - begin_x));
+  std::size_t const height (8 * (end_z - begin_z));
+  std::size_t const outer_stride (width + 1);
+  std::size_t const inner_stride (width + 2);
+
+  std::vector<float> outer (outer_stride * (height + 1));
+  std::vector<float> inner (inner_stride * (height + 2));
+  std::vector<char> inner_known (inner.size(), 1);
+
+  for (std::size_t z = begin_z; z < end_z; ++z)
+  {
+    for (std::size_t x = begin_x; x < end_x; ++x)
+    {
+      glm::vec3 const* vertices (mChunks[z][x]->mVertices);
+      std::size_t const column (8 * (x - begin_x));
+      std::size_t const row (8 * (z - begin_z));
+
+      for (std::size_t j = 0; j < 9; ++j)
+      {
+        for (std::size_t i = 0; i < 9; ++i)
+        {
+          outer[(row + j) * outer_stride + column + i] = vertices[17 * j + i].y;
+        }
+      }
+      for (std::size_t j = 0; j < 8; ++j)
+      {
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+          inner[(row + j + 1) * inner_stride + column + i + 1] = vertices[17 * j + 9 + i].y;
+        }
+      }
+    }
+  }
+
+  std::array<MapTile*, 9> neighbors;
+  for (int dz = -1; dz <= 1; ++dz)
+  {
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+      tile_index const tile (index.x + dx, index.z + dz);
+      neighbors[(dz + 1) * 3 + dx + 1]
+        = !dx && !dz ? this
+        : tile.is_valid() && _world->mapIndex.tileLoaded (tile) ? _world->mapIndex.getTile (tile)
+        : nullptr;
+    }
+  }
+
+  // i and j are inner vertex coordinates on the tile, from -1 to 128
+  auto const gather_apron
+    ( [&] (int i, int j, std::size_t apron_index)
+      {
+        MapTile const* tile (neighbors[(j < 0 ? 0 : j < 128 ? 1 : 2) * 3 + (i < 0 ? 0 : i < 128 ? 1 : 2)]);
+
+        if (!tile)
+        {
+          inner_known[apron_index] = 0;
+          return;
+        }
+
+        i = (i + 128) % 128;
+        j = (j + 128) % 128;
+        inner[apron_index] = tile->mChunks[j / 8][i / 8]->mVertices[17 * (j % 8) + 9 + i % 8].y;
+      }
+    );
+
+  int const apron_x (8 * static_cast<int> (begin_x) - 1);
+  int const apron_z (8 * static_cast<int> (begin_z) - 1);
+
+  int const apron_width (static_cast<int> (width) + 1);
+  int const apron_height (static_cast<int> (height) + 1);
+
+  for (int i = 0; i <= apron_width; ++i)
+  {
+    gather_apron (apron_x + i, apron_z, i);
+    gather_apron (apron_x + i, apron_z + apron_height, apron_height * inner_stride + i);
+  }
+  for (int j = 1; j < apron_height; ++j)
+  {
+    gather_apron (apron_x, apron_z + j, j * inner_stride);
+    gather_apron (apron_x + apron_width, apron_z + j, j * inner_stride + apron_width);
+  }
+
+  // with the up left, up right, down right and down left neighbors' heights
+  // being a, b, c and d, the sum of the normals of the four triangles around
+  // a vertex is parallel to ((a + d) - (b + c), 2 * UNITSIZE, (a + b) - (c + d))
+  auto const normal
+    ( [] (float a, float b, float c, float d)
+      {
+        glm::vec3 const n (glm::normalize (glm::vec3 ((a + d) - (b + c), 2.f * UNITSIZE, (a + b) - (c + d))));
+        return glm::floor (n * 127.f) / 127.f;
+      }
+    );
+
+  std::vector<glm::vec3> outer_normals (outer.size());
+  std::vector<glm::vec3> inner_normals (width * height);
+
+  for (std::size_t j = 0; j <= height; ++j)
+  {
+    for (std::size_t i = 0; i <= width; ++i)
+    {
+      // missing neighbors are virtual vertices at the height of the center one
+      float const center (outer[j * outer_stride + i]);
+      auto const neighbor
+        ( [&] (std::size_t k)
+          {
+            return inner_known[k] ? inner[k] : center;
+          }
+        );
+
+      outer_normals[j * outer_stride + i] = normal ( neighbor (j * inner_stride + i)
+                                                   , neighbor (j * inner_stride + i + 1)
+                                                   , neighbor ((j + 1) * inner_stride + i + 1)
+                                                   , neighbor ((j + 1) * inner_stride + i)
+                                                   );
+    }
+  }
+
+  for (std::size_t j = 0; j < height; ++j)
+  {
+    for (std::size_t i = 0; i < width; ++i)
+    {
+      inner_normals[j * width + i] = normal ( outer[j * outer_stride + i]
+                                            , outer[j * outer_stride + i + 1]
+                                            , outer[(j + 1) * outer_stride + i + 1]
+                                            , outer[(j + 1) * outer_stride + i]
+                                            );
+    }
+  }
+
+  for (std::size_t c = 0; c < chunks.size(); ++c)
+  {
+    MapChunk* chunk (chunks[c]);
+    std::size_t const column (8 * (positions[c].first - begin_x));
+    std::size_t const row (8 * (positions[c].second - begin_z));
+    float* normals (&_chunk_heightmap_buffer[(chunk->px * 16 + chunk->py) * mapbufsize * 4]);
+
+    for (std::size_t j = 0; j < 17; ++j)
+    {
+      bool const is_inner (j % 2);
+      std::size_t const count (is_inner ? 8 : 9);
+
+      for (std::size_t i = 0; i < count; ++i, normals += 4)
+      {
+        glm::vec3 const& n
+          ( is_inner
+          ? inner_normals[(row + j / 2) * width + column + i]
+          : outer_normals[(row + j / 2) * outer_stride + column + i]
+          );
+
+        normals[0] = -n.z;
+        normals[1] = n.y;
+        normals[2] = -n.x;
+      }
+    }
+
+    chunk->registerChunkUpdate (ChunkUpdateFlags::NORMALS);
+  }
+}
+
 /// --- Only saving related below this line. --------------------------
 
-void MapTile::saveTile(World* world)
+bool MapTile::saveTile(World* world)
 {
   Log << "Saving ADT \"" << filename << "\"." << std::endl;
 
   int lID;  // This is a global counting variable. Do not store something in here you need later.
-  std::vector<WMOInstance> lObjectInstances;
-  std::vector<ModelInstance> lModelInstances;
+  std::vector<WMOInstance*> lObjectInstances;
+  std::vector<ModelInstance*> lModelInstances;
 
-  // Check which doodads and WMOs are on this ADT.
-  glm::vec3 lTileExtents[2];
-  lTileExtents[0] = glm::vec3(xbase, 0.0f, zbase);
-  lTileExtents[1] = glm::vec3(xbase + TILESIZE, 0.0f, zbase + TILESIZE);
+  std::vector<std::uint32_t> lUIDs;
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    lUIDs = uids;
+  }
 
   // get every models on the tile
-  for (std::uint32_t uid : uids)
+  for (std::uint32_t uid : lUIDs)
   {
     auto model = world->get_model(uid);
 
@@ -940,17 +1212,25 @@ void MapTile::saveTile(World* world)
         auto which = boost::get<selected_object_type>(model.get())->which();
         if (which == eWMO)
         {
-          lObjectInstances.emplace_back(*static_cast<WMOInstance*>(boost::get<selected_object_type>(model.get())));
+          lObjectInstances.push_back(static_cast<WMOInstance*>(boost::get<selected_object_type>(model.get())));
         }
         else if (which == eMODEL)
         {
-          lModelInstances.emplace_back(*static_cast<ModelInstance*>(boost::get<selected_object_type>(model.get())));
+          lModelInstances.push_back(static_cast<ModelInstance*>(boost::get<selected_object_type>(model.get())));
         }
 
       }
     }
   }
 
+  if(world->mapIndex.sort_models_by_size_class())
+  {
+    std::sort(lModelInstances.begin(), lModelInstances.end(), [](ModelInstance const* m1, ModelInstance const* m2)
+    {
+      return m1->size_cat > m2->size_cat;
+    });
+  }
+
   struct filenameOffsetThing
   {
     int nameID;
@@ -961,34 +1241,16 @@ void MapTile::saveTile(World* world)
 
   std::map<std::string, filenameOffsetThing> lModels;
 
-  for (auto const& model : lModelInstances)
+  for (auto const* model : lModelInstances)
   {
-    if (lModels.find(model.model->filename) == lModels.end())
-    {
-      lModels.emplace (model.model->filename, nullyThing);
-    }
-  }
-
-  lID = 0;
-  for (auto& model : lModels)
-  {
-    model.second.nameID = lID++;
+    lModels.emplace (model->model->filename, nullyThing);
   }
 
   std::map<std::string, filenameOffsetThing> lObjects;
 
-  for (auto const& object : lObjectInstances)
+  for (auto const* object : lObjectInstances)
   {
-    if (lObjects.find(object.wmo->filename) == lObjects.end())
-    {
-      lObjects.emplace (object.wmo->filename, nullyThing);
-    }
-  }
-
-  lID = 0;
-  for (auto& object : lObjects)
-  {
-    object.second.nameID = lID++;
+    lObjects.emplace (object->wmo->filename, nullyThing);
   }
 
   // Check which textures are on this ADT.
@@ -1005,296 +1267,293 @@ void MapTile::saveTile(World* world)
 
       for (size_t tex = 0; tex < mChunks[i][j]->texture_set->num(); tex++)
       {
-        if (lTextures.find(mChunks[i][j]->texture_set->filename(tex)) == lTextures.end())
+        lTextures.emplace(mChunks[i][j]->texture_set->filename(tex), -1);
+      }
+    }
+  }
+
+  // Every chunk references the instances overlapping it. They are bucketed
+  // by the chunks around their extents, the exact test only runs on those.
+  std::vector<MapChunk::save_data> lChunkData(16 * 16);
+
+  auto add_references = [&] (SceneObject const* instance, int id, std::vector<int> MapChunk::save_data::* refs)
+  {
+    auto chunk_index = [] (float position, float base)
+    {
+      return static_cast<int>(std::clamp(std::floor((position - base) / CHUNKSIZE), 0.f, 15.f));
+    };
+
+    // one more chunk on each side as the chunk bases are not exact multiples
+    int const x_begin = std::max(chunk_index(instance->extents[0].x, xbase) - 1, 0);
+    int const x_end = std::min(chunk_index(instance->extents[1].x, xbase) + 1, 15);
+    int const z_begin = std::max(chunk_index(instance->extents[0].z, zbase) - 1, 0);
+    int const z_end = std::min(chunk_index(instance->extents[1].z, zbase) + 1, 15);
+
+    for (int z = z_begin; z <= z_end; ++z)
+    {
+      for (int x = x_begin; x <= x_end; ++x)
+      {
+        MapChunk const* chunk = mChunks[z][x].get();
+
+        std::array<glm::vec3, 2> lChunkExtents;
+        lChunkExtents[0] = glm::vec3(chunk->xbase, 0.0f, chunk->zbase);
+        lChunkExtents[1] = glm::vec3(chunk->xbase + CHUNKSIZE, 0.0f, chunk->zbase + CHUNKSIZE);
+
+        if (instance->isInsideRect(&lChunkExtents))
         {
-          lTextures.emplace(mChunks[i][j]->texture_set->filename(tex), -1);
+          (lChunkData[z * 16 + x].*refs).push_back(id);
         }
       }
     }
+  };
+
+  lID = 0;
+  for (auto const* model : lModelInstances)
+  {
+    add_references(model, lID++, &MapChunk::save_data::doodad_refs);
+  }
+
+  lID = 0;
+  for (auto const* object : lObjectInstances)
+  {
+    add_references(object, lID++, &MapChunk::save_data::object_refs);
   }
 
+  // Compute the size of the file, setting the name ids and offsets on the way.
+  std::size_t lFileSize = 8 + 0x4 + 8 + 0x40 + 8 + 256 * 0x10;
+
+  lFileSize += 8;
   lID = 0;
   for (auto& texture : lTextures)
+  {
     texture.second = lID++;
+    lFileSize += texture.first.size() + 1;
+  }
 
-  // Now write the file.
-  sExtendableArray lADTFile;
+  int lMMDX_Size = 0;
+  lID = 0;
+  for (auto& model : lModels)
+  {
+    model.second.nameID = lID++;
+    model.second.filenamePosition = lMMDX_Size;
+    lMMDX_Size += model.first.size() + 1;
+  }
+  lFileSize += 8 + lMMDX_Size + 8 + 4 * lModels.size();
 
-  int lCurrentPosition = 0;
+  int lMWMO_Size = 0;
+  lID = 0;
+  for (auto& object : lObjects)
+  {
+    object.second.nameID = lID++;
+    object.second.filenamePosition = lMWMO_Size;
+    lMWMO_Size += object.first.size() + 1;
+  }
+  lFileSize += 8 + lMWMO_Size + 8 + 4 * lObjects.size();
 
-  // MVER
-  lADTFile.Extend(8 + 0x4);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MVER', 4);
+  lFileSize += 8 + 0x24 * lModelInstances.size();
+  lFileSize += 8 + 0x40 * lObjectInstances.size();
 
-  // MVER data
-  *(lADTFile.GetPointer<int>(8)) = 18;
-  lCurrentPosition += 8 + 0x4;
+  std::size_t const lMH2O_Size = Water.save_size();
+  lFileSize += lMH2O_Size;
 
-  // MHDR
-  int lMHDR_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0x40);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MHDR', 0x40);
+  for (int y = 0; y < 16; ++y)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      mChunks[y][x]->prepare_save(lChunkData[y * 16 + x]);
+      lFileSize += mChunks[y][x]->save_size(lChunkData[y * 16 + x]);
+    }
+  }
 
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->flags = mFlags;
+  if (mFlags & 1)
+  {
+    lFileSize += 8 + sizeof(int16_t) * 9 * 2;
+  }
 
-  lCurrentPosition += 8 + 0x40;
+  // Now write the file.
+  noggit::chunk_writer lADTFile(lFileSize);
 
+  // MVER
+  lADTFile.chunk('MVER', 4);
+  lADTFile.write(18);
 
-  // MCIN
-  int lMCIN_Position = lCurrentPosition;
+  // MHDR
+  std::size_t const lMHDR_Position = lADTFile.chunk('MHDR', 0x40);
+  lADTFile.skip(0x40);
 
-  lADTFile.Extend(8 + 256 * 0x10);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MCIN', 256 * 0x10);
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mcin = lCurrentPosition - 0x14;
+  auto mhdr = [&] { return lADTFile.at<MHDR>(lMHDR_Position + 8); };
+  mhdr()->flags = mFlags;
 
-  lCurrentPosition += 8 + 256 * 0x10;
+  // MCIN
+  std::size_t const lMCIN_Position = lADTFile.chunk('MCIN', 256 * 0x10);
+  mhdr()->mcin = lMCIN_Position - 0x14;
+  lADTFile.skip(256 * 0x10);
 
   // MTEX
-  int lMTEX_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MTEX');
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mtex = lCurrentPosition - 0x14;
-
-  lCurrentPosition += 8 + 0;
+  std::size_t const lMTEX_Position = lADTFile.begin_chunk('MTEX');
+  mhdr()->mtex = lMTEX_Position - 0x14;
 
   // MTEX data
   for (auto const& texture : lTextures)
   {
-    lADTFile.Insert(lCurrentPosition, texture.first.size() + 1, texture.first.c_str());
-
-    lCurrentPosition += texture.first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMTEX_Position)->mSize += texture.first.size() + 1;
+    lADTFile.write(texture.first);
     LogDebug << "Added texture \"" << texture.first << "\"." << std::endl;
   }
 
-  // MMDX
-  int lMMDX_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MMDX');
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mmdx = lCurrentPosition - 0x14;
+  lADTFile.end_chunk(lMTEX_Position);
 
-  lCurrentPosition += 8 + 0;
+  // MMDX
+  mhdr()->mmdx = lADTFile.chunk('MMDX', lMMDX_Size) - 0x14;
 
   // MMDX data
-  for (auto it = lModels.begin(); it != lModels.end(); ++it)
+  for (auto const& model : lModels)
   {
-    it->second.filenamePosition = lADTFile.GetPointer<sChunkHeader>(lMMDX_Position)->mSize;
-    lADTFile.Insert(lCurrentPosition, it->first.size() + 1, misc::normalize_adt_filename(it->first).c_str());
-    lCurrentPosition += it->first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMMDX_Position)->mSize += it->first.size() + 1;
-    LogDebug << "Added model \"" << it->first << "\"." << std::endl;
+    lADTFile.write(misc::normalize_adt_filename(model.first));
+    LogDebug << "Added model \"" << model.first << "\"." << std::endl;
   }
 
   // MMID
   // M2 model names
-  int lMMID_Size = 4 * lModels.size();
-  lADTFile.Extend(8 + lMMID_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MMID', lMMID_Size);
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mmid = lCurrentPosition - 0x14;
+  mhdr()->mmid = lADTFile.chunk('MMID', 4 * lModels.size()) - 0x14;
 
   // MMID data
-  // WMO model names
-  int * lMMID_Data = lADTFile.GetPointer<int>(lCurrentPosition + 8);
-
-  lID = 0;
   for (auto const& model : lModels)
   {
-    lMMID_Data[lID] = model.second.filenamePosition;
-    lID++;
+    lADTFile.write(model.second.filenamePosition);
   }
-  lCurrentPosition += 8 + lMMID_Size;
-  
-  // MWMO
-  int lMWMO_Position = lCurrentPosition;
-  lADTFile.Extend(8 + 0);  // We don't yet know how big this will be.
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MWMO');
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mwmo = lCurrentPosition - 0x14;
 
-  lCurrentPosition += 8 + 0;
+  // MWMO
+  mhdr()->mwmo = lADTFile.chunk('MWMO', lMWMO_Size) - 0x14;
 
   // MWMO data
-  for (auto& object : lObjects)
+  for (auto const& object : lObjects)
   {
-    object.second.filenamePosition = lADTFile.GetPointer<sChunkHeader>(lMWMO_Position)->mSize;
-    lADTFile.Insert(lCurrentPosition, object.first.size() + 1, misc::normalize_adt_filename(object.first).c_str());
-    lCurrentPosition += object.first.size() + 1;
-    lADTFile.GetPointer<sChunkHeader>(lMWMO_Position)->mSize += object.first.size() + 1;
+    lADTFile.write(misc::normalize_adt_filename(object.first));
     LogDebug << "Added object \"" << object.first << "\"." << std::endl;
   }
 
   // MWID
-  int lMWID_Size = 4 * lObjects.size();
-  lADTFile.Extend(8 + lMWID_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MWID', lMWID_Size);
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mwid = lCurrentPosition - 0x14;
+  // WMO model names
+  mhdr()->mwid = lADTFile.chunk('MWID', 4 * lObjects.size()) - 0x14;
 
   // MWID data
-  int * lMWID_Data = lADTFile.GetPointer<int>(lCurrentPosition + 8);
-
-  lID = 0;
   for (auto const& object : lObjects)
-    lMWID_Data[lID++] = object.second.filenamePosition;
-
-  lCurrentPosition += 8 + lMWID_Size;
+  {
+    lADTFile.write(object.second.filenamePosition);
+  }
 
   // MDDF
-  int lMDDF_Size = 0x24 * lModelInstances.size();
-  lADTFile.Extend(8 + lMDDF_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MDDF', lMDDF_Size);
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mddf = lCurrentPosition - 0x14;
+  mhdr()->mddf = lADTFile.chunk('MDDF', 0x24 * lModelInstances.size()) - 0x14;
 
   // MDDF data
-  ENTRY_MDDF* lMDDF_Data = lADTFile.GetPointer<ENTRY_MDDF>(lCurrentPosition + 8);
-
-  if(world->mapIndex.sort_models_by_size_class())
+  for (auto const* model : lModelInstances)
   {
-    std::sort(lModelInstances.begin(), lModelInstances.end(), [](ModelInstance const& m1, ModelInstance const& m2)
-    {
-      return m1.size_cat > m2.size_cat;
-    });
-  }
+    ENTRY_MDDF lMDDF_Data;
 
-  lID = 0;
-  for (auto const& model : lModelInstances)
-  {
-    auto filename_to_offset_and_name = lModels.find(model.model->filename);
-    if (filename_to_offset_and_name == lModels.end())
-    {
-      LogError << "There is a problem with saving the doodads. We have a doodad that somehow changed the name during the saving function. However this got produced, you can get a reward from schlumpf by pasting him this line." << std::endl;
-      return;
-    }
+    lMDDF_Data.nameID = lModels.at(model->model->filename).nameID;
+    lMDDF_Data.uniqueID = model->uid;
+    lMDDF_Data.pos[0] = model->pos.x;
+    lMDDF_Data.pos[1] = model->pos.y;
+    lMDDF_Data.pos[2] = model->pos.z;
+    lMDDF_Data.rot[0] = model->dir.x;
+    lMDDF_Data.rot[1] = model->dir.y;
+    lMDDF_Data.rot[2] = model->dir.z;
+    lMDDF_Data.scale = (uint16_t)(model->scale * 1024);
+    lMDDF_Data.flags = 0;
 
-    lMDDF_Data[lID].nameID = filename_to_offset_and_name->second.nameID;
-    lMDDF_Data[lID].uniqueID = model.uid;
-    lMDDF_Data[lID].pos[0] = model.pos.x;
-    lMDDF_Data[lID].pos[1] = model.pos.y;
-    lMDDF_Data[lID].pos[2] = model.pos.z;
-    lMDDF_Data[lID].rot[0] = model.dir.x;
-    lMDDF_Data[lID].rot[1] = model.dir.y;
-    lMDDF_Data[lID].rot[2] = model.dir.z;
-    lMDDF_Data[lID].scale = (uint16_t)(model.scale * 1024);
-    lMDDF_Data[lID].flags = 0;
-    lID++;
+    lADTFile.write(lMDDF_Data);
   }
 
-  lCurrentPosition += 8 + lMDDF_Size;
-
-  LogDebug << "Added " << lID << " doodads to MDDF" << std::endl;
+  LogDebug << "Added " << lModelInstances.size() << " doodads to MDDF" << std::endl;
 
   // MODF
-  int lMODF_Size = 0x40 * lObjectInstances.size();
-  lADTFile.Extend(8 + lMODF_Size);
-  SetChunkHeader(lADTFile, lCurrentPosition, 'MODF', lMODF_Size);
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->modf = lCurrentPosition - 0x14;
+  mhdr()->modf = lADTFile.chunk('MODF', 0x40 * lObjectInstances.size()) - 0x14;
 
   // MODF data
-  ENTRY_MODF *lMODF_Data = lADTFile.GetPointer<ENTRY_MODF>(lCurrentPosition + 8);
-
-  lID = 0;
-  for (auto const& object : lObjectInstances)
+  for (auto const* object : lObjectInstances)
   {
-    auto filename_to_offset_and_name = lObjects.find(object.wmo->filename);
-    if (filename_to_offset_and_name == lObjects.end())
-    {
-      LogError << "There is a problem with saving the objects. We have an object that somehow changed the name during the saving function. However this got produced, you can get a reward from schlumpf by pasting him this line." << std::endl;
-      return;
-    }
+    ENTRY_MODF lMODF_Data;
 
-    lMODF_Data[lID].nameID = filename_to_offset_and_name->second.nameID;
-    lMODF_Data[lID].uniqueID = object.uid;
-    lMODF_Data[lID].pos[0] = object.pos.x;
-    lMODF_Data[lID].pos[1] = object.pos.y;
-    lMODF_Data[lID].pos[2] = object.pos.z;
+    lMODF_Data.nameID = lObjects.at(object->wmo->filename).nameID;
+    lMODF_Data.uniqueID = object->uid;
+    lMODF_Data.pos[0] = object->pos.x;
+    lMODF_Data.pos[1] = object->pos.y;
+    lMODF_Data.pos[2] = object->pos.z;
 
-    lMODF_Data[lID].rot[0] = object.dir.x;
-    lMODF_Data[lID].rot[1] = object.dir.y;
-    lMODF_Data[lID].rot[2] = object.dir.z;
+    lMODF_Data.rot[0] = object->dir.x;
+    lMODF_Data.rot[1] = object->dir.y;
+    lMODF_Data.rot[2] = object->dir.z;
 
-    lMODF_Data[lID].extents[0][0] = object.extents[0].x;
-    lMODF_Data[lID].extents[0][1] = object.extents[0].y;
-    lMODF_Data[lID].extents[0][2] = object.extents[0].z;
+    lMODF_Data.extents[0][0] = object->extents[0].x;
+    lMODF_Data.extents[0][1] = object->extents[0].y;
+    lMODF_Data.extents[0][2] = object->extents[0].z;
 
-    lMODF_Data[lID].extents[1][0] = object.extents[1].x;
-    lMODF_Data[lID].extents[1][1] = object.extents[1].y;
-    lMODF_Data[lID].extents[1][2] = object.extents[1].z;
+    lMODF_Data.extents[1][0] = object->extents[1].x;
+    lMODF_Data.extents[1][1] = object->extents[1].y;
+    lMODF_Data.extents[1][2] = object->extents[1].z;
 
-    lMODF_Data[lID].flags = object.mFlags;
-    lMODF_Data[lID].doodadSet = object.doodadset();
-    lMODF_Data[lID].nameSet = object.mNameset;
-    lMODF_Data[lID].unknown = object.mUnknown;
-    lID++;
-  }
+    lMODF_Data.flags = object->mFlags;
+    lMODF_Data.doodadSet = object->doodadset();
+    lMODF_Data.nameSet = object->mNameset;
+    lMODF_Data.unknown = object->mUnknown;
 
-  LogDebug << "Added " << lID << " wmos to MODF" << std::endl;
+    lADTFile.write(lMODF_Data);
+  }
 
-  lCurrentPosition += 8 + lMODF_Size;
+  LogDebug << "Added " << lObjectInstances.size() << " wmos to MODF" << std::endl;
 
   //MH2O
-  Water.saveToFile(lADTFile, lMHDR_Position, lCurrentPosition);
+  if (lMH2O_Size)
+  {
+    Water.saveToFile(lADTFile, lMHDR_Position);
+  }
 
   // MCNK
   for (int y = 0; y < 16; ++y)
   {
     for (int x = 0; x < 16; ++x)
     {
-      mChunks[y][x]->save(lADTFile, lCurrentPosition, lMCIN_Position, lTextures, lObjectInstances, lModelInstances);
+      mChunks[y][x]->save(lADTFile, lMCIN_Position, lTextures, lChunkData[y * 16 + x]);
     }
   }
 
   // MFBO
   if (mFlags & 1)
   {
-    size_t chunkSize = sizeof(int16_t) * 9 * 2;
-    lADTFile.Extend(8 + chunkSize);
-    SetChunkHeader(lADTFile, lCurrentPosition, 'MFBO', chunkSize);
-    lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mfbo = lCurrentPosition - 0x14;
-
-    int16_t *lMFBO_Data = lADTFile.GetPointer<int16_t>(lCurrentPosition + 8);
-
-    lID = 0;
+    mhdr()->mfbo = lADTFile.chunk('MFBO', sizeof(int16_t) * 9 * 2) - 0x14;
 
     for (int i = 0; i < 9; ++i)
-      lMFBO_Data[lID++] = (int16_t)mMaximumValues[i].y;
+      lADTFile.write((int16_t)mMaximumValues[i].y);
 
     for (int i = 0; i < 9; ++i)
-      lMFBO_Data[lID++] = (int16_t)mMinimumValues[i].y;
-
-    lCurrentPosition += 8 + chunkSize;
+      lADTFile.write((int16_t)mMinimumValues[i].y);
   }
 
   //! \todo Do not do bullshit here in MTFX.
 #if 0
   if (!mTextureEffects.empty()) {
     //! \todo check if nTexEffects == nTextures, correct order etc.
-    lADTFile.Extend(8 + 4 * mTextureEffects.size());
-    SetChunkHeader(lADTFile, lCurrentPosition, 'MTFX', 4 * mTextureEffects.size());
-    lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mtfx = lCurrentPosition - 0x14;
-
-    uint32_t* lMTFX_Data = lADTFile.GetPointer<uint32_t>(lCurrentPosition + 8);
+    mhdr()->mtfx = lADTFile.chunk('MTFX', 4 * mTextureEffects.size()) - 0x14;
 
-    lID = 0;
     //they should be in the correct order...
     for (auto const& effect : mTextureEffects)
     {
-      lMTFX_Data[lID] = effect;
-      ++lID;
+      lADTFile.write(effect);
     }
-    lCurrentPosition += 8 + sizeof(uint32_t) * mTextureEffects.size();
   }
 #endif
 
-  lADTFile.Extend(lCurrentPosition - lADTFile.data.size()); // cleaning unused nulls at the end of file
-
-
+  // the two passes disagree on what the tile holds, the file written
+  // would not match its own offsets. the previous one is kept instead
+  if (lADTFile.remaining())
   {
-    MPQFile f(filename);
-    f.setBuffer(lADTFile.data);
-    f.SaveFile();
+    LogError << "The size of \"" << filename << "\" was off by " << lADTFile.remaining() << " bytes while saving, the file was not saved." << std::endl;
+    return false;
   }
 
-  lObjectInstances.clear();
-  lModelInstances.clear();
-  lModels.clear();
+  MPQFile f(filename);
+  f.setBuffer(std::move(lADTFile.data()));
+  return f.SaveFile();
 }
 
 
@@ -1864,7 +2123,7 @@ void MapTile::uploadTextures()
 
   gl.activeTexture(GL_TEXTURE0 + 4);
   gl.bindTexture(GL_TEXTURE_2D_ARRAY, _alphamap_tex);
-  gl.texImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, 64, 64, 256, 0, GL_RGB, GL_FLOAT,nullptr);
+  gl.texImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 64, 64, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE,nullptr);
 
   gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   gl.texParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -114,7 +114,13 @@ public:
   bool GetVertex(float x, float z, glm::vec3 *V);
   void getVertexInternal(float x, float z, glm::vec3* v);
 
-  void saveTile(World*);
+  //! recomputes the normals of the given chunks of this tile from a height
+  //! grid of their bounding region, completed by one vertex of the
+  //! neighboring chunks and tiles
+  void recalcNorms (std::vector<MapChunk*> const& chunks);
+
+  //! false if the file could not be written
+  bool saveTile(World*);
 	void CropWater();
 
   bool isTile(int pX, int pZ);
@@ -164,6 +170,10 @@ public:
 
   void unload();
 
+  //! the main and video memory held by this tile alone, its chunks and
+  //! liquids included. models and textures are shared and not counted
+  std::size_t memory_usage() const;
+
   GLuint getAlphamapTextureHandle() { return _alphamap_tex; };
   World* getWorld() { return _world; };
 
@@ -3224,7 +3224,7 @@ void MapView::tick (float dt)
   noggit::ActionManager::instance()->endActionOnModalityMismatch(action_modality);
 
   // start unloading tiles
-  _world->mapIndex.enterTile (tile_index (_camera.position));
+  _world->mapIndex.enterTile (_camera.position, dt);
   _world->mapIndex.unloadTiles (tile_index (_camera.position));
 
   dt = std::min(dt, 1.0f);
@@ -3890,8 +3890,13 @@ void MapView::tick (float dt)
     _last_fps_update = 0.f;
   }
 
+  auto const& streaming = _world->mapIndex.streamingStats();
   _status_culling->setText ( "Loaded tiles: " + QString::number(_world->getNumLoadedTiles())
                          + " Rendered tiles: " + QString::number(_world->getNumRenderedTiles())
+                         + " Resident: " + QString::number(streaming.resident_bytes / (1024 * 1024)) + "MB"
+                         + " Streaming hit rate: " + QString::number(int (streaming.hit_rate() * 100.f)) + "%"
+                         + " Unused prefetches: " + QString::number(streaming.prefetched_unused)
+                         + "/" + QString::number(streaming.prefetched)
   );
 
   guiWater->updatePos (_camera.position);
@@ -5045,19 +5050,53 @@ void MapView::save(save_mode mode)
     makeCurrent();
     opengl::context::scoped_setter const _ (::gl, context());
 
+    QProgressDialog progress_dialog ("Saving map...", QString(), 0, 0, this);
+    progress_dialog.setWindowModality (Qt::WindowModal);
+    progress_dialog.setMinimumDuration (500);
+
+    auto const progress ( [&] (std::size_t saved, std::size_t total)
+                          {
+                            progress_dialog.setMaximum (static_cast<int> (total));
+                            progress_dialog.setValue (static_cast<int> (saved));
+                          }
+                        );
+
+    std::vector<std::string> failed;
+
     switch (mode)
     {
-    case save_mode::current: _world->mapIndex.saveTile(tile_index(_camera.position), _world.get()); break;
-    case save_mode::changed: _world->mapIndex.saveChanged(_world.get()); break;
-    case save_mode::all:     _world->mapIndex.saveall(_world.get()); break;
-    }    
+    case save_mode::current: failed = _world->mapIndex.saveTile(tile_index(_camera.position), _world.get()); break;
+    case save_mode::changed: failed = _world->mapIndex.saveChanged(_world.get(), false, progress); break;
+    case save_mode::all:     failed = _world->mapIndex.saveall(_world.get(), progress); break;
+    }
 
-    noggit::ActionManager::instance()->purge();
-    AsyncLoader::instance().reset_object_fail();
+    progress_dialog.reset();
 
+    if (failed.empty())
+    {
+      noggit::ActionManager::instance()->purge();
+      AsyncLoader::instance().reset_object_fail();
 
-    _main_window->statusBar()->showMessage("Map saved", 2000);
+      _main_window->statusBar()->showMessage("Map saved", 2000);
+    }
+    else
+    {
+      // the failed tiles are still marked as changed, saving again retries them
+      QStringList files;
+      for (auto const& file : failed)
+      {
+        files << QString::fromStdString (file);
+      }
 
+      QMessageBox::warning
+        ( nullptr
+        , "Map partially saved"
+        , "The following files could NOT be written, their changes are not saved:\n\n"
+          + files.join ("\n")
+          + "\n\nCheck the log file and the project directory, then save again."
+        , QMessageBox::Ok
+        );
+    }
   }
   else
   {
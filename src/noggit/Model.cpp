@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <cassert>
 #include <map>
+#include <set>
 #include <string>
 #include <glm/gtx/quaternion.hpp>
 
@@ -76,6 +77,8 @@ void Model::finishLoading()
 
   f.close();
 
+  build_bvh();
+
   finished = true;
   _state_changed.notify_all();
 }
@@ -1112,6 +1115,38 @@ void Model::initAnimated(const MPQFile& f)
       bones.emplace_back(f, mb[i], _global_sequences.data(), animation_files);
     }
 
+    std::vector<bool> ordered (bones.size(), false);
+    std::vector<std::size_t> ancestors;
+    _bone_order.reserve (bones.size());
+
+    for (std::size_t i = 0; i < bones.size(); ++i)
+    {
+      // the bone and its ancestors not ordered yet, the bounded walk
+      // guards against broken files with cyclic parents
+      ancestors.clear();
+      for ( std::size_t b = i
+          ; !ordered[b] && ancestors.size() < bones.size()
+          ; b = bones[b].parent
+          )
+      {
+        ancestors.push_back (b);
+
+        if (bones[b].parent < 0 || bones[b].parent >= static_cast<int> (bones.size()))
+        {
+          break;
+        }
+      }
+
+      for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+      {
+        if (!ordered[*it])
+        {
+          ordered[*it] = true;
+          _bone_order.push_back (*it);
+        }
+      }
+    }
+
     bone_matrices.resize(bones.size());
   }  
 
@@ -1174,19 +1209,47 @@ void Model::calcBones(glm::mat4x4 const& model_view
                      , int animation_time
                      )
 {
-  for (size_t i = 0; i<header.nBones; ++i)
+  for (std::size_t i : _bone_order)
   {
-    bones[i].calc = false;
+    bones[i].calcMatrix(model_view, bones.data(), _anim, time, animation_time);
   }
+}
 
-  for (size_t i = 0; i<header.nBones; ++i)
+bool Model::needs_animation(glm::mat4x4 const& model_view, int animtime) const
+{
+  return animated
+    && ( !animcalc
+       || (_per_instance_animation && (model_view != _animated_model_view || animtime != _animated_time))
+       );
+}
+
+void Model::prepare_animation(glm::mat4x4 const& model_view, int animtime)
+{
+  if (finishedLoading() && !loading_failed() && needs_animation(model_view, animtime))
   {
-    bones[i].calcMatrix(model_view, bones.data(), _anim, time, animation_time);
+    animate(model_view, 0, animtime);
   }
 }
 
+void Model::upload_animation()
+{
+  if (!_bone_matrices_changed)
+  {
+    return;
+  }
+
+  opengl::scoped::buffer_binder<GL_TEXTURE_BUFFER> const binder (_bone_matrices_buffer);
+  gl.bufferSubData(GL_TEXTURE_BUFFER, 0, bone_matrices.size() * sizeof(glm::mat4x4), bone_matrices.data());
+
+  _bone_matrices_changed = false;
+}
+
 void Model::animate(glm::mat4x4 const& model_view, int anim_id, int anim_time)
 {
+  animcalc = true;
+  _animated_model_view = model_view;
+  _animated_time = anim_time;
+
   if (_animations_seq_per_id.empty() || _animations_seq_per_id[anim_id].empty())
   {
     return;
@@ -1228,10 +1291,7 @@ void Model::animate(glm::mat4x4 const& model_view, int anim_id, int anim_time)
       bone_counter++;
     }
 
-    {
-      opengl::scoped::buffer_binder<GL_TEXTURE_BUFFER> const binder (_bone_matrices_buffer);
-      gl.bufferSubData(GL_TEXTURE_BUFFER, 0, bone_matrices.size() * sizeof(glm::mat4x4), bone_matrices.data());
-    }
+    _bone_matrices_changed = true;
 
 
     // transform vertices
@@ -1389,15 +1449,12 @@ Bone::Bone( const MPQFile& f,
 }
 
 void Bone::calcMatrix(glm::mat4x4 const& model_view
-                     , Bone *allbones
+                     , Bone const* allbones
                      , int anim
                      , int time
                      , int animtime
                      )
 {
-
-  if (calc) return;
-
   glm::mat4x4 m = glm::mat4x4(1);
   glm::quat q = glm::quat();
 
@@ -1450,7 +1507,6 @@ void Bone::calcMatrix(glm::mat4x4 const& model_view
 
   if (parent >= 0)
   {
-    allbones[parent].calcMatrix (model_view, allbones, anim, time, animtime);
     mat = allbones[parent].mat * m;
   }
   else
@@ -1474,8 +1530,6 @@ void Bone::calcMatrix(glm::mat4x4 const& model_view
   {
     mrot = glm::mat4x4(1);
   }
-
-  calc = true;
 }
 
 void Model::draw( glm::mat4x4 const& model_view
@@ -1505,11 +1559,11 @@ void Model::draw( glm::mat4x4 const& model_view
     upload();
   }
 
-  if (animated && (!animcalc || _per_instance_animation))
+  if (needs_animation(model_view, animtime))
   {
     animate(model_view, 0, animtime);
-    animcalc = true;
   }
+  upload_animation();
 
   opengl::scoped::vao_binder const _(_vao);
 
@@ -1553,6 +1607,7 @@ void Model::draw (glm::mat4x4 const& model_view
                  , std::unordered_map<Model*, std::size_t>& model_boxes_to_draw
                  , display_mode display
                  , bool no_cull
+                 , bool instances_changed
                  )
 {
   ZoneScopedN(BOOST_CURRENT_FUNCTION);
@@ -1584,11 +1639,11 @@ void Model::draw (glm::mat4x4 const& model_view
   {
     ZoneScopedN("Model::draw() : drawing")
 
-    if (animated && (!animcalc || _per_instance_animation))
+    if (needs_animation(model_view, animtime))
     {
       animate(model_view, 0, animtime);
-      animcalc = true;
     }
+    upload_animation();
 
     // store the model count to draw the bounding boxes later
     if (all_boxes || _hidden)
@@ -1605,10 +1660,17 @@ void Model::draw (glm::mat4x4 const& model_view
 
     opengl::scoped::vao_binder const _ (_vao);
 
+    if ( instances_changed
+       || _uploaded_transforms != instances.data()
+       || _uploaded_transform_count != instances.size()
+       )
     {
       opengl::scoped::buffer_binder<GL_ARRAY_BUFFER> const transform_binder (_transform_buffer);
       gl.bufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(::glm::mat4x4), instances.data(), GL_DYNAMIC_DRAW);
       //m2_shader.attrib("transform", 0, 1);
+
+      _uploaded_transforms = instances.data();
+      _uploaded_transform_count = instances.size();
     }
 
     if (animBones)
@@ -1641,6 +1703,8 @@ void Model::draw_particles( glm::mat4x4 const& model_view
                           , std::size_t instance_count
                           )
 {
+  _updates_since_particles_drawn = 0;
+
   for (auto& p : _particles)
   {
     p.draw(model_view, particles_shader, _transform_buffer, instance_count);
@@ -1687,48 +1751,64 @@ std::vector<float> Model::intersect (glm::mat4x4 const& model_view, math::ray co
     return results;
   }
 
-  if (animated && (!animcalc || _per_instance_animation))
+  if (needs_animation(model_view, animtime))
   {
     animate (model_view, 0, animtime);
-    animcalc = true;
   }
 
   if (use_fake_geometry())
   {
-    auto& fake_geom = _fake_geometry.get();
-
-    for (size_t i = 0; i < fake_geom.indices.size(); i += 3)
+    // a single hit is enough for the fake box
+    if (auto distance = _bvh.intersect_nearest (ray))
     {
-      if (auto distance
-        = ray.intersect_triangle(fake_geom.vertices[fake_geom.indices[i + 0]],
-          fake_geom.vertices[fake_geom.indices[i + 1]],
-          fake_geom.vertices[fake_geom.indices[i + 2]])
-        )
-      {
-        results.emplace_back (*distance);
-        return results;
-      }
+      results.emplace_back (*distance);
     }
 
     return results;
   }
 
-  for (auto&& pass : _render_passes)
+  _bvh.intersect (ray, &results);
+
+  return results;
+}
+
+void Model::build_bvh()
+{
+  if (use_fake_geometry())
+  {
+    auto& fake_geom = _fake_geometry.get();
+
+    for (size_t i = 0; i < fake_geom.indices.size(); i += 3)
+    {
+      _bvh.add_triangle ( fake_geom.vertices[fake_geom.indices[i + 0]]
+                        , fake_geom.vertices[fake_geom.indices[i + 1]]
+                        , fake_geom.vertices[fake_geom.indices[i + 2]]
+                        );
+    }
+  }
+  else
   {
-    for (size_t i (pass.index_start); i < pass.index_start + pass.index_count; i += 3)
+    // several passes can share their geometry, only add it once
+    std::set<std::pair<uint16_t, uint16_t>> ranges;
+
+    for (auto&& pass : _render_passes)
     {
-      if ( auto distance
-          = ray.intersect_triangle( _vertices[_indices[i + 0]].position,
-                                    _vertices[_indices[i + 1]].position,
-                                    _vertices[_indices[i + 2]].position)
-          )
+      if (!ranges.emplace (pass.index_start, pass.index_count).second)
+      {
+        continue;
+      }
+
+      for (size_t i (pass.index_start); i + 2 < pass.index_start + pass.index_count; i += 3)
       {
-        results.emplace_back (*distance);
+        _bvh.add_triangle ( _vertices[_indices[i + 0]].position
+                          , _vertices[_indices[i + 1]].position
+                          , _vertices[_indices[i + 2]].position
+                          );
       }
     }
   }
 
-  return results;
+  _bvh.build();
 }
 
 void Model::lightsOn(opengl::light lbase)
@@ -1787,6 +1867,7 @@ void Model::unload()
 {
   _textures.clear();
   _buffers.unload();
+  _uploaded_transforms = nullptr;
   _vertex_arrays.unload();
 
   if (_bone_matrices_buf_tex)
@@ -1806,15 +1887,17 @@ void Model::unload()
   _vao_setup = false;
 }
 
-void Model::updateEmitters(float dt)
+void Model::active_particle_systems(std::vector<ParticleSystem*>& systems)
 {
-  return;
-
-  if (finished)
+  // what was not drawn for about half a second at 60 fps is not simulated,
+  // nor what never was: particle drawing is disabled for now
+  if (finished && _updates_since_particles_drawn < updates_simulated_undrawn)
   {
+    ++_updates_since_particles_drawn;
+
     for (auto& particle : _particles)
     {
-      particle.update (dt);
+      systems.push_back (&particle);
     }
   }
 }
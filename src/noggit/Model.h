@@ -5,6 +5,7 @@
 #include <math/frustum.hpp>
 #include <math/matrix_4x4.hpp>
 #include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
 #include <noggit/Animated.h> // Animation::M2Value
 #include <noggit/AsyncObject.h> // AsyncObject
 #include <noggit/MPQ.h>
@@ -55,9 +56,9 @@ public:
   glm::mat4x4 mat = glm::mat4x4();
   glm::mat4x4 mrot = glm::mat4x4();
 
-  bool calc;
+  //! the parent in allbones has to be computed already
   void calcMatrix(glm::mat4x4 const& model_view
-                 , Bone* allbones
+                 , Bone const* allbones
                  , int anim
                  , int time
                  , int animtime
@@ -235,6 +236,8 @@ public:
             , std::unordered_map<Model*, std::size_t>& model_boxes_to_draw
             , display_mode display
             , bool no_cull = false
+            //! false if the same instances were drawn last time and didn't change
+            , bool instances_changed = true
             );
   void draw_particles( glm::mat4x4 const& model_view
                      , opengl::scoped::use_program& particles_shader
@@ -248,7 +251,14 @@ public:
 
   std::vector<float> intersect (glm::mat4x4 const& model_view, math::ray const&, int animtime);
 
-  void updateEmitters(float dt);
+  //! computes the bones of the frame if not done yet, leaving the upload
+  //! to the next draw. touches nothing but the model, so several models
+  //! can be animated in parallel
+  void prepare_animation (glm::mat4x4 const& model_view, int animtime);
+
+  //! the particle systems worth updating, none when the model's particles
+  //! were not drawn during the last updates
+  void active_particle_systems(std::vector<ParticleSystem*>& systems);
 
   virtual void finishLoading();
   virtual void waitForChildrenLoaded() override;
@@ -283,7 +293,10 @@ public:
   // Misc ?
   // ===============================
   std::vector<Bone> bones;
+  //! the indices of the bones, parents before their children
+  std::vector<std::size_t> _bone_order;
   std::vector<glm::mat4x4> bone_matrices;
+  bool _bone_matrices_changed = false;
   ModelHeader header;
   std::vector<uint16_t> blend_override;
 
@@ -295,6 +308,9 @@ public:
 
 private:
   bool _per_instance_animation;
+  //! what the current animation was computed for, billboards depend on the view
+  glm::mat4x4 _animated_model_view;
+  int _animated_time = 0;
   int _current_anim_seq;
   int _anim_time;
   int _global_animtime;
@@ -304,13 +320,16 @@ private:
   void initCommon(const MPQFile& f);
   bool isAnimated(const MPQFile& f);
   void initAnimated(const MPQFile& f);
+  void build_bvh();
 
   void fix_shader_id_blend_override();
   void fix_shader_id_layer();
   void compute_pixel_shader_ids();
 
+  bool needs_animation(glm::mat4x4 const& model_view, int animtime) const;
   void animate(glm::mat4x4 const& model_view, int anim_id, int anim_time);
   void calcBones(glm::mat4x4 const& model_view, int anim, int time, int animation_time);
+  void upload_animation();
 
   void lightsOn(opengl::light lbase);
   void lightsOff(opengl::light lbase);
@@ -321,6 +340,15 @@ private:
   bool _finished_upload = false;
   bool _vao_setup = false;
 
+  //! reset by draw_particles, particles stop updating when it reaches
+  //! updates_simulated_undrawn
+  static constexpr int updates_simulated_undrawn = 30;
+  int _updates_since_particles_drawn = updates_simulated_undrawn;
+
+  //! what's in the transform buffer, to skip uploading it again
+  glm::mat4x4 const* _uploaded_transforms = nullptr;
+  std::size_t _uploaded_transform_count = 0;
+
   std::vector<glm::vec3> _vertex_box_points;
 
   // buffers
@@ -353,6 +381,9 @@ private:
   std::vector<ModelRenderPass> _render_passes;
   boost::optional<FakeGeometry> _fake_geometry;
 
+  //! the static geometry (or the fake one), for picking
+  math::triangle_bvh _bvh;
+
   // ===============================
   // Animation
   // ===============================
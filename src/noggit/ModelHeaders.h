@@ -2,6 +2,7 @@
 #pragma once
 #include <cstdint>
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 #pragma pack(push,1)
 
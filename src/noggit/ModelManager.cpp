@@ -4,6 +4,8 @@
 #include <noggit/Log.h> // LogDebug
 #include <noggit/Model.h> // Model
 #include <noggit/ModelManager.h> // ModelManager
+#include <noggit/Particle.h> // ParticleSystem
+#include <noggit/parallel_for.hpp>
 
 #include <algorithm>
 
@@ -51,11 +53,21 @@ void ModelManager::resetAnim()
 
 void ModelManager::updateEmitters(float dt)
 {
+  std::vector<ParticleSystem*> systems;
+
   _.apply ( [&] (std::string const&, Model& model)
             {
-              model.updateEmitters (dt);
+              model.active_particle_systems (systems);
             }
           );
+
+  // the systems only share their model's bones, which are read only here
+  noggit::parallel_for ( systems.size()
+                       , [&] (std::size_t i)
+                         {
+                           systems[i]->update (dt);
+                         }
+                       );
 }
 
 void ModelManager::clear_hidden_models()
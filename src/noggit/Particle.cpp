@@ -7,15 +7,37 @@
 #include <opengl/shader.hpp>
 #include <glm/vec3.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <list>
 
 static const unsigned int MAX_PARTICLES = 10000;
 
-template<class T>
-T lifeRamp(float life, float mid, const T &a, const T &b, const T &c)
+namespace
 {
-  if (life <= mid) return math::interpolation::linear(life / mid, a, b);
-  else return math::interpolation::linear((life - mid) / (1.0f - mid), b, c);
+  //! every system, copies included, gets its own sequence
+  unsigned int next_seed()
+  {
+    static std::atomic<unsigned int> seed (1);
+    return seed++;
+  }
+
+  // misc::frand, misc::randfloat and misc::randint on a system's own
+  // engine, the bounds are not always in order
+  float frand (std::minstd_rand& random)
+  {
+    return static_cast<float> (random() - random.min()) / static_cast<float> (random.max() - random.min());
+  }
+
+  float randfloat (std::minstd_rand& random, float lower, float upper)
+  {
+    return lower + (upper - lower) * frand (random);
+  }
+
+  int randint (std::minstd_rand& random, int lower, int upper)
+  {
+    return lower + static_cast<int> ((upper + 1 - lower) * frand (random));
+  }
 }
 
 ParticleSystem::ParticleSystem(Model* model_
@@ -53,6 +75,7 @@ ParticleSystem::ParticleSystem(Model* model_
   , cols (mta.cols)
   , billboard (!(mta.flags & 4096))
   , rem(0)
+  , _random (next_seed())
   , parent (&model->bones[mta.bone])
   , flags(mta.flags)
   , tofs (misc::frand())
@@ -112,6 +135,7 @@ ParticleSystem::ParticleSystem(ParticleSystem const& other)
   , tiles(other.tiles)
   , billboard(other.billboard)
   , rem(other.rem)
+  , _random (next_seed())
   , parent(other.parent)
   , flags(other.flags)
   , tofs(other.tofs)
@@ -153,6 +177,7 @@ ParticleSystem::ParticleSystem(ParticleSystem&& other)
   , tiles(other.tiles)
   , billboard(other.billboard)
   , rem(other.rem)
+  , _random (next_seed())
   , parent(other.parent)
   , flags(other.flags)
   , tofs(other.tofs)
@@ -205,8 +230,8 @@ void ParticleSystem::update(float dt)
     else {
       int tospawn = (int)ftospawn;
 
-      if ((tospawn + particles.size()) > MAX_PARTICLES) // Error check to prevent the program from trying to load insane amounts of particles.
-        tospawn = particles.size() - MAX_PARTICLES;
+      if ((tospawn + particles.count()) > MAX_PARTICLES) // Error check to prevent the program from trying to load insane amounts of particles.
+        tospawn = static_cast<int>(MAX_PARTICLES - std::min<std::size_t>(particles.count(), MAX_PARTICLES));
 
       rem = ftospawn - static_cast<float>(tospawn);
 
@@ -233,33 +258,7 @@ void ParticleSystem::update(float dt)
     }
   }
 
-  float mspeed = 1.0f;
-
-  for (ParticleList::iterator it = particles.begin(); it != particles.end();) {
-    Particle &p = *it;
-    p.speed += p.down * grav * dt - p.dir * deaccel * dt;
-
-    if (slowdown>0) {
-      mspeed = expf(-1.0f * slowdown * p.life);
-    }
-    p.pos += p.speed * mspeed * dt;
-
-    p.life += dt;
-    float rlife = p.life / p.maxlife;
-    // calculate size and color based on lifetime
-    p.size = lifeRamp<float>(rlife, mid, sizes[0], sizes[1], sizes[2]);
-    p.color = lifeRamp<glm::vec4>(rlife, mid, colors[0], colors[1], colors[2]);
-
-    // kill off old particles
-    if (rlife >= 1.0f)
-    {
-      it = particles.erase (it);
-    }
-    else
-    {
-      ++it;
-    }
-  }
+  particles.update (dt, grav, deaccel, slowdown, mid, sizes, colors);
 }
 
 void ParticleSystem::setup(int anim, int time, int animtime)
@@ -362,62 +361,62 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
     if (billboard) 
     {
       //! \todo per-particle rotation in a non-expensive way?? :|
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+      for (std::size_t i = 0; i < particles.count(); ++i)
       {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+        if (tiles.size() - 1 < particles.tile[i]) // Alfred, 2009.08.07, error prevent
         {
           break;
         }
 
-        const float size = it->size;// / 2;
+        const float size = particles.size[i];// / 2;
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[particles.tile[i]].tc[0]);
+        vertices.push_back(particles.pos[i]);
         offsets.push_back(-(vRight + vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[particles.tile[i]].tc[1]);
+        vertices.push_back(particles.pos[i]);
         offsets.push_back((vRight - vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[particles.tile[i]].tc[2]);
+        vertices.push_back(particles.pos[i]);
         offsets.push_back((vRight + vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos);
+        texcoords.push_back(tiles[particles.tile[i]].tc[3]);
+        vertices.push_back(particles.pos[i]);
         offsets.push_back(-(vRight - vUp) * size);
-        colors_data.push_back(it->color);
+        colors_data.push_back(particles.color[i]);
 
         add_quad_indices(indices, indice);
       }
     }
     else 
     {
-      for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+      for (std::size_t i = 0; i < particles.count(); ++i)
       {
-        if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+        if (tiles.size() - 1 < particles.tile[i]) // Alfred, 2009.08.07, error prevent
         {
           break;
         }
 
-        texcoords.push_back(tiles[it->tile].tc[0]);
-        vertices.push_back(it->pos + it->corners[0] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[particles.tile[i]].tc[0]);
+        vertices.push_back(particles.pos[i] + particles.corners[i][0] * particles.size[i]);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[1]);
-        vertices.push_back(it->pos + it->corners[1] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[particles.tile[i]].tc[1]);
+        vertices.push_back(particles.pos[i] + particles.corners[i][1] * particles.size[i]);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[2]);
-        vertices.push_back(it->pos + it->corners[2] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[particles.tile[i]].tc[2]);
+        vertices.push_back(particles.pos[i] + particles.corners[i][2] * particles.size[i]);
+        colors_data.push_back(particles.color[i]);
 
-        texcoords.push_back(tiles[it->tile].tc[3]);
-        vertices.push_back(it->pos + it->corners[3] * it->size);
-        colors_data.push_back(it->color);
+        texcoords.push_back(tiles[particles.tile[i]].tc[3]);
+        vertices.push_back(particles.pos[i] + particles.corners[i][3] * particles.size[i]);
+        colors_data.push_back(particles.color[i]);
 
         add_quad_indices(indices, indice);
       }
@@ -435,28 +434,28 @@ void ParticleSystem::draw( glm::mat4x4 const& model_view
     bv1 = mbb * glm::vec3(1.0f,0,0);
     */
 
-    for (ParticleList::iterator it = particles.begin(); it != particles.end(); ++it) 
+    for (std::size_t i = 0; i < particles.count(); ++i)
     {
-      if (tiles.size() - 1 < it->tile) // Alfred, 2009.08.07, error prevent
+      if (tiles.size() - 1 < particles.tile[i]) // Alfred, 2009.08.07, error prevent
       {
         break;
       }
 
-      texcoords.push_back(tiles[it->tile].tc[0]);
-      vertices.push_back(it->pos + bv0 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[particles.tile[i]].tc[0]);
+      vertices.push_back(particles.pos[i] + bv0 * particles.size[i]);
+      colors_data.push_back(particles.color[i]);
 
-      texcoords.push_back(tiles[it->tile].tc[1]);
-      vertices.push_back(it->pos + bv1 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[particles.tile[i]].tc[1]);
+      vertices.push_back(particles.pos[i] + bv1 * particles.size[i]);
+      colors_data.push_back(particles.color[i]);
 
-      texcoords.push_back(tiles[it->tile].tc[2]);
-      vertices.push_back(it->origin + bv1 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[particles.tile[i]].tc[2]);
+      vertices.push_back(particles.origin[i] + bv1 * particles.size[i]);
+      colors_data.push_back(particles.color[i]);
 
-      texcoords.push_back(tiles[it->tile].tc[3]);
-      vertices.push_back(it->origin + bv0 * it->size);
-      colors_data.push_back(it->color);
+      texcoords.push_back(tiles[particles.tile[i]].tc[3]);
+      vertices.push_back(particles.origin[i] + bv0 * particles.size[i]);
+      colors_data.push_back(particles.color[i]);
 
       add_quad_indices(indices, indice);
     }
@@ -518,15 +517,15 @@ void ParticleSystem::unload()
 namespace
 {
   //Generates the rotation matrix based on spread
-  glm::mat4x4 CalcSpreadMatrix(float Spread1, float Spread2, float w, float l)
+  glm::mat4x4 CalcSpreadMatrix(std::minstd_rand& random, float Spread1, float Spread2, float w, float l)
   {
     int i, j;
     float a[2], c[2], s[2];
 
     glm::mat4x4 SpreadMat = glm::mat4x4(1);
 
-    a[0] = misc::randfloat(-Spread1, Spread1) / 2.0f;
-    a[1] = misc::randfloat(-Spread2, Spread2) / 2.0f;
+    a[0] = randfloat(random, -Spread1, Spread1) / 2.0f;
+    a[1] = randfloat(random, -Spread2, Spread2) / 2.0f;
 
     /*SpreadMat.m[0][0]*=l;
     SpreadMat.m[1][1]*=l;
@@ -611,12 +610,12 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
   Particle p;
 
   //Spread Calculation
-  auto mrot = sys->parent->mrot*CalcSpreadMatrix(spr, spr, 1.0f, 1.0f);
+  auto mrot = sys->parent->mrot*CalcSpreadMatrix(sys->_random, spr, spr, 1.0f, 1.0f);
 
   if (sys->flags == 1041) { // Trans Halo
-    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(misc::randfloat(-l, l), 0, misc::randfloat(-w, w),0));
+    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(randfloat(sys->_random, -l, l), 0, randfloat(sys->_random, -w, w),0));
 
-    const float t = misc::randfloat(0.0f, 2.0f * glm::pi<float>());
+    const float t = randfloat(sys->_random, 0.0f, 2.0f * glm::pi<float>());
 
     p.pos = glm::vec3(0.0f, sys->pos.y + 0.15f, sys->pos.z) + glm::vec3(cos(t) / 8, 0.0f, sin(t) / 8); // Need to manually correct for the halo - why?
 
@@ -626,10 +625,10 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
     glm::vec3 dir(0.0f, 1.0f, 0.0f);
     p.dir = dir;
 
-    p.speed = glm::normalize(dir) * spd * misc::randfloat(0, var);
+    p.speed = glm::normalize(dir) * spd * randfloat(sys->_random, 0, var);
   }
   else if (sys->flags == 25 && sys->parent->parent<1) { // Weapon Flame
-    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w)));
+    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(randfloat(sys->_random, -l, l), randfloat(sys->_random, -l, l), randfloat(sys->_random, -w, w)));
     glm::vec3 dir = mrot * glm::vec4(0.0f, 1.0f, 0.0f,0.0f);
     p.dir = glm::normalize(dir);
     //glm::vec3 dir = sys->model->bones[sys->parent->parent].mrot * sys->parent->mrot * glm::vec3(0.0f, 1.0f, 0.0f);
@@ -637,19 +636,19 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
   }
   else if (sys->flags == 25 && sys->parent->parent > 0) { // Weapon with built-in Flame (Avenger lightsaber!)
-    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w),0));
+    p.pos = sys->parent->mat * (glm::vec4(sys->pos,0) + glm::vec4(randfloat(sys->_random, -l, l), randfloat(sys->_random, -l, l), randfloat(sys->_random, -w, w),0));
     glm::vec3 dir = glm::vec4(sys->parent->mat[1][0], sys->parent->mat[1][1], sys->parent->mat [1][2],0.0f) + glm::vec4(0.0f, 1.0f, 0.0f,0.0f);
-    p.speed = glm::normalize(dir) * spd * misc::randfloat(0, var * 2);
+    p.speed = glm::normalize(dir) * spd * randfloat(sys->_random, 0, var * 2);
 
   }
   else if (sys->flags == 17 && sys->parent->parent<1) { // Weapon Glow
-    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(misc::randfloat(-l, l), misc::randfloat(-l, l), misc::randfloat(-w, w)));
+    p.pos = sys->parent->pivot + (sys->pos + glm::vec3(randfloat(sys->_random, -l, l), randfloat(sys->_random, -l, l), randfloat(sys->_random, -w, w)));
     glm::vec3 dir = mrot * glm::vec4(0, 1, 0,0);
     p.dir = glm::normalize(dir);
 
   }
   else {
-    p.pos = sys->pos + glm::vec3(misc::randfloat(-l, l), 0, misc::randfloat(-w, w));
+    p.pos = sys->pos + glm::vec3(randfloat(sys->_random, -l, l), 0, randfloat(sys->_random, -w, w));
     p.pos = sys->parent->mat * glm::vec4(p.pos,0);
 
     //glm::vec3 dir = mrot * glm::vec3(0,1,0);
@@ -657,7 +656,7 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
     p.dir = dir;//.normalize();
     p.down = glm::vec3(0, -1.0f, 0); // dir * -1.0f;
-    p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));
+    p.speed = glm::normalize(dir) * spd * (1.0f + randfloat(sys->_random, -var, var));
   }
 
   if (!sys->billboard)  {
@@ -672,7 +671,7 @@ Particle PlaneParticleEmitter::newParticle(ParticleSystem* sys, int anim, int ti
 
   p.origin = p.pos;
 
-  p.tile = misc::randint(0, sys->rows*sys->cols - 1);
+  p.tile = randint(sys->_random, 0, sys->rows*sys->cols - 1);
   return p;
 }
 
@@ -682,7 +681,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
   glm::vec3 dir;
   float radius;
 
-  radius = misc::randfloat(0, 1);
+  radius = randfloat(sys->_random, 0, 1);
 
   // Old method
   //float t = misc::randfloat(0,2*math::constants::pi);
@@ -691,12 +690,12 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
   // Spread should never be zero for sphere particles ?
   math::radians t (0);
   if (spr == 0)
-    t._ = misc::randfloat(-glm::pi<float>(), glm::pi<float>());
+    t._ = randfloat(sys->_random, -glm::pi<float>(), glm::pi<float>());
   else
-    t._ = misc::randfloat(-spr, spr);
+    t._ = randfloat(sys->_random, -spr, spr);
 
   //Spread Calculation
-  auto mrot =  sys->parent->mrot*CalcSpreadMatrix(spr * 2, spr2 * 2, w, l);
+  auto mrot =  sys->parent->mrot*CalcSpreadMatrix(sys->_random, spr * 2, spr2 * 2, w, l);
 
   // New
   // Length should never technically be zero ?
@@ -714,11 +713,11 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
 
 
   float theta_range = sys->spread.getValue(anim, time, animtime);
-  float theta = -0.5f* theta_range + misc::randfloat(0, theta_range);
+  float theta = -0.5f* theta_range + randfloat(sys->_random, 0, theta_range);
   glm::vec3 bdir(0, l*math::cos(theta), w*math::sin(theta));
 
   float phi_range = sys->lat.getValue(anim, time, animtime);
-  float phi = misc::randfloat(0, phi_range);
+  float phi = randfloat(sys->_random, 0, phi_range);
   rotate(0,0, &bdir.z, &bdir.x, phi);
   */
 
@@ -732,7 +731,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
       p.speed = glm::vec3(0, 0, 0);
     else {
       dir = sys->parent->mrot * glm::vec4((glm::normalize(bdir)),0);//mrot * glm::vec3(0, 1.0f,0);
-      p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));   // ?
+      p.speed = glm::normalize(dir) * spd * (1.0f + randfloat(sys->_random, -var, var));   // ?
     }
 
   }
@@ -764,7 +763,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
       else
         dir = glm::normalize(bdir);
 
-      p.speed = glm::normalize(dir) * spd * (1.0f + misc::randfloat(-var, var));   // ?
+      p.speed = glm::normalize(dir) * spd * (1.0f + randfloat(sys->_random, -var, var));   // ?
     }
   }
 
@@ -776,7 +775,7 @@ Particle SphereParticleEmitter::newParticle(ParticleSystem* sys, int anim, int t
 
   p.origin = p.pos;
 
-  p.tile = misc::randint(0, sys->rows*sys->cols - 1);
+  p.tile = randint(sys->_random, 0, sys->rows*sys->cols - 1);
   return p;
 }
 
@@ -5,11 +5,14 @@
 #include <noggit/Animated.h> // Animation::M2Value
 #include <noggit/Model.h>
 #include <noggit/TextureManager.h>
+#include <noggit/particle_pool.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.fwd.hpp>
 
+#include <array>
 #include <list>
 #include <memory>
+#include <random>
 #include <vector>
 
 class Bone;
@@ -17,17 +20,6 @@ class Model;
 class ParticleSystem;
 class RibbonEmitter;
 
-struct Particle {
-  glm::vec3 pos, speed, down, origin, dir;
-  glm::vec3  corners[4];
-  //glm::vec3 tpos;
-  float size, life, maxlife;
-  unsigned int tile;
-  glm::vec4 color;
-};
-
-typedef std::list<Particle> ParticleList;
-
 class ParticleEmitter {
 public:
   explicit ParticleEmitter() {}
@@ -63,7 +55,7 @@ class ParticleSystem
   float mid, slowdown;
   glm::vec3 pos;
   uint16_t _texture_id;
-  ParticleList particles;
+  ParticlePool particles;
   int blend, order, type;
   int manim, mtime;
   int manimtime;
@@ -73,6 +65,8 @@ class ParticleSystem
   bool billboard;
 
   float rem;
+  //! systems spawn in parallel, rand() would be shared between them
+  std::minstd_rand _random;
   //bool transform;
 
   // unknown parameters omitted for now ...
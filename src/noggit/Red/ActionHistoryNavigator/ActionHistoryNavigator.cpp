@@ -24,6 +24,9 @@ ActionHistoryNavigator::ActionHistoryNavigator(QWidget* parent)
   _action_stack->setSelectionBehavior(QAbstractItemView::SelectRows);
   _action_stack->setSelectionRectVisible(true);
 
+  _memory_usage = new QLabel(this);
+  layout->addWidget(_memory_usage);
+
   auto action_mgr = noggit::ActionManager::instance();
 
   connect(action_mgr, &noggit::ActionManager::popBack, this, &ActionHistoryNavigator::popBack);
@@ -31,6 +34,7 @@ ActionHistoryNavigator::ActionHistoryNavigator(QWidget* parent)
   connect(action_mgr, &noggit::ActionManager::addedAction, this, &ActionHistoryNavigator::pushAction);
   connect(action_mgr, &noggit::ActionManager::purged, this, &ActionHistoryNavigator::purge);
   connect(action_mgr, &noggit::ActionManager::currentActionChanged, this, &ActionHistoryNavigator::changeCurrentAction);
+  connect(action_mgr, &noggit::ActionManager::memoryUsageChanged, this, &ActionHistoryNavigator::updateMemoryUsage);
 
   connect(_active_action_button_group, &QButtonGroup::idClicked
           , [=](int index)
@@ -40,6 +44,7 @@ ActionHistoryNavigator::ActionHistoryNavigator(QWidget* parent)
             action_mgr->setCurrentAction((_action_stack->count() - index) - 1);
           });
 
+  updateMemoryUsage();
 }
 
 void ActionHistoryNavigator::pushAction(noggit::Action* action)
@@ -123,4 +128,14 @@ void ActionHistoryNavigator::changeCurrentAction(unsigned index)
   }
 
   //_action_stack->setCurrentItem(_action_stack->item(_action_stack->count() - 1 - index));
-}
\ No newline at end of file
+}
+
+void ActionHistoryNavigator::updateMemoryUsage()
+{
+  auto action_mgr = noggit::ActionManager::instance();
+  constexpr double mebibyte = 1024. * 1024.;
+
+  _memory_usage->setText(QString("Memory: %1 / %2 MB")
+                           .arg(action_mgr->memoryUsage() / mebibyte, 0, 'f', 1)
+                           .arg(action_mgr->memoryBudget() / mebibyte, 0, 'f', 0));
+}
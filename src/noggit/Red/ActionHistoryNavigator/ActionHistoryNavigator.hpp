@@ -6,6 +6,7 @@
 #include <QWidget>
 #include <QListWidget>
 #include <QButtonGroup>
+#include <QLabel>
 
 
 
@@ -27,6 +28,7 @@ namespace noggit
       void popBack();
       void purge();
       void changeCurrentAction(unsigned index);
+      void updateMemoryUsage();
 
     signals:
       void currentActionChanged(unsigned index);
@@ -34,6 +36,7 @@ namespace noggit
     private:
       QListWidget* _action_stack;
       QButtonGroup* _active_action_button_group;
+      QLabel* _memory_usage;
 
 
     };
@@ -5,6 +5,7 @@
 #include <noggit/ui/FramelessWindow.hpp>
 #include <noggit/ui/font_noggit.hpp>
 #include <noggit/MapView.h>
+#include <noggit/thumbnail_cache.hpp>
 
 #include <QStandardItemModel>
 #include <QItemSelectionModel>
@@ -15,6 +16,7 @@
 #include <QDialog>
 #include <QDial>
 #include <QSlider>
+#include <QElapsedTimer>
 
 using namespace noggit::Red::AssetBrowser::Ui;
 using namespace noggit::ui;
@@ -128,25 +130,14 @@ AssetBrowserWidget::AssetBrowserWidget(MapView* map_view, QWidget *parent)
         if (!render_preview)
           return;
 
-        for (int i = 0; i != _sort_model->rowCount(index); ++i)
-        {
-          auto child = index.child(i, 0);
-          auto path = child.data(Qt::UserRole).toString();
-          if (path.endsWith(".wmo") || path.endsWith(".m2"))
-          {
-            _preview_renderer->setModelOffscreen(path.toStdString());
-
-            auto preview_pixmap = _preview_renderer->renderToPixmap();
-            auto item = _model->itemFromIndex(_sort_model->mapToSource(child));
-            item->setIcon(QIcon(*preview_pixmap));
-            item->setDragEnabled(true);
-            item->setFlags(item->flags() | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled);
-          }
-        }
+        queuePreviews(index);
       }
 
   );
 
+  _preview_timer.setInterval(0);
+  connect(&_preview_timer, &QTimer::timeout, [this]() { renderPendingPreviews(); });
+
   setupConnectsCommon();
 
   _wmo_group_and_lod_regex = QRegularExpression(".+_\\d{3}(_lod.+)*.wmo");
@@ -156,6 +147,70 @@ AssetBrowserWidget::AssetBrowserWidget(MapView* map_view, QWidget *parent)
 
 }
 
+void AssetBrowserWidget::queuePreviews(const QModelIndex& index)
+{
+  for (int i = _sort_model->rowCount(index) - 1; i >= 0; --i)
+  {
+    auto child = index.child(i, 0);
+    auto path = child.data(Qt::UserRole).toString();
+    if (path.endsWith(".wmo") || path.endsWith(".m2"))
+    {
+      auto source = _sort_model->mapToSource(child);
+      if (_model->itemFromIndex(source)->icon().isNull())
+      {
+        _pending_previews.emplace_front(source);
+      }
+    }
+  }
+
+  if (!_pending_previews.empty())
+  {
+    _preview_timer.start();
+  }
+}
+
+void AssetBrowserWidget::renderPendingPreviews()
+{
+  auto size = ui->listfileTree->iconSize();
+  QString const settings = QString("model preview %1x%2").arg(size.width()).arg(size.height());
+
+  // keep the ui responsive, whatever is left waits for the next round
+  QElapsedTimer elapsed;
+  elapsed.start();
+
+  while (!_pending_previews.empty() && elapsed.elapsed() < 15)
+  {
+    QPersistentModelIndex const index = _pending_previews.front();
+    _pending_previews.pop_front();
+
+    auto item = index.isValid() ? _model->itemFromIndex(index) : nullptr;
+    if (!item || !item->icon().isNull())
+      continue;
+
+    auto path = item->data(Qt::UserRole).toString().toStdString();
+    auto key = thumbnail_cache::key(path, settings);
+    auto preview = key ? thumbnail_cache::load(*key) : boost::none;
+
+    if (!preview)
+    {
+      _preview_renderer->setModelOffscreen(path);
+      preview = *_preview_renderer->renderToPixmap();
+
+      if (key)
+        thumbnail_cache::store(*key, *preview);
+    }
+
+    item->setIcon(QIcon(*preview));
+    item->setDragEnabled(true);
+    item->setFlags(item->flags() | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled);
+  }
+
+  if (_pending_previews.empty())
+  {
+    _preview_timer.stop();
+  }
+}
+
 void AssetBrowserWidget::setupConnectsCommon()
 {
   connect(ui->searchButton, &QPushButton::clicked
@@ -313,6 +368,7 @@ void AssetBrowserWidget::updateModelData()
 
 AssetBrowserWidget::~AssetBrowserWidget()
 {
+  _preview_timer.stop();
   delete ui;
   delete _preview_renderer;
 }
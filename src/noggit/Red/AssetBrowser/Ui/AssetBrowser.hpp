@@ -11,6 +11,10 @@
 #include <QSortFilterProxyModel>
 #include <QRegularExpression>
 #include <QMainWindow>
+#include <QPersistentModelIndex>
+#include <QTimer>
+
+#include <deque>
 
 class MapView;
 
@@ -39,7 +43,15 @@ namespace noggit
       MapView* _map_view;
       std::string _selected_path;
 
+      //! items of the expanded folders still without a preview, the last
+      //! expanded first. they are filled a few at a time by _preview_timer
+      //! so expanding a large folder does not block the ui
+      std::deque<QPersistentModelIndex> _pending_previews;
+      QTimer _preview_timer;
+
       void updateModelData();
+      void queuePreviews(const QModelIndex& index);
+      void renderPendingPreviews();
       void recurseDirectory(Model::TreeManager& tree_mgr, const QString& s_dir, const QString& project_dir);
 
     protected:
@@ -404,6 +404,8 @@ void MapCreationWizard::saveCurrentEntry()
     QFile file(filepath.string().c_str());
     file.open(QIODevice::WriteOnly);
     file.close();
+
+    MPQFile::project_file_created (filename.str());
   }
 
   // Save ADTs and WDT to disk
@@ -0,0 +1,354 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include "ImageFilters.hpp"
+
+#include <noggit/parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace noggit
+{
+  namespace Red::NodeEditor::Nodes::ImageFilters
+  {
+    namespace
+    {
+      struct FloatImage
+      {
+        FloatImage(int width_, int height_)
+          : width(width_)
+          , height(height_)
+          , pixels(static_cast<std::size_t>(width_) * height_ * 4)
+        {}
+
+        float* row(int y) { return pixels.data() + static_cast<std::size_t>(y) * width * 4; }
+        float const* row(int y) const { return pixels.data() + static_cast<std::size_t>(y) * width * 4; }
+
+        int width;
+        int height;
+        std::vector<float> pixels;
+      };
+
+      bool isWide(QImage const& image)
+      {
+        return image.depth() == 64;
+      }
+
+      template<typename T>
+        void readRows(QImage const& image, FloatImage& result, float scale)
+      {
+        parallel_for(image.height(), [&](std::size_t y)
+        {
+          auto line = reinterpret_cast<T const*>(image.constScanLine(static_cast<int>(y)));
+          float* row = result.row(static_cast<int>(y));
+
+          for (int i = 0; i < image.width() * 4; ++i)
+          {
+            row[i] = line[i] * scale;
+          }
+        });
+      }
+
+      template<typename T>
+        void writeRows(FloatImage const& image, QImage& result, float scale)
+      {
+        // scanLine() detaches, which is not safe to do from several threads
+        uchar* bits = result.bits();
+
+        parallel_for(image.height, [&](std::size_t y)
+        {
+          auto line = reinterpret_cast<T*>(bits + y * result.bytesPerLine());
+          float const* row = image.row(static_cast<int>(y));
+
+          for (int i = 0; i < image.width * 4; ++i)
+          {
+            line[i] = static_cast<T>(std::min(std::max(row[i], 0.f), 1.f) * scale + 0.5f);
+          }
+        });
+      }
+
+      FloatImage toFloat(QImage const& image)
+      {
+        FloatImage result(image.width(), image.height());
+
+        if (isWide(image))
+        {
+          readRows<quint16>(image.convertToFormat(QImage::Format_RGBA64), result, 1.f / 65535.f);
+        }
+        else
+        {
+          readRows<quint8>(image.convertToFormat(QImage::Format_RGBA8888), result, 1.f / 255.f);
+        }
+
+        return result;
+      }
+
+      QImage fromFloat(FloatImage const& image, QImage::Format format)
+      {
+        bool const wide = QImage(1, 1, format).depth() == 64;
+        QImage result(image.width, image.height, wide ? QImage::Format_RGBA64 : QImage::Format_RGBA8888);
+
+        if (wide)
+        {
+          writeRows<quint16>(image, result, 65535.f);
+        }
+        else
+        {
+          writeRows<quint8>(image, result, 255.f);
+        }
+
+        return result.format() == format ? result : result.convertToFormat(format);
+      }
+
+      FloatImage convolveRows(FloatImage const& image, std::vector<float> const& kernel)
+      {
+        int const radius = static_cast<int>(kernel.size() / 2);
+        FloatImage result(image.width, image.height);
+
+        parallel_for(image.height, [&](std::size_t y)
+        {
+          float const* row = image.row(static_cast<int>(y));
+          float* output = result.row(static_cast<int>(y));
+
+          // the row with its edge pixels repeated, so every tap is a plain
+          // multiply-add over the whole row
+          std::vector<float> padded((image.width + 2 * radius) * 4);
+          for (int x = 0; x < image.width + 2 * radius; ++x)
+          {
+            std::copy_n(row + std::min(std::max(x - radius, 0), image.width - 1) * 4, 4, &padded[x * 4]);
+          }
+
+          for (std::size_t k = 0; k < kernel.size(); ++k)
+          {
+            float const weight = kernel[k];
+            float const* source = &padded[k * 4];
+
+            for (int i = 0; i < image.width * 4; ++i)
+            {
+              output[i] += weight * source[i];
+            }
+          }
+        });
+
+        return result;
+      }
+
+      FloatImage convolveColumns(FloatImage const& image, std::vector<float> const& kernel)
+      {
+        int const radius = static_cast<int>(kernel.size() / 2);
+        FloatImage result(image.width, image.height);
+
+        parallel_for(image.height, [&](std::size_t y)
+        {
+          float* output = result.row(static_cast<int>(y));
+
+          for (std::size_t k = 0; k < kernel.size(); ++k)
+          {
+            int const source_y = std::min(std::max(static_cast<int>(y + k) - radius, 0), image.height - 1);
+            float const weight = kernel[k];
+            float const* source = image.row(source_y);
+
+            for (int i = 0; i < image.width * 4; ++i)
+            {
+              output[i] += weight * source[i];
+            }
+          }
+        });
+
+        return result;
+      }
+
+      //! the input pixels each output pixel is made of along one axis, as a
+      //! fixed number of taps per output pixel, unused ones weighing 0
+      struct Taps
+      {
+        Taps(int input_size, int output_size)
+        {
+          double const scale = static_cast<double>(output_size) / input_size;
+          // half width of the triangle filter, in input pixels
+          double const support = scale < 1. ? 1. / scale : 1.;
+
+          count = static_cast<int>(std::ceil(support)) * 2 + 1;
+          indices.resize(static_cast<std::size_t>(output_size) * count, 0);
+          weights.resize(static_cast<std::size_t>(output_size) * count, 0.f);
+
+          for (int o = 0; o < output_size; ++o)
+          {
+            double const center = (o + 0.5) / scale - 0.5;
+            int const first = static_cast<int>(std::floor(center - support)) + 1;
+            double sum = 0.;
+
+            for (int t = 0; t < count; ++t)
+            {
+              double const weight = std::max(0., 1. - std::abs(first + t - center) / support);
+              indices[o * count + t] = std::min(std::max(first + t, 0), input_size - 1);
+              weights[o * count + t] = static_cast<float>(weight);
+              sum += weight;
+            }
+
+            for (int t = 0; t < count; ++t)
+            {
+              weights[o * count + t] = static_cast<float>(weights[o * count + t] / sum);
+            }
+          }
+        }
+
+        int count;
+        std::vector<int> indices;
+        std::vector<float> weights;
+      };
+    }
+
+    std::vector<float> gaussianKernel(double sigma)
+    {
+      int const radius = std::max(1, static_cast<int>(std::ceil(3. * sigma)));
+      std::vector<float> kernel(2 * radius + 1);
+      double sum = 0.;
+
+      for (int i = -radius; i <= radius; ++i)
+      {
+        double const weight = std::exp(-(i * i) / (2. * sigma * sigma));
+        kernel[i + radius] = static_cast<float>(weight);
+        sum += weight;
+      }
+
+      for (auto& weight : kernel)
+      {
+        weight = static_cast<float>(weight / sum);
+      }
+
+      return kernel;
+    }
+
+    std::vector<float> boxKernel(int radius)
+    {
+      return std::vector<float>(2 * radius + 1, 1.f / (2 * radius + 1));
+    }
+
+    QImage convolveSeparable(QImage const& image, std::vector<float> const& kernel)
+    {
+      if (image.isNull())
+      {
+        return image;
+      }
+
+      return fromFloat(convolveColumns(convolveRows(toFloat(image), kernel), kernel), image.format());
+    }
+
+    QImage gaussianBlur(QImage const& image, double sigma)
+    {
+      return convolveSeparable(image, gaussianKernel(sigma));
+    }
+
+    QImage boxBlur(QImage const& image, int radius)
+    {
+      return convolveSeparable(image, boxKernel(radius));
+    }
+
+    QImage resize(QImage const& image, int width, int height)
+    {
+      if (image.isNull() || width <= 0 || height <= 0)
+      {
+        return image.isNull() ? image : QImage();
+      }
+
+      FloatImage const input = toFloat(image);
+
+      Taps const columns(input.width, width);
+      FloatImage resized_rows(width, input.height);
+
+      parallel_for(input.height, [&](std::size_t y)
+      {
+        float const* row = input.row(static_cast<int>(y));
+        float* output = resized_rows.row(static_cast<int>(y));
+
+        for (int x = 0; x < width; ++x)
+        {
+          float pixel[4] = {0.f, 0.f, 0.f, 0.f};
+
+          for (int t = 0; t < columns.count; ++t)
+          {
+            float const weight = columns.weights[x * columns.count + t];
+            float const* source = row + columns.indices[x * columns.count + t] * 4;
+
+            for (int c = 0; c < 4; ++c)
+            {
+              pixel[c] += weight * source[c];
+            }
+          }
+
+          std::copy_n(pixel, 4, output + x * 4);
+        }
+      });
+
+      Taps const rows(input.height, height);
+      FloatImage result(width, height);
+
+      parallel_for(height, [&](std::size_t y)
+      {
+        float* output = result.row(static_cast<int>(y));
+
+        for (int t = 0; t < rows.count; ++t)
+        {
+          float const weight = rows.weights[y * rows.count + t];
+          float const* source = resized_rows.row(rows.indices[y * rows.count + t]);
+
+          for (int i = 0; i < width * 4; ++i)
+          {
+            output[i] += weight * source[i];
+          }
+        }
+      });
+
+      return fromFloat(result, image.format());
+    }
+
+    QImage toGrayscale(QImage const& image)
+    {
+      if (image.isNull())
+      {
+        return image;
+      }
+
+      FloatImage pixels = toFloat(image);
+
+      parallel_for(pixels.height, [&](std::size_t y)
+      {
+        float* row = pixels.row(static_cast<int>(y));
+
+        for (int x = 0; x < pixels.width; ++x)
+        {
+          float* pixel = row + x * 4;
+          // the weights of qGray()
+          float const gray = (pixel[0] * 11.f + pixel[1] * 16.f + pixel[2] * 5.f) / 32.f;
+          pixel[0] = pixel[1] = pixel[2] = gray;
+          pixel[3] = 1.f;
+        }
+      });
+
+      return fromFloat(pixels, image.format());
+    }
+
+    QImage fromValues(float const* values, int width, int height, int stride)
+    {
+      QImage result(width, height, QImage::Format_RGBA64);
+      uchar* bits = result.bits();
+
+      parallel_for(height, [&](std::size_t y)
+      {
+        float const* row = values + y * stride;
+        auto line = reinterpret_cast<quint16*>(bits + y * result.bytesPerLine());
+
+        for (int x = 0; x < width; ++x)
+        {
+          auto const value = static_cast<quint16>(std::min(std::max(row[x], 0.f), 1.f) * 65535.f + 0.5f);
+          line[x * 4] = line[x * 4 + 1] = line[x * 4 + 2] = value;
+          line[x * 4 + 3] = 65535;
+        }
+      });
+
+      return result;
+    }
+  }
+}
@@ -0,0 +1,40 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#ifndef NOGGIT_IMAGEFILTERS_HPP
+#define NOGGIT_IMAGEFILTERS_HPP
+
+#include <QImage>
+
+#include <vector>
+
+namespace noggit
+{
+  namespace Red::NodeEditor::Nodes::ImageFilters
+  {
+    //! odd sized, centered and normalized 1D kernels
+    std::vector<float> gaussianKernel(double sigma);
+    std::vector<float> boxKernel(int radius);
+
+    //! The filters work on rgba floats read from and written back to the
+    //! scanlines, rows spread over the parallel_for threads. Both passes of
+    //! the separable ones run over whole rows so the inner loops vectorize.
+    //! The result has the format of the input, 16 bit images stay 16 bit.
+
+    //! applies the kernel along the rows then the columns, edges clamped
+    QImage convolveSeparable(QImage const& image, std::vector<float> const& kernel);
+    QImage gaussianBlur(QImage const& image, double sigma);
+    QImage boxBlur(QImage const& image, int radius);
+
+    //! linear interpolation when enlarging, averages of the covered pixels
+    //! when shrinking
+    QImage resize(QImage const& image, int width, int height);
+
+    QImage toGrayscale(QImage const& image);
+
+    //! a 16 bit grayscale image of the values, clamped to [0, 1].
+    //! stride: distance between the starts of two rows of values
+    QImage fromValues(float const* values, int width, int height, int stride);
+  }
+}
+
+#endif //NOGGIT_IMAGEFILTERS_HPP
@@ -1,7 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "ImageGaussianBlurNode.hpp"
-#include "gaussianblur.h"
+#include "ImageFilters.hpp"
 
 #include <noggit/Red/NodeEditor/Nodes/BaseNode.inl>
 #include <noggit/Red/NodeEditor/Nodes/DataTypes/GenericData.hpp>
@@ -32,12 +32,10 @@ void ImageGaussianBlurNode::compute()
   QImage* image = static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value_ptr();
 
   QImage new_image = *image;
+  auto kernel = ImageFilters::gaussianKernel(std::max(defaultPortData<DecimalData>(PortType::In, 2)->value(), 1.0));
   for (int i = 0; i < defaultPortData<UnsignedIntegerData>(PortType::In, 3)->value(); ++i)
   {
-    GaussianBlur blur(5.0,
-                      std::max(defaultPortData<DecimalData>(PortType::In, 2)->value(), 1.0));
-
-    new_image = blur.ApplyGaussianFilterToImage(new_image);
+    new_image = ImageFilters::convolveSeparable(new_image, kernel);
   }
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "ImageResizeNode.hpp"
+#include "ImageFilters.hpp"
 
 #include <noggit/Red/NodeEditor/Nodes/BaseNode.inl>
 #include <noggit/Red/NodeEditor/Nodes/DataTypes/GenericData.hpp>
@@ -36,9 +37,19 @@ void ImageResizeNode::compute()
 {
   QImage image = static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value();
   glm::vec2 size = defaultPortData<Vector2DData>(PortType::In, 2)->value();
-  QImage new_img = image.scaled(size.x, size.y,
-                static_cast<Qt::AspectRatioMode>(_aspect_ratio_mode->currentIndex()),
-                     static_cast<Qt::TransformationMode>(_mode->currentIndex()));
+  auto aspect_ratio_mode = static_cast<Qt::AspectRatioMode>(_aspect_ratio_mode->currentIndex());
+  auto mode = static_cast<Qt::TransformationMode>(_mode->currentIndex());
+
+  QImage new_img;
+  if (mode == Qt::SmoothTransformation)
+  {
+    QSize new_size = image.size().scaled(size.x, size.y, aspect_ratio_mode);
+    new_img = ImageFilters::resize(image, new_size.width(), new_size.height());
+  }
+  else
+  {
+    new_img = image.scaled(size.x, size.y, aspect_ratio_mode, mode);
+  }
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
@@ -1,10 +1,13 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "ImageScaleNode.hpp"
+#include "ImageFilters.hpp"
 
 #include <noggit/Red/NodeEditor/Nodes/BaseNode.inl>
 #include <noggit/Red/NodeEditor/Nodes/DataTypes/GenericData.hpp>
 
+#include <cmath>
+
 using namespace noggit::Red::NodeEditor::Nodes;
 
 ImageScaleNode::ImageScaleNode()
@@ -30,10 +33,22 @@ ImageScaleNode::ImageScaleNode()
 void ImageScaleNode::compute()
 {
   glm::vec2 scale_vec = defaultPortData<Vector2DData>(PortType::In, 2)->value();
+  QImage* image = static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value_ptr();
+  auto mode = static_cast<Qt::TransformationMode>(_mode->currentIndex());
+
+  QImage new_image;
+  if (mode == Qt::SmoothTransformation)
+  {
+    int width = static_cast<int>(std::lround(image->width() * std::abs(scale_vec.x)));
+    int height = static_cast<int>(std::lround(image->height() * std::abs(scale_vec.y)));
+    new_image = ImageFilters::resize(*image, width, height).mirrored(scale_vec.x < 0.f, scale_vec.y < 0.f);
+  }
+  else
+  {
+    new_image = image->transformed(QTransform().scale(scale_vec.x, scale_vec.y), mode);
+  }
 
-  _out_ports[1].out_value = std::make_shared<ImageData>(
-      std::move(static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value().transformed(
-          QTransform().scale(scale_vec.x, scale_vec.y), static_cast<Qt::TransformationMode>(_mode->currentIndex()))));
+  _out_ports[1].out_value = std::make_shared<ImageData>(std::move(new_image));
   _node->onDataUpdated(1);
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
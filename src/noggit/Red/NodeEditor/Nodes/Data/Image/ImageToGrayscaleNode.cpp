@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "ImageToGrayscaleNode.hpp"
+#include "ImageFilters.hpp"
 
 #include <noggit/Red/NodeEditor/Nodes/BaseNode.inl>
 #include <noggit/Red/NodeEditor/Nodes/DataTypes/GenericData.hpp>
@@ -24,20 +25,7 @@ ImageToGrayscaleNode::ImageToGrayscaleNode()
 
 void ImageToGrayscaleNode::compute()
 {
-  QImage image = static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value();
-
-  for (int ii = 0; ii < image.height(); ii++)
-  {
-    uchar* scan = image.scanLine(ii);
-    int depth = 4;
-    for (int jj = 0; jj < image.width(); jj++)
-    {
-
-      QRgb* rgbpixel = reinterpret_cast<QRgb*>(scan + jj*depth);
-      int gray = qGray(*rgbpixel);
-      *rgbpixel = QColor(gray, gray, gray).rgba();
-    }
-  }
+  QImage image = ImageFilters::toGrayscale(*static_cast<ImageData*>(_in_ports[1].in_value.lock().get())->value_ptr());
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
@@ -4,6 +4,7 @@
 
 #include <noggit/Red/NodeEditor/Nodes/BaseNode.inl>
 #include <noggit/Red/NodeEditor/Nodes/DataTypes/GenericData.hpp>
+#include <noggit/Red/NodeEditor/Nodes/Data/Image/ImageFilters.hpp>
 
 #include <external/libnoise/noiseutils/noiseutils.h>
 
@@ -67,16 +68,8 @@ void NoiseToImageNode::compute()
 
   map_builder.Build();
 
-  QImage image = QImage(QSize(resolution.x, resolution.y),  QImage::Format_RGBA64);
-
-  for (int x = 0; x < static_cast<int>(resolution.x); ++x)
-  {
-    for (int y = 0; y < static_cast<int>(resolution.y); ++y)
-    {
-      float value = noise_map.GetValue(x, y);
-      image.setPixelColor(x, y, QColor::fromRgbF(value, value, value, 1.0f));
-    }
-  }
+  QImage image = ImageFilters::fromValues(noise_map.GetConstSlabPtr(0), noise_map.GetWidth(),
+                                          noise_map.GetHeight(), noise_map.GetStride());
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
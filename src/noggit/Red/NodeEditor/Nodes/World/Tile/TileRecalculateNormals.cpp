@@ -28,13 +28,15 @@ void TileRecalculateNormalsNode::compute()
 
   MapTile* tile = defaultPortData<TileData>(PortType::In, 1)->value();
 
+  std::vector<MapChunk*> chunks;
   for (int i = 0; i < 16; ++i)
   {
     for (int j = 0; j < 16; ++j)
     {
-      world->recalc_norms(tile->getChunk(i, j));
+      chunks.push_back(tile->getChunk(i, j));
     }
   }
+  world->recalc_norms(chunks);
 
   _out_ports[0].out_value = std::make_shared<LogicData>(true);
   _node->onDataUpdated(0);
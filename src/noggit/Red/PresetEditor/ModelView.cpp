@@ -136,7 +136,7 @@ void ModelViewer::tick(float dt)
 {
   if (_world)
   {
-    _world->mapIndex.enterTile (tile_index (_world_camera.position));
+    _world->mapIndex.enterTile (_world_camera.position, dt);
     _world->mapIndex.unloadTiles (tile_index (_world_camera.position));
   }
 
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include "SceneObject.hpp"
+#include <noggit/instance_render_lists.hpp>
 
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/euler_angles.hpp>
@@ -44,6 +45,10 @@ void SceneObject::updateTransformMatrix()
   _transform_mat_inverted = glm::inverse(matrix);
   _transform_mat_transposed = matrix;
 
+  if (render_slot.lists)
+  {
+    render_slot.lists->transform_changed(this);
+  }
 }
 
 void SceneObject::resetDirection()
@@ -21,6 +21,26 @@ enum SceneObjectTypes
 
 class MapTile;
 
+namespace noggit
+{
+  class instance_render_lists;
+}
+
+//! where an object is in the world's render lists, which copies of the
+//! object holding it are not part of
+struct render_list_slot
+{
+  render_list_slot() = default;
+  render_list_slot(render_list_slot const&) {}
+  render_list_slot& operator= (render_list_slot const&) { return *this; }
+
+  //! the lists the object is drawn from, null when not drawn
+  noggit::instance_render_lists* lists = nullptr;
+  int value = -1;
+  //! position in the lists' changed transforms, -1 if unchanged
+  int changed = -1;
+};
+
 class SceneObject : public Selectable
 {
 public:
@@ -68,6 +88,7 @@ public:
   float scale = 1.f;
   unsigned int uid;
   int frame;
+  render_list_slot render_slot;
 
 protected:
   SceneObjectTypes _type;
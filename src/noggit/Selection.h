@@ -50,5 +50,14 @@ enum eSelectionEntryTypes
   eEntry_MapChunk
 };
 
+//! the object a selection entry holds, nullptr for chunks
+struct selected_object_of
+{
+  selected_object_type operator() (selection_type const& entry) const
+  {
+    return entry.which() == eEntry_Object ? boost::get<selected_object_type> (entry) : nullptr;
+  }
+};
+
 using selection_entry = std::pair<float, selection_type>;
 using selection_result = std::vector<selection_entry>;
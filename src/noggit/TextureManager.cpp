@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #include <noggit/TextureManager.h>
 #include <noggit/Log.h> // LogDebug
+#include <noggit/thumbnail_cache.hpp>
 
 #include <QtCore/QString>
 #include <QtGui/QPixmap>
@@ -569,6 +570,16 @@ namespace noggit
     if(it != _cache.end())
       return &it->second;
 
+    auto const key (thumbnail_cache::key (blp_filename, QString ("blp %1x%2").arg (width).arg (height)));
+
+    if (key)
+    {
+      if (auto cached = thumbnail_cache::load (*key))
+      {
+        return &(_cache[curEntry] = std::move (*cached));
+      }
+    }
+
     opengl::context::save_current_context const context_save (::gl);
 
     _context.makeCurrent(&_surface);
@@ -618,6 +629,11 @@ namespace noggit
         ("failed rendering " + blp_filename + " to pixmap");
     }
 
+    if (key)
+    {
+      thumbnail_cache::store (*key, result);
+    }
+
     return &(_cache[curEntry] = std::move(result));
   }
 
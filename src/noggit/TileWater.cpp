@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <noggit/ChunkWater.hpp>
+#include <noggit/chunk_writer.hpp>
 #include <noggit/Log.h>
 #include <noggit/MapTile.h>
 #include <noggit/Misc.h>
@@ -131,34 +132,69 @@ void TileWater::autoGen(float factor)
   }
 }
 
-void TileWater::saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition)
+std::size_t TileWater::save_size()
 {
   if (!hasData(0))
   {
-    return;
+    return 0;
   }
 
-  int ofsW = lCurrentPosition + 0x8; //water Header pos
+  std::size_t size = sizeof(sChunkHeader) + 256 * sizeof(MH2O_Header);
 
-  lADTFile.GetPointer<MHDR>(lMHDR_Position + 8)->mh2o = lCurrentPosition - 0x14; //setting offset to MH2O data in Header
+  for (int z = 0; z < 16; ++z)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      size += chunks[z][x]->save_size();
+    }
+  }
+
+  return size;
+}
+
+std::size_t TileWater::memory_usage() const
+{
+  std::size_t usage = sizeof(TileWater)
+    + _render_layers.capacity() * sizeof(LiquidLayerDrawCallData);
+
+  for (auto const& render_layer : _render_layers)
+  {
+    usage += render_layer.texture_samplers.capacity() * sizeof(int)
+      // vertex_data_tex and chunk_data_buf
+      + sizeof(glm::vec4) * 9 * 9 * 256
+      + sizeof(opengl::LiquidChunkInstanceDataUniformBlock) * 256;
+  }
+
+  for (int z = 0; z < 16; ++z)
+  {
+    for (int x = 0; x < 16; ++x)
+    {
+      usage += chunks[z][x]->memory_usage();
+    }
+  }
+
+  return usage;
+}
+
+// only to call when save_size() is not 0
+void TileWater::saveToFile(noggit::chunk_writer& adt, std::size_t mhdr_position)
+{
+  std::size_t const chunk_pos = adt.begin_chunk('MH2O');
 
-  int headers_size = 256 * sizeof(MH2O_Header);
-  // 8 empty bytes for the chunk header
-  lADTFile.Extend(8 + headers_size);
-  // set current pos after the mh2o headers
-  lCurrentPosition = ofsW + headers_size;
-  int header_pos = ofsW;
+  adt.at<MHDR>(mhdr_position + 8)->mh2o = chunk_pos - 0x14; //setting offset to MH2O data in Header
 
+  std::size_t const ofsW = adt.position(); //water Header pos
+  std::size_t header_pos = adt.skip(256 * sizeof(MH2O_Header));
 
   for (int z = 0; z < 16; ++z)
   {
     for (int x = 0; x < 16; ++x)
     {
-      chunks[z][x]->save(lADTFile, ofsW, header_pos, lCurrentPosition);
+      chunks[z][x]->save(adt, ofsW, header_pos);
     }
   }
 
-  SetChunkHeader(lADTFile, ofsW - 8, 'MH2O', lCurrentPosition - ofsW);
+  adt.end_chunk(chunk_pos);
 }
 
 bool TileWater::hasData(size_t layer)
@@ -15,7 +15,12 @@
 
 class MapTile;
 class liquid_layer;
-class sExtendableArray;
+
+namespace noggit
+{
+  class chunk_writer;
+}
+
 enum LiquidLayerUpdateFlags;
 
 
@@ -38,7 +43,12 @@ public:
   ChunkWater* getChunk(int x, int z);
 
   void readFromFile(MPQFile &theFile, size_t basePos);
-  void saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition);
+  //! the size of the MH2O chunk, 0 when there is none to save
+  std::size_t save_size();
+  void saveToFile(noggit::chunk_writer& adt, std::size_t mhdr_position);
+
+  //! main and video memory, the latter once the layers were drawn
+  std::size_t memory_usage() const;
 
   void draw ( math::frustum const& frustum
             , const float& cull_distance
@@ -638,6 +638,7 @@ WMOGroup::WMOGroup(WMOGroup const& other)
   , _indices(other._indices)
   , _render_batch_mapping(other._render_batch_mapping)
   , _render_batches(other._render_batches)
+  , _bvh(other._bvh)
 {
   if (other.lq)
   {
@@ -1056,6 +1057,19 @@ void WMOGroup::load()
   _batches.resize (size / sizeof (wmo_batch));
   f.read (_batches.data (), size);
 
+  for (auto&& batch : _batches)
+  {
+    for (size_t i (batch.index_start); i + 2 < batch.index_start + batch.index_count; i += 3)
+    {
+      _bvh.add_triangle ( _vertices[_indices[i + 0]]
+                        , _vertices[_indices[i + 1]]
+                        , _vertices[_indices[i + 2]]
+                        );
+    }
+  }
+
+  _bvh.build();
+
   _render_batch_mapping.resize(_vertices.size());
   std::fill(_render_batch_mapping.begin(), _render_batch_mapping.end(), 0);
 
@@ -1598,21 +1612,7 @@ void WMOGroup::intersect (math::ray const& ray, std::vector<float>* results) con
   }
 
   //! \todo Also allow clicking on doodads and liquids.
-  for (auto&& batch : _batches)
-  {
-    for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; i += 3)
-    {
-      if ( auto&& distance
-         = ray.intersect_triangle ( _vertices[_indices[i + 0]]
-                                  , _vertices[_indices[i + 1]]
-                                  , _vertices[_indices[i + 2]]
-                                  )
-         )
-      {
-        results->emplace_back (*distance);
-      }
-    }
-  }
+  _bvh.intersect (ray, results);
 }
 
 /*
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 #pragma once
 #include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
 #include <noggit/MPQ.h>
 #include <noggit/ModelInstance.h> // ModelInstance
 #include <noggit/ModelManager.h>
@@ -205,6 +206,9 @@ private:
   std::vector<WMORenderBatch> _render_batches;
   std::vector<WMOCombinedDrawCall> _draw_calls;
 
+  //! the batches geometry, for picking
+  math::triangle_bvh _bvh;
+
   opengl::scoped::deferred_upload_vertex_arrays<1> _vertex_array;
   GLuint const& _vao = _vertex_array[0];
   opengl::scoped::deferred_upload_buffers<8> _buffers;
@@ -16,6 +16,8 @@
 #include <noggit/TileWater.hpp>// tile water
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/map_index.hpp>
+#include <noggit/parallel_for.hpp>
+#include <noggit/terrain_blur.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/ObjectEditor.h>
@@ -24,13 +26,13 @@
 #include <opengl/shader.hpp>
 
 #include <noggit/ActionManager.hpp>
+#include <noggit/AsyncLoader.h>
 
 #include <external/PNG2BLP/Png2Blp.h>
 #include <external/tracy/Tracy.hpp>
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
-#include <boost/pool/pool_alloc.hpp>
 
 #include <QtWidgets/QMessageBox>
 #include <QDir>
@@ -122,7 +124,6 @@ World::World(const std::string& name, int map_id, noggit::NoggitRenderContext co
     , culldistance(fogdistance)
     , skies(nullptr)
     , outdoorLightStats(OutdoorLightStats())
-    , _current_selection()
     , _settings(new QSettings())
     , _view_distance(_settings->value("view_distance", 1000.f).toFloat())
     , _context(context)
@@ -135,26 +136,7 @@ World::World(const std::string& name, int map_id, noggit::NoggitRenderContext co
 void World::update_selection_pivot()
 {
   ZoneScoped;
-  if (has_multiple_model_selected())
-  {
-    glm::vec3 pivot;
-    int model_count = 0;
-
-    for (auto const& entry : _current_selection)
-    {
-      if (entry.which() == eEntry_Object)
-      {
-        pivot += boost::get<selected_object_type>(entry)->pos;
-        model_count++;
-      }
-    }
-
-    _multi_select_pivot = pivot / static_cast<float>(model_count);
-  }
-  else
-  {
-    _multi_select_pivot = boost::none;
-  }
+  _selection.update_pivot();
 }
 
 bool World::is_selected(selection_type selection) const
@@ -163,82 +145,21 @@ bool World::is_selected(selection_type selection) const
   if (selection.which() != eEntry_Object)
     return false;
 
-  auto which = boost::get<selected_object_type>(selection)->which();
-
-  if (which == eMODEL)
-  {
-    uint uid = static_cast<ModelInstance*>(boost::get<selected_object_type>(selection))->uid;
-    auto const& it = std::find_if(_current_selection.begin()
-                                  , _current_selection.end()
-                                  , [uid] (selection_type type)
-    {
-      return type.type() == typeid(selected_object_type)
-        && boost::get<selected_object_type>(type)->which() == eMODEL
-        && static_cast<ModelInstance*>(boost::get<selected_object_type>(type))->uid == uid;
-    }
-    );
-
-    if (it != _current_selection.end())
-    {
-      return true;
-    }
-  }
-  else if (which == eWMO)
-  {
-    uint uid = static_cast<WMOInstance*>(boost::get<selected_object_type>(selection))->uid;
-    auto const& it = std::find_if(_current_selection.begin()
-                            , _current_selection.end()
-                            , [uid] (selection_type type)
-    {
-      return type.type() == typeid(selected_object_type)
-        && boost::get<selected_object_type>(type)->which() == eWMO
-        && static_cast<WMOInstance*>(boost::get<selected_object_type>(type))->uid == uid;
-    }
-    );
-    if (it != _current_selection.end())
-    {
-      return true;
-    }
-  }
-
-  return false;
+  return is_selected(boost::get<selected_object_type>(selection)->uid);
 }
 
 bool World::is_selected(std::uint32_t uid) const
 {
   ZoneScoped;
-  for (selection_type const& entry : _current_selection)
-  {
-    if (entry.which() != eEntry_Object)
-      continue;
-
-    auto obj = boost::get<selected_object_type>(entry);
-
-    if (obj->which() == eWMO)
-    {
-      if (static_cast<WMOInstance*>(obj)->uid == uid)
-      {
-        return true;
-      }
-    }
-    else if (obj->which() == eMODEL)
-    {
-      if (static_cast<ModelInstance*>(obj)->uid == uid)
-      {
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return _selection.contains(uid);
 }
 
 boost::optional<selection_type> World::get_last_selected_model() const
 {
   ZoneScoped;
   auto const it
-    ( std::find_if ( _current_selection.rbegin()
-                   , _current_selection.rend()
+    ( std::find_if ( current_selection().rbegin()
+                   , current_selection().rend()
                    , [&] (selection_type const& entry)
                      {
                        return entry.which() != eEntry_MapChunk;
@@ -246,7 +167,7 @@ boost::optional<selection_type> World::get_last_selected_model() const
                    )
     );
 
-  return it == _current_selection.rend()
+  return it == current_selection().rend()
     ? boost::optional<selection_type>() : boost::optional<selection_type> (*it);
 }
 
@@ -286,7 +207,7 @@ void World::rotate_selected_models_randomly(float minX, float maxX, float minY,
   ZoneScoped;
   bool has_multi_select = has_multiple_model_selected();
 
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -362,7 +283,7 @@ void World::rotate_selected_models_randomly(float minX, float maxX, float minY,
 void World::rotate_selected_models_to_ground_normal(bool smoothNormals)
 {
   ZoneScoped;
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -503,78 +424,56 @@ void World::rotate_selected_models_to_ground_normal(bool smoothNormals)
 void World::set_current_selection(selection_type entry)
 {
   ZoneScoped;
-  _current_selection.clear();
-  _current_selection.push_back(entry);
-  _multi_select_pivot = boost::none;
-
-  _selected_model_count = entry.which() == eEntry_MapChunk ? 0 : 1;
+  reset_selection();
+  add_to_selection(entry);
 }
 
 void World::add_to_selection(selection_type entry)
 {
   ZoneScoped;
-  if (entry.which() != eEntry_MapChunk)
-  {
-    _selected_model_count++;
-  }
+  _selection.add(entry);
+}
 
-  _current_selection.push_back(entry);
-  update_selection_pivot();
+void World::add_to_selection(std::vector<selection_type> const& entries)
+{
+  ZoneScoped;
+  _selection.add(entries);
 }
 
 void World::remove_from_selection(selection_type entry)
 {
   ZoneScoped;
-  std::vector<selection_type>::iterator position = std::find(_current_selection.begin(), _current_selection.end(), entry);
-  if (position != _current_selection.end())
+  if (entry.which() == eEntry_Object)
   {
-    if (entry.which() != eEntry_MapChunk)
-    {
-      _selected_model_count--;
-    }
-
-    _current_selection.erase(position);
-    update_selection_pivot();
+    remove_from_selection(boost::get<selected_object_type>(entry)->uid);
+    return;
   }
+
+  _selection.remove(entry);
 }
 
 void World::remove_from_selection(std::uint32_t uid)
 {
   ZoneScoped;
-  for (auto it = _current_selection.begin(); it != _current_selection.end(); ++it)
-  {
-    if (it->which() != eEntry_Object)
-      continue;
-
-    auto obj = boost::get<selected_object_type>(*it);
+  remove_from_selection(std::vector<std::uint32_t>{uid});
+}
 
-    if (obj->which() == eMODEL && static_cast<ModelInstance*>(obj)->uid == uid)
-    {
-      _current_selection.erase(it);
-      update_selection_pivot();
-      return;
-    }
-    else if (obj->which() == eWMO && static_cast<WMOInstance*>(obj)->uid == uid)
-    {
-      _current_selection.erase(it);
-      update_selection_pivot();
-      return;
-    }
-  }
+void World::remove_from_selection(std::vector<std::uint32_t> const& uids)
+{
+  ZoneScoped;
+  _selection.remove(uids);
 }
 
 void World::reset_selection()
 {
   ZoneScoped;
-  _current_selection.clear();
-  _multi_select_pivot = boost::none;
-  _selected_model_count = 0;
+  _selection.clear();
 }
 
 void World::delete_selected_models()
 {
   ZoneScoped;
-  _model_instance_storage.delete_instances(_current_selection);
+  _model_instance_storage.delete_instances(current_selection());
   need_model_updates = true;
   reset_selection();
 }
@@ -582,7 +481,7 @@ void World::delete_selected_models()
 void World::snap_selected_models_to_the_ground()
 {
   ZoneScoped;
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -632,7 +531,7 @@ void World::snap_selected_models_to_the_ground()
 void World::scale_selected_models(float v, m2_scaling_type type)
 {
   ZoneScoped;
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     if (entry.which() == eEntry_Object)
     {
@@ -677,7 +576,7 @@ void World::scale_selected_models(float v, m2_scaling_type type)
 void World::move_selected_models(float dx, float dy, float dz)
 {
   ZoneScoped;
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -709,7 +608,7 @@ void World::set_selected_models_pos(glm::vec3 const& pos, bool change_height)
   // move models relative to the pivot when several are selected
   if (has_multiple_model_selected())
   {
-    glm::vec3 diff = pos - _multi_select_pivot.get();
+    glm::vec3 diff = pos - multi_select_pivot().get();
 
     if (change_height)
     {
@@ -723,7 +622,7 @@ void World::set_selected_models_pos(glm::vec3 const& pos, bool change_height)
     return;
   }
 
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -750,7 +649,7 @@ void World::rotate_selected_models(math::degrees rx, math::degrees ry, math::deg
   math::degrees::vec3 dir_change(rx._, ry._, rz._);
   bool has_multi_select = has_multiple_model_selected();
 
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -767,7 +666,7 @@ void World::rotate_selected_models(math::degrees rx, math::degrees ry, math::deg
     {
       glm::vec3& pos = obj->pos;
       math::degrees::vec3& dir = obj->dir;
-      glm::vec3 diff_pos = pos - _multi_select_pivot.get();
+      glm::vec3 diff_pos = pos - multi_select_pivot().get();
 
       glm::quat rotationQuat = glm::quat(glm::vec3(glm::radians(rx._), glm::radians(ry._), glm::radians(rz._)));
       glm::vec3 rot_result = glm::toMat4(rotationQuat) * glm::vec4(diff_pos,0);
@@ -791,7 +690,7 @@ void World::set_selected_models_rotation(math::degrees rx, math::degrees ry, mat
   ZoneScoped;
   math::degrees::vec3 new_dir(rx._, ry._, rz._);
 
-  for (auto& entry : _current_selection)
+  for (auto& entry : current_selection())
   {
     auto type = entry.which();
     if (type == eEntry_MapChunk)
@@ -1355,8 +1254,8 @@ void World::draw (glm::mat4x4 const& model_view
     ZoneScopedN("World::draw() : Draw pivot point");
     opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> const disable_depth_test;
 
-    float dist = glm::distance(camera_pos, _multi_select_pivot.get());
-    _sphere_render.draw(mvp, _multi_select_pivot.get(), cursor_color, std::min(2.f, std::max(0.15f, dist * 0.02f)));
+    float dist = glm::distance(camera_pos, multi_select_pivot().get());
+    _sphere_render.draw(mvp, multi_select_pivot().get(), cursor_color, std::min(2.f, std::max(0.15f, dist * 0.02f)));
   }
 
   if (use_ref_pos)
@@ -1381,9 +1280,6 @@ void World::draw (glm::mat4x4 const& model_view
 
   std::unordered_map<Model*, std::size_t> model_with_particles;
 
-  tsl::robin_map<Model*, std::vector<glm::mat4x4, boost::pool_allocator<glm::mat4x4>>> models_to_draw;
-  std::vector<WMOInstance*, boost::pool_allocator<WMOInstance*>> wmos_to_draw;
-
   static int frame = 0;
 
   if (frame == std::numeric_limits<int>::max())
@@ -1395,6 +1291,11 @@ void World::draw (glm::mat4x4 const& model_view
     frame++;
   }
 
+  // the lists are only updated with what changed since the last frame
+  std::unique_lock<std::mutex> render_lists_lock (_render_lists.mutex());
+  _render_lists.begin_pass(frame);
+  _instance_culling.reset();
+
   for (auto& pair : _loaded_tiles_buffer)
   {
     MapTile* tile = pair.second;
@@ -1419,21 +1320,6 @@ void World::draw (glm::mat4x4 const& model_view
     {
       if (pair.second[0]->which() == eMODEL)
       {
-        auto& instances = models_to_draw[reinterpret_cast<Model*>(pair.first)];
-
-        // memory allocation heuristic. all objects will pass if tile is entirely in frustum.
-        // otherwise we only allocate for a half
-
-        if (tile->objects_frustum_cull_test > 1)
-        {
-          instances.reserve(instances.size() + pair.second.size());
-        }
-        else
-        {
-          instances.reserve(instances.size() + pair.second.size() / 2);
-        }
-
-
         for (auto& instance : pair.second)
         {
           // do not render twice the cross-referenced objects twice
@@ -1444,30 +1330,17 @@ void World::draw (glm::mat4x4 const& model_view
 
           instance->frame = frame;
 
-          auto m2_instance = static_cast<ModelInstance*>(instance);
-
-          if ((tile->objects_frustum_cull_test > 1 || m2_instance->isInFrustum(frustum)) && m2_instance->isInRenderDist(culldistance, camera_pos, display))
-          {
-            instances.push_back(m2_instance->transformMatrixTransposed());
-          }
+          auto model_instance = static_cast<ModelInstance*>(instance);
+          model_instance->ensureExtents();
 
+          _instance_culling.add ( instance, instance->extents, instance->pos
+                                , tile->objects_frustum_cull_test > 1
+                                , true, model_instance->model->rad * instance->scale, model_instance->size_cat
+                                );
         }
-
       }
       else
       {
-        // memory allocation heuristic. all objects will pass if tile is entirely in frustum.
-        // otherwise we only allocate for a half
-
-        if (tile->objects_frustum_cull_test > 1)
-        {
-          wmos_to_draw.reserve(wmos_to_draw.size() + pair.second.size());
-        }
-        else
-        {
-          wmos_to_draw.reserve(wmos_to_draw.size() + pair.second.size() / 2);
-        }
-
         for (auto& instance : pair.second)
         {
           // do not render twice the cross-referenced objects twice
@@ -1478,17 +1351,58 @@ void World::draw (glm::mat4x4 const& model_view
 
           instance->frame = frame;
 
-          auto wmo_instance = static_cast<WMOInstance*>(instance);
-
-          if (tile->objects_frustum_cull_test > 1 || frustum.intersects(wmo_instance->extents[1], wmo_instance->extents[0]))
-          {
-            wmos_to_draw.push_back(wmo_instance);
-          }
+          _instance_culling.add ( instance, instance->extents, instance->pos
+                                , tile->objects_frustum_cull_test > 1
+                                , false, 0.f, 0.f
+                                );
         }
       }
     }
   }
 
+  _instance_culling.compute(frustum, culldistance, camera_pos, display);
+
+  for (std::size_t i = 0; i < _instance_culling.size(); ++i)
+  {
+    SceneObject* instance = _instance_culling.instance(i);
+
+    if (!_instance_culling.visible(i))
+    {
+      _render_lists.hide(instance);
+    }
+    else if (instance->which() == eMODEL)
+    {
+      _render_lists.show(static_cast<ModelInstance*>(instance));
+    }
+    else
+    {
+      _render_lists.show(static_cast<WMOInstance*>(instance));
+    }
+  }
+
+  _render_lists.end_pass();
+
+  // whatever is in view and still loading jumps the loader queue
+  {
+    auto& async_loader = AsyncLoader::instance();
+
+    for (auto& pair : _render_lists.models())
+    {
+      if (!pair.first->finishedLoading())
+      {
+        async_loader.prioritize(pair.first, async_priority::high);
+      }
+    }
+
+    for (auto& instance : _render_lists.wmos())
+    {
+      if (!instance->wmo->finishedLoading())
+      {
+        async_loader.prioritize(instance->wmo.get(), async_priority::high);
+      }
+    }
+  }
+
   // WMOs / map objects
   if (draw_wmo || mapIndex.hasAGlobalWMO())
   {
@@ -1499,7 +1413,7 @@ void World::draw (glm::mat4x4 const& model_view
       wmo_program.uniform("camera", glm::vec3(camera_pos.x, camera_pos.y, camera_pos.z));
 
 
-      for (auto& instance: wmos_to_draw)
+      for (auto& instance: _render_lists.wmos())
       {
         bool is_hidden = instance->wmo->is_hidden();
 
@@ -1602,6 +1516,29 @@ void World::draw (glm::mat4x4 const& model_view
       update_models_by_filename();
     }
 
+    if (draw_models)
+    {
+      ZoneScopedN("World::draw() : Animate M2s");
+
+      // only the models with visible instances, the draws upload the bones
+      std::vector<Model*> animated_models;
+      for (auto const& pair : _render_lists.models())
+      {
+        if (draw_hidden_models || !pair.first->is_hidden())
+        {
+          animated_models.push_back (pair.first);
+        }
+      }
+
+      noggit::parallel_for
+        ( animated_models.size()
+        , [&] (std::size_t i)
+          {
+            animated_models[i]->prepare_animation (model_view, animtime);
+          }
+        );
+    }
+
     std::unordered_map<Model*, std::size_t> model_boxes_to_draw;
 
     {
@@ -1624,12 +1561,16 @@ void World::draw (glm::mat4x4 const& model_view
         m2_shader.uniform("tex_unit_lookup_2", 0);
         m2_shader.uniform("pixel_shader", 0);
 
-        for (auto& pair : models_to_draw)
+        auto& models = _render_lists.models();
+
+        for (auto it = models.begin(); it != models.end(); ++it)
         {
-          if (draw_hidden_models || !pair.first->is_hidden())
+          auto& model_instances = it.value();
+
+          if (draw_hidden_models || !it->first->is_hidden())
           {
-            pair.first->draw( model_view
-                , reinterpret_cast<std::vector<glm::mat4x4> const&>(pair.second)
+            it->first->draw( model_view
+                , model_instances.transforms
                 , m2_shader
                 , model_render_state
                 , frustum
@@ -1639,7 +1580,10 @@ void World::draw (glm::mat4x4 const& model_view
                 , draw_models_with_box
                 , model_boxes_to_draw
                 , display
+                , false
+                , model_instances.changed
             );
+            model_instances.changed = false;
           }
         }
 
@@ -1687,14 +1631,6 @@ void World::draw (glm::mat4x4 const& model_view
     gl.depthMask(GL_TRUE);
 
 
-    models_to_draw.clear();
-    wmos_to_draw.clear();
-    boost::singleton_pool<boost::pool_allocator_tag
-    , sizeof(std::vector<glm::mat4x4, boost::pool_allocator<glm::mat4x4>>)>::purge_memory();
-
-    boost::singleton_pool<boost::pool_allocator_tag
-        , sizeof(std::vector<WMOInstance*, boost::pool_allocator<WMOInstance*>>)>::purge_memory();
-
     if(draw_models_with_box || (draw_hidden_models && !model_boxes_to_draw.empty()))
     {
       opengl::scoped::use_program m2_box_shader{ *_m2_box_program.get() };
@@ -1735,6 +1671,8 @@ void World::draw (glm::mat4x4 const& model_view
     }
   }
 
+  render_lists_lock.unlock();
+
   // set anim time only once per frame
   {
     opengl::scoped::use_program water_shader {*_liquid_program.get()};
@@ -1942,31 +1880,30 @@ selection_result World::intersect (glm::mat4x4 const& model_view
     }
   }
 
-  if (!pOnlyMap && do_objects)
+  if (!pOnlyMap && do_objects && (draw_models || draw_wmo))
   {
-    if (draw_models)
+    ZoneScopedN("World::intersect() : intersect objects");
+    _model_instance_storage.intersect(ray, &results, [&] (SceneObject& instance)
     {
-      ZoneScopedN("World::intersect() : intersect M2s");
-      _model_instance_storage.for_each_m2_instance([&] (ModelInstance& model_instance)
+      if (instance.which() == eMODEL && draw_models)
       {
+        auto& model_instance = static_cast<ModelInstance&>(instance);
+
         if (draw_hidden_models || !model_instance.model->is_hidden())
         {
           model_instance.intersect(model_view, ray, &results, animtime);
         }
-      });
-    }
-
-    if (draw_wmo)
-    {
-      ZoneScopedN("World::intersect() : intersect WMOs");
-      _model_instance_storage.for_each_wmo_instance([&] (WMOInstance& wmo_instance)
+      }
+      else if (instance.which() == eWMO && draw_wmo)
       {
+        auto& wmo_instance = static_cast<WMOInstance&>(instance);
+
         if (draw_hidden_models || !wmo_instance.wmo->is_hidden())
         {
           wmo_instance.intersect(ray, &results);
         }
-      });
-    }
+      }
+    });
   }
 
   return std::move(results);
@@ -1992,14 +1929,14 @@ unsigned int World::getAreaID (glm::vec3 const& pos)
 void World::clearHeight(glm::vec3 const& pos)
 {
   ZoneScoped;
-  for_all_chunks_on_tile(pos, [](MapChunk* chunk)
+  std::vector<MapChunk*> chunks;
+  for_all_chunks_on_tile(pos, [&](MapChunk* chunk)
   {
     noggit::ActionManager::instance()->getCurrentAction()->registerChunkTerrainChange(chunk);
     chunk->clearHeight();
+    chunks.emplace_back(chunk);
   });
-  for_all_chunks_on_tile(pos, [this] (MapChunk* chunk) {
-      recalc_norms (chunk);
-  });
+  recalc_norms (chunks);
 }
 
 void World::clearAllModelsOnADT(tile_index const& tile)
@@ -2194,6 +2131,7 @@ auto World::stamp(glm::vec3 const& pos, float dt, QImage const* img, float radiu
 void World::changeTerrain(glm::vec3 const& pos, float change, float radius, int BrushType, float inner_radius)
 {
   ZoneScoped;
+  std::vector<MapChunk*> modified_chunks;
   for_all_chunks_in_range
     ( pos, radius
     , [&] (MapChunk* chunk)
@@ -2201,16 +2139,18 @@ void World::changeTerrain(glm::vec3 const& pos, float change, float radius, int
         noggit::ActionManager::instance()->getCurrentAction()->registerChunkTerrainChange(chunk);
         return chunk->changeTerrain(pos, change, radius, BrushType, inner_radius);
       }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        modified_chunks.emplace_back (chunk);
       }
     );
+  recalc_norms (modified_chunks);
 }
 
 void World::flattenTerrain(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode, const glm::vec3& origin, math::degrees angle, math::degrees orientation)
 {
   ZoneScoped;
+  std::vector<MapChunk*> modified_chunks;
   for_all_chunks_in_range
     ( pos, radius
     , [&] (MapChunk* chunk)
@@ -2218,39 +2158,55 @@ void World::flattenTerrain(glm::vec3 const& pos, float remain, float radius, int
         noggit::ActionManager::instance()->getCurrentAction()->registerChunkTerrainChange(chunk);
         return chunk->flattenTerrain(pos, remain, radius, BrushType, mode, origin, angle, orientation);
       }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        modified_chunks.emplace_back (chunk);
       }
     );
+  recalc_norms (modified_chunks);
 }
 
 void World::blurTerrain(glm::vec3 const& pos, float remain, float radius, int BrushType, flatten_mode const& mode)
 {
   ZoneScoped;
+
+  if (BrushType == eFlattenType_Origin)
+  {
+    return;
+  }
+
+  // the averages of the vertices in the brush involve the ones within twice its radius
+  noggit::terrain_blur blur (pos, radius);
+
+  for (MapTile* tile : mapIndex.tiles_in_range (pos, 2.f * radius))
+  {
+    if (!tile->finishedLoading())
+    {
+      continue;
+    }
+
+    for (MapChunk* chunk : tile->chunks_in_range (pos, 2.f * radius))
+    {
+      blur.add_vertices (chunk->mVertices, mapbufsize);
+    }
+  }
+
+  blur.compute();
+
+  std::vector<MapChunk*> modified_chunks;
   for_all_chunks_in_range
     ( pos, radius
     , [&] (MapChunk* chunk)
       {
         noggit::ActionManager::instance()->getCurrentAction()->registerChunkTerrainChange(chunk);
-        return chunk->blurTerrain ( pos
-                                  , remain
-                                  , radius
-                                  , BrushType
-                                  , mode
-                                  , [this] (float x, float z) -> boost::optional<float>
-                                    {
-                                      glm::vec3 vec;
-                                      auto res (GetVertex (x, z, &vec));
-                                      return boost::make_optional (res, vec.y);
-                                    }
-                                  );
+        return chunk->blurTerrain (pos, remain, radius, BrushType, mode, blur);
       }
-    , [this] (MapChunk* chunk)
+    , [&] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        modified_chunks.emplace_back (chunk);
       }
     );
+  recalc_norms (modified_chunks);
 }
 
 void World::recalc_norms (MapChunk* chunk) const
@@ -2259,6 +2215,37 @@ void World::recalc_norms (MapChunk* chunk) const
     chunk->recalcNorms();
 }
 
+void World::recalc_norms (std::vector<MapChunk*> const& chunks) const
+{
+  ZoneScoped;
+  std::vector<std::pair<MapTile*, std::vector<MapChunk*>>> tiles;
+
+  for (MapChunk* chunk : chunks)
+  {
+    auto it ( std::find_if ( tiles.begin(), tiles.end()
+                           , [&] (auto const& tile) { return tile.first == chunk->mt; }
+                           )
+            );
+
+    if (it == tiles.end())
+    {
+      tiles.emplace_back (chunk->mt, std::vector<MapChunk*>());
+      it = std::prev (tiles.end());
+    }
+
+    it->second.emplace_back (chunk);
+  }
+
+  // each tile only writes its own normals, neighbors are only read
+  noggit::parallel_for
+    ( tiles.size()
+    , [&] (std::size_t i)
+      {
+        tiles[i].first->recalcNorms (tiles[i].second);
+      }
+    );
+}
+
 bool World::paintTexture(glm::vec3 const& pos, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture)
 {
   ZoneScoped;
@@ -2406,9 +2393,17 @@ void World::convert_alphamap(bool to_big_alpha)
         mTile->wait_until_loaded();
 
         mTile->convert_alphamap(to_big_alpha);
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
+        if (mTile->saveTile(this))
+        {
+          mapIndex.markOnDisc (tile, true);
+          mapIndex.unsetChanged(tile);
+        }
+        else
+        {
+          // kept loaded with its changes, so it can be saved again
+          mTile->changed = true;
+          unload = false;
+        }
 
         if (unload)
         {
@@ -2578,6 +2573,8 @@ bool World::saveMinimap(tile_index const& tile_idx, MinimapRenderSettings* setti
       out.writeRawData(reinterpret_cast<char*>(blp_image), file_size);
 
       file.close();
+
+      MPQFile::project_file_created ("textures/minimap/" + tex_name);
     }
 
     // Write combined file
@@ -2843,7 +2840,7 @@ void World::remove_models_if_needed(std::vector<uint32_t> const& uids)
   }
 
   // deselect the terrain when an adt is unloaded
-  if (_current_selection.size() == 1 && _current_selection.at(0).which() == eEntry_MapChunk)
+  if (current_selection().size() == 1 && current_selection().at(0).which() == eEntry_MapChunk)
   {
     reset_selection();
   }
@@ -2894,12 +2891,14 @@ void World::updateTilesEntry(SceneObject* entry, model_update type)
 void World::updateTilesWMO(WMOInstance* wmo, model_update type)
 {
   ZoneScoped;
+  _model_instance_storage.update_instance_bounds(wmo);
   _tile_update_queue.queue_update(wmo, type);
 }
 
 void World::updateTilesModel(ModelInstance* m2, model_update type)
 {
   ZoneScoped;
+  _model_instance_storage.update_instance_bounds(m2);
   _tile_update_queue.queue_update(m2, type);
 }
 
@@ -3483,10 +3482,7 @@ void World::fixAllGaps()
     }
   }
 
-  for (MapChunk* chunk : chunks)
-  {
-    recalc_norms (chunk);
-  }
+  recalc_norms (chunks);
 }
 
 bool World::isUnderMap(glm::vec3 const& pos)
@@ -3585,8 +3581,8 @@ void World::updateSelectedVertices()
   for (MapChunk* chunk : _vertex_chunks)
   {
     chunk->registerChunkUpdate(ChunkUpdateFlags::VERTEX);
-    recalc_norms (chunk);
   }
+  recalc_norms (std::vector<MapChunk*> (_vertex_chunks.begin(), _vertex_chunks.end()));
 }
 
 void World::orientVertices ( glm::vec3 const& ref_pos
@@ -3696,6 +3692,8 @@ void World::range_add_to_selection(glm::vec3 const& pos, float radius, bool remo
 
     if (remove)
     {
+      std::vector<std::uint32_t> to_remove;
+
       for (uint32_t uid : *uids)
       {
         auto instance = _model_instance_storage.get_instance(uid);
@@ -3704,16 +3702,20 @@ void World::range_add_to_selection(glm::vec3 const& pos, float radius, bool remo
         {
           auto obj = boost::get<selected_object_type>(instance.get());
 
-          if (glm::distance(obj->pos, pos) <= radius && is_selected(obj))
+          if (glm::distance(obj->pos, pos) <= radius && is_selected(obj->uid))
           {
-            remove_from_selection(obj);
+            to_remove.push_back(obj->uid);
           }
 
         }
       }
+
+      remove_from_selection(to_remove);
     }
     else
     {
+      std::vector<selection_type> to_add;
+
       for (uint32_t uid : *uids)
       {
         auto instance = _model_instance_storage.get_instance(uid);
@@ -3722,13 +3724,15 @@ void World::range_add_to_selection(glm::vec3 const& pos, float radius, bool remo
         {
           auto obj = boost::get<selected_object_type>(instance.get());
 
-          if (glm::distance(obj->pos, pos) <= radius && !is_selected(obj))
+          if (glm::distance(obj->pos, pos) <= radius && !is_selected(obj->uid))
           {
-            add_to_selection(obj);
+            to_add.push_back(obj);
           }
 
         }
       }
+
+      add_to_selection(to_add);
     }
     
   });
@@ -4097,9 +4101,17 @@ void World::importAllADTsAlphamaps()
 
         }
 
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
+        if (mTile->saveTile(this))
+        {
+          mapIndex.markOnDisc (tile, true);
+          mapIndex.unsetChanged(tile);
+        }
+        else
+        {
+          // kept loaded with its changes, so it can be saved again
+          mTile->changed = true;
+          unload = false;
+        }
 
         if (unload)
         {
@@ -4152,9 +4164,17 @@ void World::importAllADTsHeightmaps(float multiplier, unsigned int mode)
           mTile->setHeightmapImage(img, multiplier, mode);
         }
 
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
+        if (mTile->saveTile(this))
+        {
+          mapIndex.markOnDisc (tile, true);
+          mapIndex.unsetChanged(tile);
+        }
+        else
+        {
+          // kept loaded with its changes, so it can be saved again
+          mTile->changed = true;
+          unload = false;
+        }
 
         if (unload)
         {
@@ -4207,9 +4227,17 @@ void World::importAllADTVertexColorMaps(unsigned int mode)
           mTile->setVertexColorImage(img, mode);
         }
 
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
+        if (mTile->saveTile(this))
+        {
+          mapIndex.markOnDisc (tile, true);
+          mapIndex.unsetChanged(tile);
+        }
+        else
+        {
+          // kept loaded with its changes, so it can be saved again
+          mTile->changed = true;
+          unload = false;
+        }
 
         if (unload)
         {
@@ -4259,9 +4287,17 @@ void World::ensureAllTilesetsAllADTs()
           }
         }
 
-        mTile->saveTile(this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
+        if (mTile->saveTile(this))
+        {
+          mapIndex.markOnDisc (tile, true);
+          mapIndex.unsetChanged(tile);
+        }
+        else
+        {
+          // kept loaded with its changes, so it can be saved again
+          mTile->changed = true;
+          unload = false;
+        }
 
         if (unload)
         {
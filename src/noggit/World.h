@@ -11,6 +11,9 @@
 #include <noggit/Sky.h> // Skies, OutdoorLighting, OutdoorLightStats
 #include <noggit/WMO.h> // WMOManager
 #include <noggit/map_horizon.h>
+#include <noggit/instance_culling.hpp>
+#include <noggit/instance_render_lists.hpp>
+#include <noggit/object_selection.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/tile_index.hpp>
 #include <noggit/tool_enums.hpp>
@@ -53,9 +56,11 @@ using StripType = uint16_t;
 class World
 {
 private:
-  std::vector<selection_type> _current_selection;
+  noggit::object_selection<selection_type, selected_object_of> _selection;
   std::unordered_map<std::string, std::vector<ModelInstance*>> _models_by_filename;
   noggit::world_model_instances_storage _model_instance_storage;
+  noggit::instance_render_lists _render_lists;
+  noggit::instance_culling _instance_culling;
   noggit::world_tile_update_queue _tile_update_queue;
   std::mutex _guard;
 
@@ -149,32 +154,33 @@ public:
   MapChunk* getChunkAt(glm::vec3 const& pos);
 
 private:
-  // Information about the currently selected model / WMO / triangle.
-  int _selected_model_count = 0;
-  boost::optional<glm::vec3> _multi_select_pivot;
 public:
 
   void unload_shaders();
 
+  //! to call once selected objects moved
   void update_selection_pivot();
-  boost::optional<glm::vec3> const& multi_select_pivot() const { return _multi_select_pivot; }
+  boost::optional<glm::vec3> const& multi_select_pivot() const { return _selection.pivot(); }
 
   // Selection related methods.
   bool is_selected(selection_type selection) const;
   bool is_selected(std::uint32_t uid) const;
-  std::vector<selection_type> const& current_selection() const { return _current_selection; }
+  std::vector<selection_type> const& current_selection() const { return _selection.entries(); }
   boost::optional<selection_type> get_last_selected_model() const;
-  bool has_selection() const { return !_current_selection.empty(); }
-  bool has_multiple_model_selected() const { return _selected_model_count > 1; }
-  int get_selected_model_count() const { return _selected_model_count; }
+  bool has_selection() const { return !_selection.empty(); }
+  bool has_multiple_model_selected() const { return _selection.object_count() > 1; }
+  int get_selected_model_count() const { return _selection.object_count(); }
   void set_current_selection(selection_type entry);
   void add_to_selection(selection_type entry);
+  void add_to_selection(std::vector<selection_type> const& entries);
   void remove_from_selection(selection_type entry);
   void remove_from_selection(std::uint32_t uid);
+  void remove_from_selection(std::vector<std::uint32_t> const& uids);
   void reset_selection();
   void delete_selected_models();
   void range_add_to_selection(glm::vec3 const& pos, float radius, bool remove);
   noggit::world_model_instances_storage& getModelInstanceStorage() { return _model_instance_storage; };
+  noggit::instance_render_lists& render_lists() { return _render_lists; };
 
   enum class m2_scaling_type
   {
@@ -398,6 +404,8 @@ public:
   void initShaders();
 
   void recalc_norms (MapChunk*) const;
+  //! batched per tile, the tiles being processed in parallel
+  void recalc_norms (std::vector<MapChunk*> const&) const;
 
   noggit::VertexSelectionCache getVertexSelectionCache();
   void setVertexSelectionCache(noggit::VertexSelectionCache& cache);
@@ -0,0 +1,39 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace Animation
+{
+  //! the i such as times[i] <= time < times[i + 1], 0 if there is none.
+  //! cursor is the key of the previous lookup on the same track: the key
+  //! itself and the one after it are checked first, which covers forward
+  //! playback, anything else is a binary search.
+  inline std::size_t find_key ( std::uint32_t const* times
+                              , std::size_t count
+                              , std::uint32_t time
+                              , std::uint32_t& cursor
+                              )
+  {
+    auto const is_key = [&] (std::size_t i)
+    {
+      return i + 1 < count && times[i] <= time && time < times[i + 1];
+    };
+
+    if (is_key (cursor))
+    {
+      return cursor;
+    }
+    if (is_key (cursor + 1))
+    {
+      return ++cursor;
+    }
+
+    std::size_t const next (std::upper_bound (times, times + count, time) - times);
+    cursor = next == 0 || next == count ? 0 : static_cast<std::uint32_t> (next - 1);
+    return cursor;
+  }
+}
@@ -225,6 +225,7 @@ Noggit::Noggit(int argc, char *argv[])
 
 
   QSettings settings;
+  SetLogSeverity(settings.value("debug_log", true).toBool() ? LogSeverity::Debug : LogSeverity::Info);
   doAntiAliasing = settings.value("antialiasing", false).toBool();
   fullscreen = settings.value("fullscreen", false).toBool();
 
@@ -0,0 +1,49 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/chunk_writer.hpp>
+#include <noggit/Misc.h>
+
+namespace noggit
+{
+  chunk_writer::chunk_writer (std::size_t size)
+    : _expected_size (size)
+  {
+    _data.reserve (size);
+  }
+
+  std::size_t chunk_writer::chunk (int magic, std::size_t size)
+  {
+    std::size_t const position (skip (sizeof (sChunkHeader)));
+
+    auto header (at<sChunkHeader> (position));
+    header->mMagic = magic;
+    header->mSize = static_cast<int> (size);
+
+    return position;
+  }
+
+  void chunk_writer::end_chunk (std::size_t header_position)
+  {
+    at<sChunkHeader> (header_position)->mSize
+      = static_cast<int> (position() - header_position - sizeof (sChunkHeader));
+  }
+
+  std::size_t chunk_writer::skip (std::size_t size)
+  {
+    std::size_t const position (_data.size());
+    _data.resize (position + size);
+    return position;
+  }
+
+  void chunk_writer::write (void const* data, std::size_t size)
+  {
+    std::size_t const position (skip (size));
+    std::memcpy (_data.data() + position, data, size);
+  }
+
+  std::ptrdiff_t chunk_writer::remaining() const
+  {
+    return static_cast<std::ptrdiff_t> (_expected_size)
+         - static_cast<std::ptrdiff_t> (_data.size());
+  }
+}
@@ -0,0 +1,55 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace noggit
+{
+  //! writes a chunked file front to back. the buffer is allocated once
+  //! with the size computed by the caller beforehand, so nothing written
+  //! is ever moved. chunks which size is not known when they begin are
+  //! closed with end_chunk().
+  class chunk_writer
+  {
+  public:
+    explicit chunk_writer (std::size_t size);
+
+    std::size_t position() const { return _data.size(); }
+
+    //! returns the position of the chunk header
+    std::size_t chunk (int magic, std::size_t size);
+    std::size_t begin_chunk (int magic) { return chunk (magic, 0); }
+    void end_chunk (std::size_t header_position);
+
+    //! zero filled, returns the position of the first byte
+    std::size_t skip (std::size_t size);
+    void write (void const* data, std::size_t size);
+    void write (std::string const& string) { write (string.c_str(), string.size() + 1); }
+
+    template<typename T>
+      void write (T const& value)
+    {
+      write (&value, sizeof (T));
+    }
+
+    //! only valid until the next write when the size given was too small
+    template<typename T>
+      T* at (std::size_t position)
+    {
+      return reinterpret_cast<T*> (_data.data() + position);
+    }
+
+    //! the size given to the constructor minus the size written
+    std::ptrdiff_t remaining() const;
+
+    std::vector<char>& data() { return _data; }
+
+  private:
+    std::size_t _expected_size;
+    std::vector<char> _data;
+  };
+}
@@ -134,6 +134,7 @@ namespace noggit
       }
 
       printStacktrace();
+      FlushLogging();
 
       return EXCEPTION_CONTINUE_SEARCH;
     }
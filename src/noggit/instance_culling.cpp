@@ -0,0 +1,129 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/instance_culling.hpp>
+#include <noggit/parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace noggit
+{
+  namespace
+  {
+    constexpr std::size_t batch_size = 1024;
+  }
+
+  void instance_culling::reset()
+  {
+    for (auto* values : { &_min_x, &_min_y, &_min_z
+                        , &_max_x, &_max_y, &_max_z
+                        , &_pos_x, &_pos_y, &_pos_z
+                        , &_radius, &_size_cat
+                        }
+        )
+    {
+      values->clear();
+    }
+
+    _instances.clear();
+    _in_frustum.clear();
+    _distance_culled.clear();
+    _visible.clear();
+  }
+
+  void instance_culling::add ( SceneObject* instance
+                             , std::array<glm::vec3, 2> const& extents
+                             , glm::vec3 const& pos
+                             , bool in_frustum
+                             , bool distance_culled
+                             , float radius
+                             , float size_cat
+                             )
+  {
+    _instances.push_back (instance);
+
+    _min_x.push_back (extents[0].x);
+    _min_y.push_back (extents[0].y);
+    _min_z.push_back (extents[0].z);
+    _max_x.push_back (extents[1].x);
+    _max_y.push_back (extents[1].y);
+    _max_z.push_back (extents[1].z);
+    _in_frustum.push_back (in_frustum);
+
+    _pos_x.push_back (pos.x);
+    _pos_y.push_back (pos.y);
+    _pos_z.push_back (pos.z);
+    _distance_culled.push_back (distance_culled);
+    _radius.push_back (radius);
+    _size_cat.push_back (size_cat);
+  }
+
+  void instance_culling::compute ( math::frustum const& frustum
+                                 , float cull_distance
+                                 , glm::vec3 const& camera
+                                 , display_mode display
+                                 )
+  {
+    auto const planes (frustum.planes());
+    std::size_t const count (_instances.size());
+
+    _visible.resize (count);
+
+    parallel_for
+      ( (count + batch_size - 1) / batch_size
+      , [&] (std::size_t batch)
+        {
+          std::size_t const begin (batch * batch_size);
+          std::size_t const size (std::min (count, begin + batch_size) - begin);
+          std::uint8_t* visible (_visible.data() + begin);
+
+          std::fill (visible, visible + size, 1);
+
+          for (auto const& plane : planes)
+          {
+            // the corner farthest along the normal decides
+            float const* x ((plane.x > 0 ? _max_x : _min_x).data() + begin);
+            float const* y ((plane.y > 0 ? _max_y : _min_y).data() + begin);
+            float const* z ((plane.z > 0 ? _max_z : _min_z).data() + begin);
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+              visible[i] &= !(plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w <= 0.f);
+            }
+          }
+
+          std::uint8_t const* in_frustum (_in_frustum.data() + begin);
+          std::uint8_t const* distance_culled (_distance_culled.data() + begin);
+          float const* pos_x (_pos_x.data() + begin);
+          float const* pos_y (_pos_y.data() + begin);
+          float const* pos_z (_pos_z.data() + begin);
+          float const* radius (_radius.data() + begin);
+          float const* size_cat (_size_cat.data() + begin);
+
+          for (std::size_t i = 0; i < size; ++i)
+          {
+            float const dx (pos_x[i] - camera.x);
+            float const dy (pos_y[i] - camera.y);
+            float const dz (pos_z[i] - camera.z);
+
+            float const distance
+              ( ( display == display_mode::in_3D
+                ? std::sqrt (dx * dx + dy * dy + dz * dz)
+                : std::abs (dy)
+                )
+              - radius[i]
+              );
+
+            // small models disappear sooner
+            bool const in_range ( distance < cull_distance
+                                && !(size_cat[i] < 1.f && distance > 300.f)
+                                && !(size_cat[i] < 4.f && distance > 500.f)
+                                && !(size_cat[i] < 25.f && distance > 1000.f)
+                                );
+
+            visible[i] = (visible[i] | in_frustum[i]) & (!distance_culled[i] | in_range);
+          }
+        }
+      );
+  }
+}
@@ -0,0 +1,66 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/frustum.hpp>
+#include <noggit/tool_enums.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SceneObject;
+
+namespace noggit
+{
+  //! frustum and render distance tests of the object instances of a frame.
+  //! the bounds are packed as structures of arrays and tested in batches
+  //! spread over the parallel_for threads, a plane at a time so the tests
+  //! of a batch vectorize.
+  class instance_culling
+  {
+  public:
+    //! forgets the instances of the previous frame
+    void reset();
+
+    //! in_frustum: known to be in the frustum, for instance because its
+    //! whole tile is. distance_culled: culled by render distance as model
+    //! instances are, using the radius and size category
+    void add ( SceneObject* instance
+             , std::array<glm::vec3, 2> const& extents
+             , glm::vec3 const& pos
+             , bool in_frustum
+             , bool distance_culled
+             , float radius
+             , float size_cat
+             );
+
+    void compute ( math::frustum const& frustum
+                 , float cull_distance
+                 , glm::vec3 const& camera
+                 , display_mode display
+                 );
+
+    std::size_t size() const { return _instances.size(); }
+    SceneObject* instance (std::size_t i) const { return _instances[i]; }
+    bool visible (std::size_t i) const { return _visible[i]; }
+
+  private:
+    std::vector<SceneObject*> _instances;
+
+    std::vector<float> _min_x, _min_y, _min_z;
+    std::vector<float> _max_x, _max_y, _max_z;
+    std::vector<std::uint8_t> _in_frustum;
+
+    //! only model instances are culled by distance
+    std::vector<float> _pos_x, _pos_y, _pos_z;
+    std::vector<float> _radius;
+    std::vector<float> _size_cat;
+    std::vector<std::uint8_t> _distance_culled;
+
+    std::vector<std::uint8_t> _visible;
+  };
+}
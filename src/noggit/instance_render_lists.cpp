@@ -0,0 +1,243 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/instance_render_lists.hpp>
+#include <noggit/ModelInstance.h>
+#include <noggit/WMOInstance.h>
+
+namespace noggit
+{
+  namespace
+  {
+    // the slot is not assignable, copies of an instance are not in the lists
+    void reset (render_list_slot& slot)
+    {
+      slot.lists = nullptr;
+      slot.value = -1;
+      slot.changed = -1;
+    }
+  }
+
+  void instance_render_lists::begin_pass (int frame)
+  {
+    _frame = frame;
+    _shown = 0;
+  }
+
+  void instance_render_lists::show (ModelInstance* instance)
+  {
+    ++_shown;
+
+    if (instance->render_slot.value >= 0)
+    {
+      return;
+    }
+
+    auto& list (_models[instance->model.get()]);
+
+    instance->render_slot.lists = this;
+    instance->render_slot.value = static_cast<int> (list.instances.size());
+    list.instances.push_back (instance);
+    list.transforms.push_back (instance->transformMatrixTransposed());
+    list.changed = true;
+    ++_listed;
+  }
+
+  void instance_render_lists::show (WMOInstance* instance)
+  {
+    ++_shown;
+
+    if (instance->render_slot.value >= 0)
+    {
+      return;
+    }
+
+    instance->render_slot.lists = this;
+    instance->render_slot.value = static_cast<int> (_wmos.size());
+    _wmos.push_back (instance);
+    ++_listed;
+  }
+
+  void instance_render_lists::hide (SceneObject* instance)
+  {
+    unsafe_remove (instance);
+  }
+
+  void instance_render_lists::end_pass()
+  {
+    // the pass reached every instance still drawn unless some were shown
+    // less than listed, those on tiles it skipped
+    if (_shown < _listed)
+    {
+      remove_unshown();
+    }
+
+    copy_changed_transforms();
+  }
+
+  void instance_render_lists::transform_changed (SceneObject* instance)
+  {
+    // wmo transforms are read from the instances when drawing
+    if (instance->which() != eMODEL)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> const lock (_changed_transforms_mutex);
+
+    // removed since the caller looked at its slot
+    if (instance->render_slot.lists != this)
+    {
+      return;
+    }
+
+    if (instance->render_slot.changed < 0)
+    {
+      instance->render_slot.changed = static_cast<int> (_changed_transforms.size());
+      _changed_transforms.push_back (static_cast<ModelInstance*> (instance));
+    }
+  }
+
+  void instance_render_lists::remove (SceneObject* instance)
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    unsafe_remove (instance);
+  }
+
+  void instance_render_lists::clear()
+  {
+    std::lock_guard<std::mutex> const lock (_mutex);
+    std::lock_guard<std::mutex> const changed_lock (_changed_transforms_mutex);
+
+    for (auto& pair : _models)
+    {
+      for (auto instance : pair.second.instances)
+      {
+        reset (instance->render_slot);
+      }
+    }
+    for (auto instance : _wmos)
+    {
+      reset (instance->render_slot);
+    }
+
+    _models.clear();
+    _wmos.clear();
+    _changed_transforms.clear();
+    _listed = 0;
+    _shown = 0;
+  }
+
+  void instance_render_lists::remove_unshown()
+  {
+    for (auto it = _models.begin(); it != _models.end();)
+    {
+      auto& list (it.value());
+
+      for (std::size_t i = 0; i < list.instances.size();)
+      {
+        if (list.instances[i]->frame != _frame)
+        {
+          unsafe_remove (list.instances[i]);
+        }
+        else
+        {
+          ++i;
+        }
+      }
+
+      if (list.instances.empty())
+      {
+        it = _models.erase (it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    for (std::size_t i = 0; i < _wmos.size();)
+    {
+      if (_wmos[i]->frame != _frame)
+      {
+        unsafe_remove (_wmos[i]);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+  }
+
+  void instance_render_lists::copy_changed_transforms()
+  {
+    std::vector<ModelInstance*> changed;
+
+    {
+      std::lock_guard<std::mutex> const lock (_changed_transforms_mutex);
+
+      if (_changed_transforms.empty())
+      {
+        return;
+      }
+
+      changed.swap (_changed_transforms);
+
+      for (auto instance : changed)
+      {
+        instance->render_slot.changed = -1;
+      }
+    }
+
+    for (auto instance : changed)
+    {
+      auto& list (_models.find (instance->model.get()).value());
+      list.transforms[instance->render_slot.value] = instance->transformMatrixTransposed();
+      list.changed = true;
+    }
+  }
+
+  void instance_render_lists::unsafe_remove (SceneObject* instance)
+  {
+    int const slot (instance->render_slot.value);
+
+    if (slot < 0)
+    {
+      return;
+    }
+
+    // swap with the last one to keep the lists compact
+    if (instance->which() == eMODEL)
+    {
+      auto& list (_models.find (static_cast<ModelInstance*> (instance)->model.get()).value());
+
+      list.instances[slot] = list.instances.back();
+      list.transforms[slot] = list.transforms.back();
+      list.instances[slot]->render_slot.value = slot;
+      list.instances.pop_back();
+      list.transforms.pop_back();
+      list.changed = true;
+
+      std::lock_guard<std::mutex> const lock (_changed_transforms_mutex);
+      int const changed (instance->render_slot.changed);
+
+      if (changed >= 0)
+      {
+        _changed_transforms[changed] = _changed_transforms.back();
+        _changed_transforms[changed]->render_slot.changed = changed;
+        _changed_transforms.pop_back();
+      }
+
+      reset (instance->render_slot);
+    }
+    else
+    {
+      _wmos[slot] = _wmos.back();
+      _wmos[slot]->render_slot.value = slot;
+      _wmos.pop_back();
+
+      reset (instance->render_slot);
+    }
+
+    --_listed;
+  }
+}
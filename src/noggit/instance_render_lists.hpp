@@ -0,0 +1,78 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <external/tsl/robin_map.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class Model;
+class ModelInstance;
+class SceneObject;
+class WMOInstance;
+
+namespace noggit
+{
+  //! the instances drawn by the world, kept from one frame to the next.
+  //! a culling pass only adds the instances which became visible and
+  //! removes the ones which are not anymore. instances tell the lists when
+  //! their transform changes, so nothing is compared while nothing moves.
+  //! instances know their position in the lists through their render_slot.
+  class instance_render_lists
+  {
+  public:
+    struct model_instances
+    {
+      std::vector<ModelInstance*> instances;
+      //! the transposed transforms of the instances, in the same order
+      std::vector<glm::mat4x4> transforms;
+      //! the transforms changed since the lists were last drawn
+      bool changed = true;
+    };
+
+    //! instances neither shown nor hidden until end_pass() are removed
+    void begin_pass (int frame);
+    void show (ModelInstance* instance);
+    void show (WMOInstance* instance);
+    void hide (SceneObject* instance);
+    //! copies the transforms which changed since the last pass
+    void end_pass();
+
+    //! called by instances in the lists, from any thread and whether the
+    //! lists are held or not
+    void transform_changed (SceneObject* instance);
+
+    //! to call before an instance is destroyed
+    void remove (SceneObject* instance);
+    void clear();
+
+    tsl::robin_map<Model*, model_instances>& models() { return _models; }
+    std::vector<WMOInstance*> const& wmos() const { return _wmos; }
+
+    //! held during the culling pass and while the lists are drawn
+    std::mutex& mutex() { return _mutex; }
+
+  private:
+    void unsafe_remove (SceneObject* instance);
+    void remove_unshown();
+    void copy_changed_transforms();
+
+    int _frame = 0;
+    //! instances in the lists, and how many of them the pass showed
+    std::size_t _listed = 0;
+    std::size_t _shown = 0;
+
+    tsl::robin_map<Model*, model_instances> _models;
+    std::vector<WMOInstance*> _wmos;
+
+    std::mutex _mutex;
+
+    //! models in the lists whose transform changed, guarded on its own as
+    //! transforms change while the culling pass holds the lists
+    std::vector<ModelInstance*> _changed_transforms;
+    std::mutex _changed_transforms_mutex;
+  };
+}
@@ -1,6 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <noggit/DBC.h>
+#include <noggit/chunk_writer.hpp>
 #include <noggit/liquid_layer.hpp>
 #include <noggit/Log.h>
 #include <noggit/MapChunk.h>
@@ -248,7 +249,7 @@ liquid_layer& liquid_layer::operator=(liquid_layer const& other)
   return *this;
 }
 
-void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos) const
+MH2O_Information liquid_layer::save_information(std::uint64_t& mask) const
 {
   int min_x = 9, min_z = 9, max_x = 0, max_z = 0;
   bool filled = true;
@@ -272,7 +273,7 @@ void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int&
   }
 
   MH2O_Information info;
-  std::uint64_t mask = 0;
+  mask = 0;
 
   info.liquid_id = _liquid_id;
   info.liquid_vertex_format = _liquid_vertex_format;
@@ -282,12 +283,9 @@ void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int&
   info.yOffset = min_z;
   info.width = max_x - min_x;
   info.height = max_z - min_z;
+  info.ofsInfoMask = 0;
 
-  if (filled)
-  {
-    info.ofsInfoMask = 0;
-  }
-  else
+  if (!filled)
   {
     std::uint64_t value = 1;
     for (int z = info.yOffset; z < info.yOffset + info.height; ++z)
@@ -301,37 +299,73 @@ void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int&
         value <<= 1;
       }
     }
-
-    if (mask > 0)
-    {
-      info.ofsInfoMask = current_pos - base_pos;
-      adt.Insert(current_pos, 8, reinterpret_cast<char*>(&mask));
-      current_pos += 8;
-    }
   }
 
-  info.ofsHeightMap = current_pos - base_pos;
+  return info;
+}
+
+std::size_t liquid_layer::save_size() const
+{
+  std::uint64_t mask;
+  MH2O_Information const info = save_information(mask);
 
-  int vertices_count = (info.width + 1) * (info.height + 1);
+  std::size_t vertex_size = 0;
 
   if (_liquid_vertex_format == 0 || _liquid_vertex_format == 1)
   {
-    adt.Extend(vertices_count * sizeof(float));
+    vertex_size += sizeof(float);
+  }
+  if (_liquid_vertex_format == 1)
+  {
+    vertex_size += sizeof(mh2o_uv);
+  }
+  if (_liquid_vertex_format == 0 || _liquid_vertex_format == 2)
+  {
+    vertex_size += sizeof(std::uint8_t);
+  }
+
+  return (mask > 0 ? sizeof(mask) : 0)
+       + (info.width + 1) * (info.height + 1) * vertex_size;
+}
 
+std::size_t liquid_layer::memory_usage() const
+{
+  std::size_t usage = sizeof(liquid_layer);
+
+  for (auto const& lod : _indices_by_lod)
+  {
+    usage += sizeof(lod) + lod.second.capacity() * sizeof(std::uint16_t);
+  }
+
+  return usage;
+}
+
+void liquid_layer::save(noggit::chunk_writer& adt, std::size_t base_pos, std::size_t& info_pos) const
+{
+  std::uint64_t mask;
+  MH2O_Information info = save_information(mask);
+
+  if (mask > 0)
+  {
+    info.ofsInfoMask = adt.position() - base_pos;
+    adt.write(mask);
+  }
+
+  info.ofsHeightMap = adt.position() - base_pos;
+
+  if (_liquid_vertex_format == 0 || _liquid_vertex_format == 1)
+  {
     for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
     {
       for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
       {
-        memcpy(adt.GetPointer<char>(current_pos), &_vertices[z * 9 + x].y, sizeof(float));
-        current_pos += sizeof(float);
+        adt.write(_vertices[z * 9 + x].y);
       }
     }
   }
 
   if (_liquid_vertex_format == 1)
   {
-    adt.Extend(vertices_count * sizeof(mh2o_uv));
-
     for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
     {
       for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
@@ -340,28 +374,24 @@ void liquid_layer::save(sExtendableArray& adt, int base_pos, int& info_pos, int&
         uv.x = static_cast<std::uint16_t>(std::min(_tex_coords[z * 9 + x].x * 255.f, 65535.f));
         uv.y = static_cast<std::uint16_t>(std::min(_tex_coords[z * 9 + x].y * 255.f, 65535.f));
 
-        memcpy(adt.GetPointer<char>(current_pos), &uv, sizeof(mh2o_uv));
-        current_pos += sizeof(mh2o_uv);
+        adt.write(uv);
       }
     }
   }
 
   if (_liquid_vertex_format == 0 || _liquid_vertex_format == 2)
   {
-    adt.Extend(vertices_count * sizeof(std::uint8_t));
-
     for (int z = info.yOffset; z <= info.yOffset + info.height; ++z)
     {
       for (int x = info.xOffset; x <= info.xOffset + info.width; ++x)
       {
         std::uint8_t depth = static_cast<std::uint8_t>(std::min(_depth[z * 9 + x] * 255.0f, 255.f));
-        memcpy(adt.GetPointer<char>(current_pos), &depth, sizeof(std::uint8_t));
-        current_pos += sizeof(std::uint8_t);
+        adt.write(depth);
       }
     }
   }
 
-  memcpy(adt.GetPointer<char>(info_pos), &info, sizeof(MH2O_Information));
+  *adt.at<MH2O_Information>(info_pos) = info;
   info_pos += sizeof(MH2O_Information);
 }
 
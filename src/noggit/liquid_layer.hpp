@@ -10,9 +10,13 @@
 #include <glm/vec2.hpp>
 
 class MapChunk;
-class sExtendableArray;
 class ChunkWater;
 
+namespace noggit
+{
+  class chunk_writer;
+}
+
 enum LiquidLayerUpdateFlags
 {
   ll_HEIGHT = 0x1,
@@ -38,7 +42,11 @@ public:
   liquid_layer& operator=(liquid_layer&&);
   liquid_layer& operator=(liquid_layer const& other);
 
-  void save(sExtendableArray& adt, int base_pos, int& info_pos, int& current_pos) const;
+  //! the size of the data save() writes after the information
+  std::size_t save_size() const;
+  void save(noggit::chunk_writer& adt, std::size_t base_pos, std::size_t& info_pos) const;
+
+  std::size_t memory_usage() const;
 
   void changeLiquidID(int id);
 
@@ -83,6 +91,8 @@ private:
   void update_vertex_opacity(int x, int z, MapChunk* chunk, float factor);
   int get_lod_level(glm::vec3 const& camera_pos) const;
   void set_lod_level(int lod_level);
+  //! mask is 0 when no mask needs to be saved
+  MH2O_Information save_information(std::uint64_t& mask) const;
 
   int _liquid_id;
   int _liquid_vertex_format;
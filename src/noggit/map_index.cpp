@@ -13,6 +13,7 @@
   #include <mysql/mysql.h>
 #endif
 #include <noggit/map_index.hpp>
+#include <noggit/parallel_for.hpp>
 #include <noggit/uid_storage.hpp>
 
 #include <QtCore/QSettings>
@@ -23,14 +24,20 @@
 
 #include <boost/range/adaptor/map.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <forward_list>
 #include <cstdlib>
+#include <unordered_map>
+#include <utility>
 
 MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world,
                     noggit::NoggitRenderContext context, bool create_empty)
   : basename(pBasename)
   , _map_id (map_id)
-  , _last_unload_time((clock() / CLOCKS_PER_SEC)) // to not try to unload right away
+  , _last_unload_time(std::chrono::steady_clock::now()) // to not try to unload right away
   , mBigAlpha(false)
   , mHasAGlobalWMO(false)
   , noadt(false)
@@ -43,7 +50,7 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world,
 
   QSettings settings;
   _unload_interval = settings.value("unload_interval", 5).toInt();
-  _unload_dist = settings.value("unload_dist", 5).toInt();
+  _unload_memory_budget = std::size_t (settings.value("unload_memory_budget", 2048).toInt()) * 1024 * 1024;
 
   if (create_empty)
   {
@@ -170,20 +177,70 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world,
   loadMinimapMD5translate();
 }
 
-void MapIndex::saveall (World* world)
+std::vector<std::string> MapIndex::saveall (World* world, save_progress const& progress)
 {
   world->wait_for_all_tile_updates();
 
   saveMaxUID();
 
+  std::vector<MapTile*> tiles;
+
   for (MapTile* tile : loaded_tiles())
   {
-    tile->saveTile(world);
-    tile->changed = false;
+    tiles.push_back (tile);
+  }
+
+  return save_tiles (tiles, world, progress);
+}
+
+std::vector<std::string> MapIndex::save_tiles (std::vector<MapTile*> const& tiles, World* world, save_progress const& progress)
+{
+  // small batches so the progress can be reported from this thread
+  std::size_t const batch_size (2 * noggit::parallel_for_concurrency());
+
+  // not a vector<bool>, the workers write next to each other
+  std::vector<char> saved (tiles.size(), false);
+
+  for (std::size_t first = 0; first < tiles.size(); first += batch_size)
+  {
+    if (progress)
+    {
+      progress (first, tiles.size());
+    }
+
+    noggit::parallel_for
+      ( std::min (batch_size, tiles.size() - first)
+      , [&] (std::size_t i)
+        {
+          MapTile* tile (tiles[first + i]);
+
+          // a tile which could not be written keeps its changes
+          if (tile->saveTile (world))
+          {
+            tile->changed = false;
+            saved[first + i] = true;
+          }
+        }
+      );
+  }
+
+  if (progress)
+  {
+    progress (tiles.size(), tiles.size());
+  }
+
+  std::vector<std::string> failed;
+  for (std::size_t i = 0; i < tiles.size(); ++i)
+  {
+    if (!saved[i])
+    {
+      failed.push_back (tiles[i]->filename);
+    }
   }
+  return failed;
 }
 
-void MapIndex::save()
+bool MapIndex::save()
 {
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << ".wdt";
@@ -256,29 +313,120 @@ void MapIndex::save()
 
   MPQFile f(filename.str());
   f.setBuffer(wdtFile.data);
-  f.SaveFile();
+  bool const saved (f.SaveFile());
   f.close();
 
-  changed = false;
+  if (saved)
+  {
+    changed = false;
+  }
+  return saved;
 }
 
-void MapIndex::enterTile(const tile_index& tile)
+void MapIndex::enterTile(glm::vec3 const& camera_pos, float dt)
 {
-  if (!hasTile(tile))
+  tile_index const tile (camera_pos);
+
+  noadt = !hasTile(tile);
+
+  if (!noadt)
+  {
+    int cx = tile.x;
+    int cz = tile.z;
+
+    for (int pz = std::max(cz - 1, 0); pz < std::min(cz + 2, 64); ++pz)
+    {
+      for (int px = std::max(cx - 1, 0); px < std::min(cx + 2, 64); ++px)
+      {
+        tile_index const neighbour (px, pz);
+
+        if (!hasTile(neighbour))
+        {
+          continue;
+        }
+
+        MapTileEntry& entry = mTiles[pz][px];
+
+        if (!entry.viewed)
+        {
+          entry.viewed = true;
+
+          if (entry.tile && entry.tile->finishedLoading())
+          {
+            _streaming_stats.hits++;
+          }
+          else
+          {
+            _streaming_stats.misses++;
+          }
+        }
+
+        loadTile(neighbour);
+      }
+    }
+  }
+
+  prefetchTiles(camera_pos, dt);
+}
+
+void MapIndex::prefetchTiles(glm::vec3 const& camera_pos, float dt)
+{
+  // how far ahead of the camera to stream: seconds of flight, capped
+  constexpr float lookahead_time = 2.f;
+  constexpr float max_lookahead = 4.f * TILESIZE;
+  constexpr float step = TILESIZE * 0.5f;
+
+  glm::vec3 const moved (camera_pos.x - _last_camera_pos.x, 0.f, camera_pos.z - _last_camera_pos.z);
+  _last_camera_pos = camera_pos;
+
+  // teleports (and the first frame) are no indication of where we're heading
+  if (dt <= 0.f || glm::length(moved) > max_lookahead)
+  {
+    _camera_velocity = {};
+  }
+  else
+  {
+    // smooth out jitter from uneven frame times
+    _camera_velocity = glm::mix(_camera_velocity, moved / dt, std::min(1.f, dt * 4.f));
+  }
+
+  _prefetch_path.clear();
+
+  float const lookahead (std::min(glm::length(_camera_velocity) * lookahead_time, max_lookahead));
+
+  if (lookahead < step)
   {
-    noadt = true;
     return;
   }
 
-  noadt = false;
-  int cx = tile.x;
-  int cz = tile.z;
+  glm::vec3 const direction (glm::normalize(_camera_velocity));
 
-  for (int pz = std::max(cz - 1, 0); pz < std::min(cz + 2, 63); ++pz)
+  for (float distance = step; distance <= lookahead; distance += step)
   {
-    for (int px = std::max(cx - 1, 0); px < std::min(cx + 2, 63); ++px)
+    tile_index const ahead (camera_pos + direction * distance);
+
+    // the camera needs the neighbours of every tile it enters
+    for (std::size_t pz = ahead.z - 1; pz != ahead.z + 2; ++pz)
     {
-      loadTile(tile_index(px, pz));
+      for (std::size_t px = ahead.x - 1; px != ahead.x + 2; ++px)
+      {
+        tile_index const tile (px, pz);
+
+        if (!hasTile(tile) || std::find(_prefetch_path.begin(), _prefetch_path.end(), tile) != _prefetch_path.end())
+        {
+          continue;
+        }
+
+        _prefetch_path.emplace_back(tile);
+
+        MapTileEntry& entry = mTiles[pz][px];
+
+        if (!entry.tile && loadTile(tile))
+        {
+          entry.prefetched = true;
+          _streaming_stats.prefetched++;
+        }
+      }
     }
   }
 }
@@ -370,8 +518,8 @@ MapTile* MapIndex::loadTile(const tile_index& tile, bool reloading)
     return nullptr;
   }
 
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
-     mBigAlpha, true, use_mclq_green_lava(), reloading, _world, _context);
+  set_tile (tile, std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
+     mBigAlpha, true, use_mclq_green_lava(), reloading, _world, _context));
 
   MapTile* adt = mTiles[tile.z][tile.x].tile.get();
 
@@ -385,29 +533,62 @@ void MapIndex::reloadTile(const tile_index& tile)
 {
   if (tileLoaded(tile))
   {
-    mTiles[tile.z][tile.x].tile.reset();
+    set_tile (tile, nullptr);
     loadTile(tile, true);
   }
 }
 
 void MapIndex::unloadTiles(const tile_index& tile)
 {
-  if (((clock() / CLOCKS_PER_SEC) - _last_unload_time) > _unload_interval)
+  auto const now (std::chrono::steady_clock::now());
+
+  if (now - _last_unload_time <= std::chrono::seconds(_unload_interval))
+  {
+    return;
+  }
+
+  _last_unload_time = now;
+
+  std::size_t resident = 0;
+  std::vector<std::pair<MapTile*, std::size_t>> candidates;
+
+  for (MapTile* adt : loaded_tiles())
   {
-    for (MapTile* adt : loaded_tiles())
+    std::size_t const usage (adt->memory_usage());
+    resident += usage;
+
+    // keep the tiles around the camera, the ones streamed in ahead of it
+    // and adts marked to save
+    if ( tile.dist(adt->index) < 2.f
+      || adt->changed.load()
+      || std::find(_prefetch_path.begin(), _prefetch_path.end(), adt->index) != _prefetch_path.end()
+       )
     {
-      if (tile.dist(adt->index) > _unload_dist)
-      {
-        //Only unload adts not marked to save
-        if (!adt->changed.load())
-        {
-          unloadTile(adt->index);
-        }
-      }
+      continue;
+    }
+
+    candidates.emplace_back(adt, usage);
+  }
+
+  std::sort ( candidates.begin(), candidates.end()
+            , [&] (auto const& lhs, auto const& rhs)
+              {
+                return tile.dist(lhs.first->index) > tile.dist(rhs.first->index);
+              }
+            );
+
+  for (auto const& candidate : candidates)
+  {
+    if (resident <= _unload_memory_budget)
+    {
+      break;
     }
 
-    _last_unload_time = clock() / CLOCKS_PER_SEC;
+    resident -= candidate.second;
+    unloadTile(candidate.first->index);
   }
+
+  _streaming_stats.resident_bytes = resident;
 }
 
 void MapIndex::unloadTile(const tile_index& tile)
@@ -415,12 +596,71 @@ void MapIndex::unloadTile(const tile_index& tile)
   // unloads a tile with givn cords
   if (tileLoaded(tile))
   {
-    mTiles[tile.z][tile.x].tile = nullptr;
+    MapTileEntry& entry = mTiles[tile.z][tile.x];
+
+    if (entry.prefetched && !entry.viewed)
+    {
+      _streaming_stats.prefetched_unused++;
+    }
+
+    entry.prefetched = false;
+    entry.viewed = false;
+
+    set_tile (tile, nullptr);
     Log << "Unload Tile " << tile.x << "-" << tile.z << std::endl;
     _n_loaded_tiles--;
   }
 }
 
+void MapIndex::set_tile(const tile_index& tile, std::unique_ptr<MapTile> adt)
+{
+  MapTileEntry& entry = mTiles[tile.z][tile.x];
+  bool const was_resident = !!entry.tile;
+
+  entry.tile = std::move (adt);
+
+  if (entry.tile && !was_resident)
+  {
+    link_tile (entry);
+  }
+  else if (!entry.tile && was_resident)
+  {
+    unlink_tile (entry);
+  }
+}
+
+void MapIndex::link_tile(MapTileEntry& entry)
+{
+  // mTiles is row major so the entry addresses follow the tile indices,
+  // keeping the list sorted iterates the tiles in the same order as a scan
+  MapTileEntry* prev = _last_resident;
+
+  while (prev && prev > &entry)
+  {
+    prev = prev->prev_resident;
+  }
+
+  MapTileEntry* next = prev ? prev->next_resident : _first_resident;
+
+  entry.prev_resident = prev;
+  entry.next_resident = next;
+
+  (prev ? prev->next_resident : _first_resident) = &entry;
+  (next ? next->prev_resident : _last_resident) = &entry;
+}
+
+void MapIndex::unlink_tile(MapTileEntry& entry)
+{
+  MapTileEntry* prev = entry.prev_resident;
+  MapTileEntry* next = entry.next_resident;
+
+  (prev ? prev->next_resident : _first_resident) = next;
+  (next ? next->prev_resident : _last_resident) = prev;
+
+  // next_resident is left as is for the iterators currently on this entry
+  entry.prev_resident = nullptr;
+}
+
 void MapIndex::markOnDisc(const tile_index& tile, bool mto)
 {
   if(tile.is_valid())
@@ -435,7 +675,7 @@ bool MapIndex::isTileExternal(const tile_index& tile) const
   return tile.is_valid() && mTiles[tile.z][tile.x].onDisc;
 }
 
-void MapIndex::saveTile(const tile_index& tile, World* world, bool save_unloaded)
+std::vector<std::string> MapIndex::saveTile(const tile_index& tile, World* world, bool save_unloaded)
 {
   world->wait_for_all_tile_updates();
 
@@ -447,27 +687,41 @@ void MapIndex::saveTile(const tile_index& tile, World* world, bool save_unloaded
                     / noggit::mpq::normalized_filename (mTiles[tile.z][tile.x].tile->filename);
 
     QFile file(filepath.string().c_str());
-    file.open(QIODevice::WriteOnly);
+    if (!file.exists())
+    {
+      file.open(QIODevice::WriteOnly);
+      MPQFile::project_file_created (mTiles[tile.z][tile.x].tile->filename);
+    }
 
     mTiles[tile.z][tile.x].tile->initEmptyChunks();
-    mTiles[tile.z][tile.x].tile->saveTile(world);
-    return;
+    if (!mTiles[tile.z][tile.x].tile->saveTile(world))
+    {
+      return {mTiles[tile.z][tile.x].tile->filename};
+    }
+    return {};
   }
 
 	if (tileLoaded(tile))
 	{
     saveMaxUID();
-		mTiles[tile.z][tile.x].tile->saveTile(world);
+    if (!mTiles[tile.z][tile.x].tile->saveTile(world))
+    {
+      return {mTiles[tile.z][tile.x].tile->filename};
+    }
 	}
+
+  return {};
 }
 
-void MapIndex::saveChanged (World* world, bool save_unloaded)
+std::vector<std::string> MapIndex::saveChanged (World* world, bool save_unloaded, save_progress const& progress)
 {
   world->wait_for_all_tile_updates();
 
-  if (changed)
+  std::vector<std::string> failed;
+
+  if (changed && !save())
   {
-    save();
+    failed.push_back ("World\\Maps\\" + basename + "\\" + basename + ".wdt");
   }
 
   if (!save_unloaded)
@@ -476,46 +730,59 @@ void MapIndex::saveChanged (World* world, bool save_unloaded)
   }
   else
   {
-    for (int i = 0; i < 64; ++i)
+    std::vector<MapTile*> tiles;
+
+    for (MapTile* tile : resident_tiles())
     {
-      for (int j = 0; j < 64; ++j)
+      if (!tile->changed.load())
       {
-        if (!(mTiles[i][j].tile && mTiles[i][j].tile->changed.load()))
-        {
-          continue;
-        }
+        continue;
+      }
 
-        QSettings settings;
-        auto filepath = boost::filesystem::path (settings.value ("project/path").toString().toStdString())
-                        / noggit::mpq::normalized_filename (mTiles[i][j].tile->filename);
+      QSettings settings;
+      auto filepath = boost::filesystem::path (settings.value ("project/path").toString().toStdString())
+                      / noggit::mpq::normalized_filename (tile->filename);
 
-        if (mTiles[i][j].flags & 0x1)
-        {
-          QFile file(filepath.string().c_str());
-          file.open(QIODevice::WriteOnly);
+      QFile file(filepath.string().c_str());
 
-          mTiles[i][j].tile->initEmptyChunks();
-          mTiles[i][j].tile->saveTile(world);
-          mTiles[i][j].tile->changed = false;
-        }
-        else
+      if (hasTile (tile->index))
+      {
+        // the file has to exist to be saved, but an existing one is
+        // only replaced once the new one is written
+        if (!file.exists())
         {
-          QFile file(filepath.string().c_str());
-          file.remove();
+          file.open(QIODevice::WriteOnly);
+          MPQFile::project_file_created (tile->filename);
         }
+
+        tile->initEmptyChunks();
+        tiles.push_back (tile);
+      }
+      else
+      {
+        file.remove();
+        MPQFile::project_file_removed (tile->filename);
       }
     }
-    return;
+
+    auto const failed_tiles (save_tiles (tiles, world, progress));
+    failed.insert (failed.end(), failed_tiles.begin(), failed_tiles.end());
+    return failed;
   }
 
+  std::vector<MapTile*> tiles;
+
   for (MapTile* tile : loaded_tiles())
   {
     if (tile->changed.load())
     {
-      tile->saveTile(world);
-      tile->changed = false;
+      tiles.push_back (tile);
     }
   }
+
+  auto const failed_tiles (save_tiles (tiles, world, progress));
+  failed.insert (failed.end(), failed_tiles.begin(), failed_tiles.end());
+  return failed;
 }
 
 bool MapIndex::hasAGlobalWMO()
@@ -682,90 +949,121 @@ uint32_t MapIndex::newGUID()
   return ++highestGUID;
 }
 
-uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_error)
+namespace
 {
-  // pre-cond: mTiles[z][x].flags are set
-
-  // unload any previously loaded tile, although there shouldn't be as
-  // the fix is executed before loading the map
-  for (int z = 0; z < 64; ++z)
+  //! the m2/wmo entries placed on a tile, without duplicates
+  struct uid_fix_tile_entries
   {
-    for (int x = 0; x < 64; ++x)
+    std::vector<ENTRY_MDDF> models;
+    std::vector<ENTRY_MODF> wmos;
+    std::vector<std::string> model_filenames;
+    std::vector<std::string> wmo_filenames;
+  };
+
+  //! finds the duplicates of an entry, ie. the same file placed at the same
+  //! position with the same rotation (and scale), in a hash of the kept
+  //! entries bucketed by name and position
+  template<typename Entry>
+    class duplicate_entry_filter
+  {
+  public:
+    duplicate_entry_filter (std::vector<Entry>& kept)
+      : _kept (kept)
+    {}
+
+    //! keeps the entry unless it's a duplicate of a kept one
+    template<typename Equal>
+      void add (Entry const& entry, Equal equal)
     {
-      if (mTiles[z][x].tile)
+      // positions equal according to misc::float_equals may lie in two
+      // neighbouring cells, look for them in both
+      for (float x : {entry.pos[0] - cell_margin, entry.pos[0] + cell_margin})
       {
-        MapTile* tile = mTiles[z][x].tile.get();
+        for (float z : {entry.pos[2] - cell_margin, entry.pos[2] + cell_margin})
+        {
+          auto const bucket (_buckets.find (key (entry.nameID, cell (x), cell (z))));
 
-        // don't unload half loaded tiles
-        tile->wait_until_loaded();
+          if (bucket == _buckets.end())
+          {
+            continue;
+          }
 
-        unloadTile(tile->index);
+          for (std::size_t kept : bucket->second)
+          {
+            if (equal (entry, _kept[kept]))
+            {
+              return;
+            }
+          }
+        }
       }
+
+      _buckets[key (entry.nameID, cell (entry.pos[0]), cell (entry.pos[2]))].push_back (_kept.size());
+      _kept.emplace_back (entry);
     }
-  }
 
-  _uid_fix_all_in_progress = true;
+  private:
+    // way more than float_equals' tolerance at the map's coordinates
+    static constexpr float cell_margin = 1.f / 16.f;
 
-  std::forward_list<ModelInstance> models;
-  std::forward_list<WMOInstance> wmos;
+    static std::uint64_t cell (float pos)
+    {
+      return static_cast<std::uint64_t> (std::max (0.f, std::floor (pos))) & 0xFFFF;
+    }
 
-  for (int z = 0; z < 64; ++z)
-  {
-    for (int x = 0; x < 64; ++x)
+    static std::uint64_t key (std::uint32_t name_id, std::uint64_t cell_x, std::uint64_t cell_z)
     {
-      if (!(mTiles[z][x].flags & 1))
-      {
-        continue;
-      }
+      return (std::uint64_t (name_id) << 32) | (cell_x << 16) | cell_z;
+    }
 
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
-      MPQFile file(filename.str());
+    std::vector<Entry>& _kept;
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> _buckets;
+  };
 
-      if (file.isEof())
-      {
-        continue;
-      }
+  void read_uid_fix_entries (std::string const& filename, tile_index const& tile, uid_fix_tile_entries& entries)
+  {
+    MPQFile file(filename);
 
-      std::array<glm::vec3, 2> tileExtents;
-      tileExtents[0] = { x*TILESIZE, 0, z*TILESIZE };
-      tileExtents[1] = { (x+1)*TILESIZE, 0, (z+1)*TILESIZE };
-      misc::minmax(&tileExtents[0], &tileExtents[1]);
+    if (file.isEof())
+    {
+      return;
+    }
 
-      std::forward_list<ENTRY_MDDF> modelEntries;
-      std::forward_list<ENTRY_MODF> wmoEntries;
-      std::vector<std::string> modelFilenames;
-      std::vector<std::string> wmoFilenames;
+    std::array<glm::vec3, 2> tileExtents;
+    tileExtents[0] = { tile.x*TILESIZE, 0, tile.z*TILESIZE };
+    tileExtents[1] = { (tile.x+1)*TILESIZE, 0, (tile.z+1)*TILESIZE };
+    misc::minmax(&tileExtents[0], &tileExtents[1]);
 
-      uint32_t fourcc;
-      uint32_t size;
+    uint32_t fourcc;
+    uint32_t size;
 
-      MHDR Header;
+    MHDR Header;
 
-      // - MVER ----------------------------------------------
-      uint32_t version;
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      file.read(&version, 4);
-      assert(fourcc == 'MVER' && version == 18);
+    // - MVER ----------------------------------------------
+    uint32_t version;
+    file.read(&fourcc, 4);
+    file.seekRelative(4);
+    file.read(&version, 4);
+    assert(fourcc == 'MVER' && version == 18);
 
-      // - MHDR ----------------------------------------------
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      assert(fourcc == 'MHDR');
-      file.read(&Header, sizeof(MHDR));
+    // - MHDR ----------------------------------------------
+    file.read(&fourcc, 4);
+    file.seekRelative(4);
+    assert(fourcc == 'MHDR');
+    file.read(&Header, sizeof(MHDR));
 
-      // - MDDF ----------------------------------------------
-      file.seek(Header.mddf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MDDF');
+    // - MDDF ----------------------------------------------
+    file.seek(Header.mddf + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MDDF');
 
+    {
       ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(file.getPointer());
+      duplicate_entry_filter<ENTRY_MDDF> models (entries.models);
 
       for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
       {
-        bool add = true;
         ENTRY_MDDF const& mddf = mddf_ptr[i];
 
         if (!misc::pointInside({ mddf.pos[0], 0, mddf.pos[2] }, tileExtents))
@@ -773,41 +1071,35 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
           continue;
         }
 
-        // check for duplicates
-        for (ENTRY_MDDF& entry : modelEntries)
-        {
-          if ( mddf.nameID == entry.nameID
-            && misc::float_equals(mddf.pos[0], entry.pos[0])
-            && misc::float_equals(mddf.pos[1], entry.pos[1])
-            && misc::float_equals(mddf.pos[2], entry.pos[2])
-            && misc::float_equals(mddf.rot[0], entry.rot[0])
-            && misc::float_equals(mddf.rot[1], entry.rot[1])
-            && misc::float_equals(mddf.rot[2], entry.rot[2])
-            && mddf.scale == entry.scale
-            )
-          {
-            add = false;
-            break;
-          }
-        }
-
-        if (add)
-        {
-          modelEntries.emplace_front(mddf);
-        }
+        models.add
+          ( mddf
+          , [] (ENTRY_MDDF const& lhs, ENTRY_MDDF const& rhs)
+            {
+              return lhs.nameID == rhs.nameID
+                && misc::float_equals(lhs.pos[0], rhs.pos[0])
+                && misc::float_equals(lhs.pos[1], rhs.pos[1])
+                && misc::float_equals(lhs.pos[2], rhs.pos[2])
+                && misc::float_equals(lhs.rot[0], rhs.rot[0])
+                && misc::float_equals(lhs.rot[1], rhs.rot[1])
+                && misc::float_equals(lhs.rot[2], rhs.rot[2])
+                && lhs.scale == rhs.scale;
+            }
+          );
       }
+    }
 
-      // - MODF ----------------------------------------------
-      file.seek(Header.modf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MODF');
+    // - MODF ----------------------------------------------
+    file.seek(Header.modf + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MODF');
 
+    {
       ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(file.getPointer());
+      duplicate_entry_filter<ENTRY_MODF> wmos (entries.wmos);
 
       for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
       {
-        bool add = true;
         ENTRY_MODF const& modf = modf_ptr[i];
 
         if (!misc::pointInside({ modf.pos[0], 0, modf.pos[2] }, tileExtents))
@@ -815,89 +1107,166 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
           continue;
         }
 
-        // check for duplicates
-        for (ENTRY_MODF& entry : wmoEntries)
-        {
-          if (modf.nameID == entry.nameID
-            && misc::float_equals(modf.pos[0], entry.pos[0])
-            && misc::float_equals(modf.pos[1], entry.pos[1])
-            && misc::float_equals(modf.pos[2], entry.pos[2])
-            && misc::float_equals(modf.rot[0], entry.rot[0])
-            && misc::float_equals(modf.rot[1], entry.rot[1])
-            && misc::float_equals(modf.rot[2], entry.rot[2])
-            )
-          {
-            add = false;
-            break;
-          }
-        }
+        wmos.add
+          ( modf
+          , [] (ENTRY_MODF const& lhs, ENTRY_MODF const& rhs)
+            {
+              return lhs.nameID == rhs.nameID
+                && misc::float_equals(lhs.pos[0], rhs.pos[0])
+                && misc::float_equals(lhs.pos[1], rhs.pos[1])
+                && misc::float_equals(lhs.pos[2], rhs.pos[2])
+                && misc::float_equals(lhs.rot[0], rhs.rot[0])
+                && misc::float_equals(lhs.rot[1], rhs.rot[1])
+                && misc::float_equals(lhs.rot[2], rhs.rot[2]);
+            }
+          );
+      }
+    }
 
-        if (add)
-        {
-          wmoEntries.emplace_front(modf);
-        }
+    // - MMDX ----------------------------------------------
+    file.seek(Header.mmdx + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MMDX');
+
+    {
+      char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
+      char const* lEnd = lCurPos + size;
+
+      while (lCurPos < lEnd)
+      {
+        entries.model_filenames.push_back(std::string(lCurPos));
+        lCurPos += strlen(lCurPos) + 1;
       }
+    }
 
-      // - MMDX ----------------------------------------------
-      file.seek(Header.mmdx + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MMDX');
+    // - MWMO ----------------------------------------------
+    file.seek(Header.mwmo + 0x14);
+    file.read(&fourcc, 4);
+    file.read(&size, 4);
+    assert(fourcc == 'MWMO');
 
+    {
+      char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
+      char const* lEnd = lCurPos + size;
+
+      while (lCurPos < lEnd)
       {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
+        entries.wmo_filenames.push_back(std::string(lCurPos));
+        lCurPos += strlen(lCurPos) + 1;
+      }
+    }
 
-        while (lCurPos < lEnd)
-        {
-          modelFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
-        }
+    file.close();
+  }
+}
+
+uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_error)
+{
+  // pre-cond: mTiles[z][x].flags are set
+
+  // unload any previously loaded tile, although there shouldn't be as
+  // the fix is executed before loading the map
+  for (MapTile* tile : resident_tiles())
+  {
+    // don't unload half loaded tiles
+    tile->wait_until_loaded();
+
+    unloadTile(tile->index);
+  }
+
+  _uid_fix_all_in_progress = true;
+
+  std::vector<tile_index> tiles;
+
+  for (std::size_t z = 0; z < 64; ++z)
+  {
+    for (std::size_t x = 0; x < 64; ++x)
+    {
+      if (mTiles[z][x].flags & 1)
+      {
+        tiles.emplace_back (x, z);
       }
+    }
+  }
 
-      // - MWMO ----------------------------------------------
-      file.seek(Header.mwmo + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MWMO');
+  // read the m2/wmo entries of every tile
+  std::vector<uid_fix_tile_entries> entries (tiles.size());
 
+  noggit::parallel_for
+    ( tiles.size()
+    , [&] (std::size_t i)
       {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
+        std::stringstream filename;
+        filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tiles[i].x << "_" << tiles[i].z << ".adt";
 
-        while (lCurPos < lEnd)
-        {
-          wmoFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
-        }
+        read_uid_fix_entries (filename.str(), tiles[i], entries[i]);
       }
+    );
 
-      file.close();
+  // the instances are created from the last tile to the first one and in
+  // file order for each tile, which sets the uids each instance gets
+  std::vector<ModelInstance> models;
+  std::vector<WMOInstance> wmos;
 
-      for (ENTRY_MDDF& entry : modelEntries)
+  {
+    std::size_t model_count = 0;
+    std::size_t wmo_count = 0;
+
+    for (auto const& tile_entries : entries)
+    {
+      model_count += tile_entries.models.size();
+      wmo_count += tile_entries.wmos.size();
+    }
+
+    models.reserve (model_count);
+    wmos.reserve (wmo_count);
+  }
+
+  for (auto tile_entries = entries.rbegin(); tile_entries != entries.rend(); ++tile_entries)
+  {
+    for (ENTRY_MDDF const& entry : tile_entries->models)
+    {
+      models.emplace_back (tile_entries->model_filenames[entry.nameID], &entry, _context);
+    }
+    for (ENTRY_MODF const& entry : tile_entries->wmos)
+    {
+      wmos.emplace_back (tile_entries->wmo_filenames[entry.nameID], &entry, _context);
+    }
+  }
+
+  entries.clear();
+
+  // the models load in the background, wait for them and compute the
+  // extents concurrently
+  noggit::parallel_for
+    ( models.size()
+    , [&] (std::size_t i)
       {
-        models.emplace_front(modelFilenames[entry.nameID], &entry, _context);
+        models[i].model->wait_until_loaded();
+        models[i].recalcExtents();
       }
-      for (ENTRY_MODF& entry : wmoEntries)
+    );
+  noggit::parallel_for
+    ( wmos.size()
+    , [&] (std::size_t i)
       {
-        wmos.emplace_front(wmoFilenames[entry.nameID], &entry, _context);
+        wmos[i].wmo->wait_until_loaded();
+        wmos[i].recalcExtents();
       }
-    }
-  }
+    );
 
   // set all uids
   // for each tile save the m2/wmo present inside
   highestGUID = 0;
 
-  std::map<std::size_t, std::map<std::size_t, std::forward_list<std::uint32_t>>> uids_per_tile;
+  std::vector<std::forward_list<std::uint32_t>> uids_per_tile (64 * 64);
 
   bool loading_error = false;
 
   for (ModelInstance& instance : models)
   {
     instance.uid = highestGUID++;
-    instance.model->wait_until_loaded();
-    instance.recalcExtents();
 
     loading_error |= instance.model->loading_failed();
 
@@ -913,7 +1282,7 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
     {
       for (std::size_t x = sx; x <= ex; ++x)
       {
-        uids_per_tile[z][x].push_front (real_uid);
+        uids_per_tile[z * 64 + x].push_front (real_uid);
       }
     }
   }
@@ -923,8 +1292,6 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
   for (WMOInstance& instance : wmos)
   {
     instance.uid = highestGUID++;
-    instance.wmo->wait_until_loaded();
-    instance.recalcExtents();
     // no need to check if the loading is finished since the extents are stored inside the adt
     // to avoid going outside of bound
     std::size_t sx = std::max((std::size_t)(instance.extents[0].x / TILESIZE), (std::size_t)0);
@@ -938,7 +1305,7 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
     {
       for (std::size_t x = sx; x <= ex; ++x)
       {
-        uids_per_tile[z][x].push_front (real_uid);
+        uids_per_tile[z * 64 + x].push_front (real_uid);
       }
     }
   }
@@ -952,34 +1319,52 @@ uid_fix_status MapIndex::fixUIDs (World* world, bool cancel_on_model_loading_err
 
   // load each tile without the models and
   // save them with the models with the new uids
-  for (int z = 0; z < 64; ++z)
+  // load even the tiles without models in case there are old ones
+  // that shouldn't be there to avoid creating new duplicates
+  std::size_t const batch_size (2 * noggit::parallel_for_concurrency());
+
+  for (std::size_t first = 0; first < tiles.size(); first += batch_size)
   {
-    for (int x = 0; x < 64; ++x)
-    {
-      if (!(mTiles[z][x].flags & 1))
-      {
-        continue;
-      }
+    std::vector<std::unique_ptr<MapTile>> batch (std::min (batch_size, tiles.size() - first));
 
-      // load even the tiles without models in case there are old ones
-      // that shouldn't be there to avoid creating new duplicates
+    // load the tiles without the models
+    noggit::parallel_for
+      ( batch.size()
+      , [&] (std::size_t i)
+        {
+          tile_index const& index (tiles[first + i]);
 
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
+          std::stringstream filename;
+          filename << "World\\Maps\\" << basename << "\\" << basename << "_" << index.x << "_" << index.z << ".adt";
 
-      // load the tile without the models
-      MapTile tile(x, z, filename.str(), mBigAlpha, false, use_mclq_green_lava(), false, world, _context, tile_mode::uid_fix_all);
-      tile.finishLoading();
+          batch[i] = std::make_unique<MapTile> ( index.x, index.z, filename.str(), mBigAlpha, false
+                                               , use_mclq_green_lava(), false, world, _context
+                                               , tile_mode::uid_fix_all
+                                               );
+          batch[i]->finishLoading();
+        }
+      );
+
+    // add the uids to the tile to be able to save the models
+    // which have been loaded in world earlier, the instances are
+    // shared between tiles so they are referenced one tile at a time
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+      tile_index const& index (tiles[first + i]);
 
-      // add the uids to the tile to be able to save the models
-      // which have been loaded in world earlier
-      for (std::uint32_t uid : uids_per_tile[z][x])
+      for (std::uint32_t uid : uids_per_tile[index.z * 64 + index.x])
       {
-        tile.add_model(uid);
+        batch[i]->add_model(uid);
       }
-
-      tile.saveTile(world);
     }
+
+    noggit::parallel_for
+      ( batch.size()
+      , [&] (std::size_t i)
+        {
+          batch[i]->saveTile(world);
+        }
+      );
   }
 
   // override the db highest uid if used
@@ -1110,6 +1495,8 @@ void MapIndex::saveMinimapMD5translate()
   QFile file = QFile(filepath);
   if (file.open(QIODevice::WriteOnly | QIODevice::Text | QFile::Truncate))
   {
+    MPQFile::project_file_created ("textures/minimap/md5translate.trs");
+
     QTextStream out(&file);
 
     for (auto it = _minimap_md5translate.begin(); it != _minimap_md5translate.end(); ++it)
@@ -1139,8 +1526,8 @@ void MapIndex::addTile(const tile_index& tile)
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile.x << "_" << tile.z << ".adt";
 
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
-      mBigAlpha, true, use_mclq_green_lava(), false, _world, _context);
+  set_tile (tile, std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
+      mBigAlpha, true, use_mclq_green_lava(), false, _world, _context));
 
   mTiles[tile.z][tile.x].flags |= 0x1;
   mTiles[tile.z][tile.x].tile->changed = true;
@@ -1154,8 +1541,8 @@ void MapIndex::removeTile(const tile_index &tile)
 
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile.x << "_" << tile.z << ".adt";
-  mTiles[tile.z][tile.x].tile = std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
-     mBigAlpha, true, use_mclq_green_lava(), false, _world, _context);
+  set_tile (tile, std::make_unique<MapTile> (tile.x, tile.z, filename.str(),
+     mBigAlpha, true, use_mclq_green_lava(), false, _world, _context));
 
   mTiles[tile.z][tile.x].tile->changed = true;
   mTiles[tile.z][tile.x].onDisc = false;
@@ -1186,19 +1573,11 @@ void MapIndex::set_basename(const std::string &pBasename)
 {
   basename = pBasename;
 
-  for (int z = 0; z < 64; ++z)
+  for (MapTile* tile : resident_tiles())
   {
-    for (int x = 0; x < 64; ++x)
-    {
-      if (!mTiles[z][x].tile)
-      {
-        continue;
-      }
+    std::stringstream filename;
+    filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile->index.x << "_" << tile->index.z << ".adt";
 
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
-
-      mTiles[z][x].tile->setFilename(filename.str());
-    }
+    tile->setFilename(filename.str());
   }
 }
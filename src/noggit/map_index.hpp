@@ -11,15 +11,20 @@
 
 #include <boost/range/iterator_range.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 #include <limits>
+#include <vector>
 
 
 enum class uid_fix_status
@@ -38,59 +43,74 @@ private:
   uint32_t flags;
   std::unique_ptr<MapTile> tile;
   bool onDisc;
+  //! intrusive list of the entries holding a tile, see MapIndex::link_tile
+  MapTileEntry* prev_resident = nullptr;
+  MapTileEntry* next_resident = nullptr;
+  //! loaded ahead of the camera, and whether the camera came close since
+  bool prefetched = false;
+  bool viewed = false;
 
 
   MapTileEntry() : flags(0), tile(nullptr) {}
 
+  MapTileEntry (MapTileEntry const&) = delete;
+  MapTileEntry& operator= (MapTileEntry const&) = delete;
+
   friend class MapIndex;
 };
 
 class MapIndex
 {
 public:
-  template<bool Load>
-    struct tile_iterator
+  //! visits the tiles of the index rectangle [begin, end) in row order,
+  //! skipping the ones rejected by pred
+  template<bool Load, typename Pred>
+    struct tile_rect_iterator
       : std::iterator<std::forward_iterator_tag, MapTile*, std::ptrdiff_t, MapTile**, MapTile* const&>
   {
-    template<typename Pred>
-      tile_iterator (MapIndex* index, tile_index tile, Pred pred)
-        : _index (index)
-        , _tile (std::move (tile))
-        , _pred (std::move (pred))
+    tile_rect_iterator (MapIndex* index, tile_index begin, tile_index end, Pred pred)
+      : _index (index)
+      , _begin_x (begin.x)
+      , _end (std::move (end))
+      , _tile (std::move (begin))
+      , _pred (std::move (pred))
     {
-      if (!_pred (_tile, _index->getTile (_tile)))
+      if (!_index)
+      {
+        _tile = tile_index (0, 0);
+      }
+      else if (_tile.x >= _end.x || _tile.z >= _end.z)
+      {
+        _index = nullptr;
+        _tile = tile_index (0, 0);
+      }
+      else if (!_pred (_tile))
       {
         ++(*this);
       }
     }
 
-    tile_iterator()
-      : _index (nullptr)
-      , _tile (0, 0)
-      , _pred ([] (tile_index const&, MapTile*) { return false; })
-    {}
-
-    bool operator== (tile_iterator const& other) const
+    bool operator== (tile_rect_iterator const& other) const
     {
       return std::tie (_index, _tile) == std::tie (other._index, other._tile);
     }
-    bool operator!= (tile_iterator const& other) const
+    bool operator!= (tile_rect_iterator const& other) const
     {
       return !operator== (other);
     }
 
-    tile_iterator& operator++()
+    tile_rect_iterator& operator++()
     {
       do
       {
         ++_tile.x;
 
-        if (_tile.x == 64)
+        if (_tile.x == _end.x)
         {
-          _tile.x = 0;
+          _tile.x = _begin_x;
           ++_tile.z;
 
-          if (_tile.z == 64)
+          if (_tile.z == _end.z)
           {
             _tile.x = 0;
             _tile.z = 0;
@@ -99,14 +119,14 @@ public:
           }
         }
       }
-      while (!_pred (_tile, _index->getTile (_tile)));
+      while (!_pred (_tile));
 
       return *this;
     }
 
-    tile_iterator operator++ (int) const
+    tile_rect_iterator operator++ (int) const
     {
-      tile_iterator it (*this);
+      tile_rect_iterator it (*this);
       ++it;
       return it;
     }
@@ -121,29 +141,82 @@ public:
     }
 
     MapIndex* _index;
+    std::size_t _begin_x;
+    tile_index _end;
     tile_index _tile;
-    std::function<bool (tile_index const&, MapTile*)> _pred;
+    Pred _pred;
   };
 
-  template<bool Load>
-    auto tiles ( std::function<bool (tile_index const&, MapTile*)> pred
-               = [] (tile_index const&, MapTile*) { return true; }
-               )
+  //! walks the tiles currently held by the index, in tile index order
+  struct resident_tile_iterator
+    : std::iterator<std::forward_iterator_tag, MapTile*, std::ptrdiff_t, MapTile**, MapTile* const&>
   {
-    return boost::make_iterator_range
-      (tile_iterator<Load> {this, {0, 0}, pred}, tile_iterator<Load>{});
-  }
+    resident_tile_iterator (MapTileEntry* entry, bool finished_only)
+      : _entry (entry)
+      , _finished_only (finished_only)
+    {
+      skip();
+    }
+
+    bool operator== (resident_tile_iterator const& other) const
+    {
+      return _entry == other._entry;
+    }
+    bool operator!= (resident_tile_iterator const& other) const
+    {
+      return !operator== (other);
+    }
+
+    //! the links of an unlinked entry are kept so the current tile may be
+    //! unloaded while iterating
+    resident_tile_iterator& operator++()
+    {
+      _entry = _entry->next_resident;
+      skip();
+      return *this;
+    }
+
+    resident_tile_iterator operator++ (int) const
+    {
+      resident_tile_iterator it (*this);
+      ++it;
+      return it;
+    }
+
+    MapTile* operator*() const
+    {
+      return _entry->tile.get();
+    }
+    MapTile* operator->() const
+    {
+      return operator*();
+    }
+
+  private:
+    void skip()
+    {
+      while (_entry && !(_entry->tile && (!_finished_only || _entry->tile->finishedLoading())))
+      {
+        _entry = _entry->next_resident;
+      }
+    }
+
+    MapTileEntry* _entry;
+    bool _finished_only;
+  };
 
   auto loaded_tiles()
   {
-    return tiles<false>
-      ([] (tile_index const&, MapTile* tile) { return !!tile && tile->finishedLoading(); });
+    return boost::make_iterator_range
+      (resident_tile_iterator {_first_resident, true}, resident_tile_iterator {nullptr, true});
   }
 
   auto tiles_in_range (glm::vec3 const& pos, float radius)
   {
-    return tiles<true>
-      ( [this, pos, radius] (tile_index const& index, MapTile*)
+    return tiles_in_bounds<true>
+      ( {pos.x - radius, pos.z - radius}
+      , {pos.x + radius, pos.z + radius}
+      , [this, pos, radius] (tile_index const& index)
         {
           return hasTile(index) && misc::getShortestDist
             (pos.x, pos.z, index.x * TILESIZE, index.z * TILESIZE, TILESIZE) <= radius;
@@ -156,8 +229,10 @@ public:
     glm::vec2 l_chunk{pos.x - radius, pos.z - radius};
     glm::vec2 r_chunk{pos.x + radius, pos.z + radius};
 
-    return tiles<true>
-      ( [this, pos, radius, l_chunk, r_chunk] (tile_index const& index, MapTile*)
+    return tiles_in_bounds<true>
+      ( l_chunk
+      , r_chunk
+      , [this, radius, l_chunk, r_chunk] (tile_index const& index)
         {
           if (!hasTile(index) || radius == 0.f)
             return false;
@@ -170,11 +245,29 @@ public:
       );
   }
 
+  struct streaming_stats
+  {
+    //! tiles around the camera that were / were not loaded when reached
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned prefetched = 0;
+    //! prefetched tiles unloaded again before the camera came close
+    unsigned prefetched_unused = 0;
+    //! as of the last unloadTiles() check
+    std::size_t resident_bytes = 0;
+
+    float hit_rate() const
+    {
+      return hits + misses ? float (hits) / float (hits + misses) : 1.f;
+    }
+  };
+
   MapIndex(const std::string& pBasename, int map_id, World*, noggit::NoggitRenderContext context, bool create_empty = false);
 
   void set_basename(const std::string& pBasename);
 
-  void enterTile(const tile_index& tile);
+  //! loads the tiles around the camera and prefetches the ones along its predicted path
+  void enterTile(glm::vec3 const& camera_pos, float dt);
   MapTile *loadTile(const tile_index& tile, bool reloading = false);
 
   void update_model_tile(const tile_index& tile, model_update type, SceneObject* instance);
@@ -186,10 +279,15 @@ public:
   void setFlag(bool to, glm::vec3 const& pos, uint32_t flag);
   bool has_unsaved_changes(const tile_index& tile) const;
 
-  void saveTile(const tile_index& tile, World*, bool save_unloaded = false);
-  void saveChanged (World*, bool save_unloaded = false);
+  //! called between the batches of tiles saved, on the saving thread
+  using save_progress = std::function<void (std::size_t saved, std::size_t total)>;
+
+  //! the saving functions return the files which could not be written,
+  //! the tiles among them are left marked as changed
+  std::vector<std::string> saveTile(const tile_index& tile, World*, bool save_unloaded = false);
+  std::vector<std::string> saveChanged (World*, bool save_unloaded = false, save_progress const& progress = {});
   void reloadTile(const tile_index& tile);
-  void unloadTiles(const tile_index& tile);  // unloads all tiles more then x adts away from given
+  void unloadTiles(const tile_index& tile);  // unloads the tiles farthest from given until within the memory budget
   void unloadTile(const tile_index& tile);  // unload given tile
   void markOnDisc(const tile_index& tile, bool mto);
   bool isTileExternal(const tile_index& tile) const;
@@ -202,8 +300,9 @@ public:
   bool hasAdt();
   void setAdt(bool value);
 
-  void save();
-  void saveall (World*);
+  //! false if the wdt could not be written
+  bool save();
+  std::vector<std::string> saveall (World*, save_progress const& progress = {});
 
   MapTile* getTile(const tile_index& tile) const;
   MapTile* getTileAbove(MapTile* tile) const;
@@ -214,6 +313,7 @@ public:
   bool hasBigAlpha() const { return mBigAlpha; }
   void setBigAlpha(bool state) { mBigAlpha = state; };
   unsigned getNLoadedTiles() { return _n_loaded_tiles; }
+  streaming_stats const& streamingStats() const { return _streaming_stats; }
 
   bool sort_models_by_size_class() const { return _sort_models_by_size_class; }
   void set_sort_models_by_size_class(bool state) { _sort_models_by_size_class = state; }
@@ -247,6 +347,47 @@ public:
 private:
 	uint32_t getHighestGUIDFromFile(const std::string& pFilename) const;
 
+  void prefetchTiles(glm::vec3 const& camera_pos, float dt);
+
+  //! serializes and writes the tiles on the parallel_for workers, those
+  //! written are no longer changed afterwards. returns the others
+  std::vector<std::string> save_tiles (std::vector<MapTile*> const& tiles, World*, save_progress const& progress);
+
+  //! tiles held by the index, whether they finished loading or not
+  auto resident_tiles()
+  {
+    return boost::make_iterator_range
+      (resident_tile_iterator {_first_resident, false}, resident_tile_iterator {nullptr, false});
+  }
+
+  //! only visits the tile indices covering [min, max], pred still decides
+  //! which of them are part of the range
+  template<bool Load, typename Pred>
+    boost::iterator_range<tile_rect_iterator<Load, Pred>>
+      tiles_in_bounds (glm::vec2 const& min, glm::vec2 const& max, Pred pred)
+  {
+    auto const to_index
+    ( [] (float pos)
+      {
+        return static_cast<std::size_t> (std::clamp (std::floor (pos / TILESIZE), 0.f, 63.f));
+      }
+    );
+
+    // one more tile on the low side for positions right on a tile border
+    tile_index const begin (to_index (min.x - TILESIZE), to_index (min.y - TILESIZE));
+    tile_index const end (to_index (max.x) + 1, to_index (max.y) + 1);
+
+    return boost::make_iterator_range
+      ( tile_rect_iterator<Load, Pred> {this, begin, end, pred}
+      , tile_rect_iterator<Load, Pred> {nullptr, end, end, pred}
+      );
+  }
+
+  //! sets the tile of the entry, keeping the resident list up to date
+  void set_tile(const tile_index& tile, std::unique_ptr<MapTile> adt);
+  void link_tile(MapTileEntry& entry);
+  void unlink_tile(MapTileEntry& entry);
+
   bool _uid_fix_all_in_progress = false;
 
   std::string basename;
@@ -258,9 +399,14 @@ public:
 private:
   std::string globalWMOName;
 
-  int _last_unload_time;
+  std::chrono::steady_clock::time_point _last_unload_time;
   int _unload_interval;
-  int _unload_dist;
+  std::size_t _unload_memory_budget;
+
+  glm::vec3 _last_camera_pos = {};
+  glm::vec3 _camera_velocity = {};
+  std::vector<tile_index> _prefetch_path;
+  streaming_stats _streaming_stats;
   unsigned _n_loaded_tiles = 0; // to be loaded, not necessarily already loaded
   int _n_existing_tiles = -1;
 
@@ -281,6 +427,8 @@ private:
 
   // Holding all MapTiles there can be in a World.
   MapTileEntry mTiles[64][64];
+  MapTileEntry* _first_resident = nullptr;
+  MapTileEntry* _last_resident = nullptr;
 
   //! \todo REMOVE!
   World* _world;
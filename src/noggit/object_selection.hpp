@@ -0,0 +1,171 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <boost/optional/optional.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace noggit
+{
+  //! the selected entries in selection order, and what is kept about the
+  //! objects among them: their uids for constant time lookups and the sum
+  //! of their positions for the pivot of multi object transforms.
+  //! ObjectOf maps an entry to the object it holds, which has a uid and a
+  //! pos, or to nullptr if it holds none.
+  template<typename Entry, typename ObjectOf>
+    class object_selection
+  {
+  public:
+    std::vector<Entry> const& entries() const { return _entries; }
+    bool empty() const { return _entries.empty(); }
+    bool contains (std::uint32_t uid) const { return _uids.find (uid) != _uids.end(); }
+    int object_count() const { return _object_count; }
+    //! the average position of the objects, while more than one is selected
+    boost::optional<glm::vec3> const& pivot() const { return _pivot; }
+
+    void add (Entry const& entry)
+    {
+      if (add_without_pivot (entry))
+      {
+        update_pivot_from_sum();
+      }
+    }
+
+    void add (std::vector<Entry> const& entries)
+    {
+      _entries.reserve (_entries.size() + entries.size());
+
+      for (auto const& entry : entries)
+      {
+        add_without_pivot (entry);
+      }
+
+      update_pivot_from_sum();
+    }
+
+    //! for the entries which aren't objects, those are removed by uid
+    void remove (Entry const& entry)
+    {
+      auto const position (std::find (_entries.begin(), _entries.end(), entry));
+
+      if (position != _entries.end())
+      {
+        _entries.erase (position);
+      }
+    }
+
+    void remove (std::vector<std::uint32_t> const& uids)
+    {
+      std::size_t const selected_count (_uids.size());
+
+      for (std::uint32_t uid : uids)
+      {
+        _uids.erase (uid);
+      }
+
+      if (_uids.size() == selected_count)
+      {
+        return;
+      }
+
+      // the sum is rebuilt from the current positions in the same pass, they
+      // may have changed since the objects were selected
+      _position_sum = glm::vec3 (0.f);
+
+      // a single pass keeps the selection order
+      _entries.erase
+        ( std::remove_if ( _entries.begin()
+                         , _entries.end()
+                         , [&] (Entry const& entry)
+                           {
+                             auto const object (ObjectOf() (entry));
+
+                             if (!object)
+                             {
+                               return false;
+                             }
+
+                             if (contains (object->uid))
+                             {
+                               _position_sum += object->pos;
+                               return false;
+                             }
+
+                             _object_count--;
+                             return true;
+                           }
+                         )
+        , _entries.end()
+        );
+
+      update_pivot_from_sum();
+    }
+
+    void clear()
+    {
+      _entries.clear();
+      _uids.clear();
+      _position_sum = glm::vec3 (0.f);
+      _pivot = boost::none;
+      _object_count = 0;
+    }
+
+    //! to call once selected objects moved
+    void update_pivot()
+    {
+      _position_sum = glm::vec3 (0.f);
+
+      for (auto const& entry : _entries)
+      {
+        if (auto const object = ObjectOf() (entry))
+        {
+          _position_sum += object->pos;
+        }
+      }
+
+      update_pivot_from_sum();
+    }
+
+  private:
+    //! false if the object is already selected, doesn't update the pivot
+    bool add_without_pivot (Entry const& entry)
+    {
+      if (auto const object = ObjectOf() (entry))
+      {
+        if (!_uids.emplace (object->uid).second)
+        {
+          return false;
+        }
+
+        _position_sum += object->pos;
+        _object_count++;
+      }
+
+      _entries.push_back (entry);
+      return true;
+    }
+
+    void update_pivot_from_sum()
+    {
+      if (_object_count > 1)
+      {
+        _pivot = _position_sum / static_cast<float> (_object_count);
+      }
+      else
+      {
+        _pivot = boost::none;
+      }
+    }
+
+    std::vector<Entry> _entries;
+    std::unordered_set<std::uint32_t> _uids;
+    int _object_count = 0;
+    glm::vec3 _position_sum = glm::vec3 (0.f);
+    boost::optional<glm::vec3> _pivot;
+  };
+}
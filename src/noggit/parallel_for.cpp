@@ -0,0 +1,190 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/parallel_for.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace noggit
+{
+  namespace
+  {
+    thread_local bool is_pool_worker = false;
+
+    struct job
+    {
+      job (std::size_t count_, std::function<void (std::size_t)> const& fun_)
+        : count (count_)
+        , fun (fun_)
+      {}
+
+      void execute()
+      {
+        for (std::size_t i = next++; i < count; i = next++)
+        {
+          try
+          {
+            fun (i);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> const lock (error_guard);
+            if (!error)
+            {
+              error = std::current_exception();
+            }
+            // skip whatever is left
+            next = count;
+          }
+        }
+      }
+
+      std::size_t const count;
+      std::function<void (std::size_t)> const& fun;
+      std::atomic<std::size_t> next = {0};
+
+      std::mutex error_guard;
+      std::exception_ptr error;
+
+      //! workers currently executing this job, guarded by the pool
+      std::size_t workers = 0;
+    };
+
+    class worker_pool
+    {
+    public:
+      static worker_pool& instance()
+      {
+        static worker_pool pool;
+        return pool;
+      }
+
+      worker_pool()
+      {
+        unsigned const threads
+          (std::max (1, static_cast<int> (std::thread::hardware_concurrency()) - 1));
+
+        for (unsigned i = 0; i < threads; ++i)
+        {
+          _threads.emplace_back (&worker_pool::process, this);
+        }
+      }
+
+      ~worker_pool()
+      {
+        {
+          std::lock_guard<std::mutex> const lock (_guard);
+          _stop = true;
+        }
+        _job_available.notify_all();
+
+        for (auto& thread : _threads)
+        {
+          thread.join();
+        }
+      }
+
+      std::size_t concurrency() const
+      {
+        return _threads.size() + 1;
+      }
+
+      void run (std::size_t count, std::function<void (std::size_t)> const& fun)
+      {
+        std::unique_lock<std::mutex> running (_running, std::try_to_lock);
+
+        if (count < 2 || is_pool_worker || !running.owns_lock())
+        {
+          for (std::size_t i = 0; i < count; ++i)
+          {
+            fun (i);
+          }
+          return;
+        }
+
+        job current (count, fun);
+
+        {
+          std::lock_guard<std::mutex> const lock (_guard);
+          _job = &current;
+          ++_generation;
+        }
+        _job_available.notify_all();
+
+        current.execute();
+
+        {
+          std::unique_lock<std::mutex> lock (_guard);
+          // late workers must not pick it up once it's gone
+          _job = nullptr;
+          _job_done.wait (lock, [&] { return current.workers == 0; });
+        }
+
+        if (current.error)
+        {
+          std::rethrow_exception (current.error);
+        }
+      }
+
+    private:
+      void process()
+      {
+        is_pool_worker = true;
+        std::size_t seen_generation = 0;
+
+        std::unique_lock<std::mutex> lock (_guard);
+
+        while (true)
+        {
+          _job_available.wait
+            (lock, [&] { return _stop || (_job && _generation != seen_generation); });
+
+          if (_stop)
+          {
+            return;
+          }
+
+          seen_generation = _generation;
+          job* current = _job;
+          ++current->workers;
+
+          lock.unlock();
+          current->execute();
+          lock.lock();
+
+          if (--current->workers == 0)
+          {
+            _job_done.notify_all();
+          }
+        }
+      }
+
+      //! held by the thread whose job is being executed
+      std::mutex _running;
+
+      std::mutex _guard;
+      std::condition_variable _job_available;
+      std::condition_variable _job_done;
+      job* _job = nullptr;
+      std::size_t _generation = 0;
+      bool _stop = false;
+
+      std::list<std::thread> _threads;
+    };
+  }
+
+  void parallel_for (std::size_t count, std::function<void (std::size_t)> const& fun)
+  {
+    worker_pool::instance().run (count, fun);
+  }
+
+  std::size_t parallel_for_concurrency()
+  {
+    return worker_pool::instance().concurrency();
+  }
+}
@@ -0,0 +1,19 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace noggit
+{
+  //! calls fun (i) for every i in [0, count), spread over a pool of worker
+  //! threads and the calling one. returns once every call is done and
+  //! rethrows the first exception thrown by one of them.
+  //! calls from a worker, or while the pool is busy, run on the calling
+  //! thread only so nesting can't deadlock.
+  void parallel_for (std::size_t count, std::function<void (std::size_t)> const& fun);
+
+  //! the number of threads parallel_for spreads its work over, caller included
+  std::size_t parallel_for_concurrency();
+}
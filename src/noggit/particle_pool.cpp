@@ -0,0 +1,121 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/particle_pool.hpp>
+
+#include <cmath>
+
+namespace
+{
+  // as math::interpolation::linear, its header does not build with gcc
+  template<class T>
+  T linear (float percentage, T const& start, T const& end)
+  {
+    return T (start * (1.0f - percentage) + end * percentage);
+  }
+
+  template<class T>
+  T lifeRamp(float life, float mid, const T &a, const T &b, const T &c)
+  {
+    if (life <= mid) return linear(life / mid, a, b);
+    else return linear((life - mid) / (1.0f - mid), b, c);
+  }
+}
+
+void ParticlePool::push_back (Particle const& particle)
+{
+  pos.push_back (particle.pos);
+  speed.push_back (particle.speed);
+  down.push_back (particle.down);
+  origin.push_back (particle.origin);
+  dir.push_back (particle.dir);
+  corners.push_back ({particle.corners[0], particle.corners[1], particle.corners[2], particle.corners[3]});
+  size.push_back (particle.size);
+  life.push_back (particle.life);
+  maxlife.push_back (particle.maxlife);
+  tile.push_back (particle.tile);
+  color.push_back (particle.color);
+}
+
+void ParticlePool::swap_remove (std::size_t i)
+{
+  auto remove ([i] (auto& values)
+  {
+    values[i] = values.back();
+    values.pop_back();
+  });
+
+  remove (pos);
+  remove (speed);
+  remove (down);
+  remove (origin);
+  remove (dir);
+  remove (corners);
+  remove (size);
+  remove (life);
+  remove (maxlife);
+  remove (tile);
+  remove (color);
+}
+
+void ParticlePool::update ( float dt, float gravity, float deacceleration, float slowdown
+                          , float mid, std::array<float, 3> const& sizes
+                          , std::array<glm::vec4, 3> const& colors
+                          )
+{
+  std::size_t const n = count();
+  glm::vec3* p_pos = pos.data();
+  glm::vec3* p_speed = speed.data();
+  glm::vec3 const* p_down = down.data();
+  glm::vec3 const* p_dir = dir.data();
+  float* p_life = life.data();
+  float* p_size = size.data();
+  glm::vec4* p_color = color.data();
+  float const* p_maxlife = maxlife.data();
+
+  // one field at a time so the loops vectorize
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    p_speed[i] += p_down[i] * (gravity * dt) - p_dir[i] * (deacceleration * dt);
+  }
+
+  if (slowdown > 0)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      p_pos[i] += p_speed[i] * (std::exp(-1.0f * slowdown * p_life[i]) * dt);
+    }
+  }
+  else
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      p_pos[i] += p_speed[i] * dt;
+    }
+  }
+
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    p_life[i] += dt;
+  }
+
+  // calculate size and color based on lifetime
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    float rlife = p_life[i] / p_maxlife[i];
+    p_size[i] = lifeRamp<float>(rlife, mid, sizes[0], sizes[1], sizes[2]);
+    p_color[i] = lifeRamp<glm::vec4>(rlife, mid, colors[0], colors[1], colors[2]);
+  }
+
+  // kill off old particles
+  for (std::size_t i = 0; i < count();)
+  {
+    if (life[i] / maxlife[i] >= 1.0f)
+    {
+      swap_remove (i);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+}
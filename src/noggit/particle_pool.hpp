@@ -0,0 +1,45 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+struct Particle {
+  glm::vec3 pos, speed, down, origin, dir;
+  glm::vec3  corners[4];
+  //glm::vec3 tpos;
+  float size, life, maxlife;
+  unsigned int tile;
+  glm::vec4 color;
+};
+
+//! the particles of a system as a structure of arrays, so the update runs
+//! over packed fields. a dead particle is replaced by the last one
+class ParticlePool
+{
+public:
+  std::size_t count() const { return pos.size(); }
+  bool empty() const { return pos.empty(); }
+
+  void push_back (Particle const& particle);
+  void swap_remove (std::size_t i);
+
+  //! moves and ages the particles by dt, then removes the ones past their
+  //! lifespan. sizes and colors are those at birth, at mid life and at
+  //! death, mid being the part of the lifespan mid life is at
+  void update ( float dt, float gravity, float deacceleration, float slowdown
+              , float mid, std::array<float, 3> const& sizes
+              , std::array<glm::vec4, 3> const& colors
+              );
+
+  std::vector<glm::vec3> pos, speed, down, origin, dir;
+  std::vector<std::array<glm::vec3, 4>> corners;
+  std::vector<float> size, life, maxlife;
+  std::vector<unsigned int> tile;
+  std::vector<glm::vec4> color;
+};
@@ -0,0 +1,167 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/terrain_blur.hpp>
+#include <noggit/MapHeaders.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace noggit
+{
+  namespace
+  {
+    constexpr float cell_size = UNITSIZE * 0.5f;
+
+    int cell (float position)
+    {
+      return static_cast<int> (std::lround (position / cell_size));
+    }
+
+    //! applies the tent kernel of the given radius to the `count` values
+    //! around `first_output` in line, separated by `stride`. the values
+    //! within `kernel_size` of every output have to exist
+    void tent_filter ( float const* line
+                     , std::size_t stride
+                     , std::size_t length
+                     , std::size_t first_output
+                     , std::size_t count
+                     , int kernel_size
+                     , float radius
+                     , float* output
+                     , std::size_t output_stride
+                     , std::vector<double>& sums
+                     , std::vector<double>& moments
+                     )
+    {
+      sums.assign (length + 1, 0.);
+      moments.assign (length + 1, 0.);
+
+      for (std::size_t i = 0; i < length; ++i)
+      {
+        double const value (line[i * stride]);
+        sums[i + 1] = sums[i] + value;
+        moments[i + 1] = moments[i] + value * i;
+      }
+
+      std::size_t const k (kernel_size);
+
+      for (std::size_t o = 0; o < count; ++o)
+      {
+        std::size_t const i (first_output + o);
+        double const center (i);
+
+        // sum of |m - i| * value[m] over both sides of i
+        double const after ( (moments[i + k + 1] - moments[i + 1])
+                           - center * (sums[i + k + 1] - sums[i + 1])
+                           );
+        double const before ( center * (sums[i] - sums[i - k])
+                            - (moments[i] - moments[i - k])
+                            );
+
+        output[o * output_stride] = static_cast<float>
+          ((sums[i + k + 1] - sums[i - k]) - (k ? (after + before) / radius : 0.));
+      }
+    }
+  }
+
+  terrain_blur::terrain_blur (glm::vec3 const& center, float radius)
+    : _radius_in_cells (radius / cell_size)
+    // the weight 1 - d / radius vanishes from d = radius on
+    , _kernel_size (std::max (0, static_cast<int> (std::ceil (_radius_in_cells)) - 1))
+  {
+    int const reach (static_cast<int> (std::ceil (_radius_in_cells)));
+
+    _average_begin_x = cell (center.x) - reach;
+    _average_begin_z = cell (center.z) - reach;
+    _average_size = 2 * reach + 1;
+
+    _begin_x = _average_begin_x - _kernel_size;
+    _begin_z = _average_begin_z - _kernel_size;
+    _size = _average_size + 2 * _kernel_size;
+
+    _heights.resize (_size * _size, 0.f);
+    _weights.resize (_size * _size, 0.f);
+  }
+
+  void terrain_blur::add_vertices (glm::vec3 const* vertices, std::size_t count)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      std::size_t const x (cell (vertices[i].x) - _begin_x);
+      std::size_t const z (cell (vertices[i].z) - _begin_z);
+
+      if (x < _size && z < _size)
+      {
+        // vertices on chunk borders are shared and land on the same cell
+        _heights[z * _size + x] = vertices[i].y;
+        _weights[z * _size + x] = 1.f;
+      }
+    }
+  }
+
+  void terrain_blur::compute()
+  {
+    std::vector<double> sums;
+    std::vector<double> moments;
+
+    // along x first, only for the columns which get averaged
+    std::vector<float> heights (_size * _average_size);
+    std::vector<float> weights (_size * _average_size);
+
+    for (std::size_t z = 0; z < _size; ++z)
+    {
+      for (auto [input, output] : { std::make_pair (&_heights, &heights)
+                                  , std::make_pair (&_weights, &weights)
+                                  }
+          )
+      {
+        tent_filter ( &(*input)[z * _size], 1, _size
+                    , _kernel_size, _average_size
+                    , _kernel_size, _radius_in_cells
+                    , &(*output)[z * _average_size], 1
+                    , sums, moments
+                    );
+      }
+    }
+
+    _averages.resize (_average_size * _average_size);
+    _average_weights.resize (_average_size * _average_size);
+
+    for (std::size_t x = 0; x < _average_size; ++x)
+    {
+      for (auto [input, output] : { std::make_pair (&heights, &_averages)
+                                  , std::make_pair (&weights, &_average_weights)
+                                  }
+          )
+      {
+        tent_filter ( &(*input)[x], _average_size, _size
+                    , _kernel_size, _average_size
+                    , _kernel_size, _radius_in_cells
+                    , &(*output)[x], _average_size
+                    , sums, moments
+                    );
+      }
+    }
+  }
+
+  boost::optional<float> terrain_blur::average (glm::vec3 const& vertex) const
+  {
+    std::size_t const x (cell (vertex.x) - _average_begin_x);
+    std::size_t const z (cell (vertex.z) - _average_begin_z);
+
+    if (x >= _average_size || z >= _average_size)
+    {
+      return boost::none;
+    }
+
+    float const weight (_average_weights[z * _average_size + x]);
+
+    if (weight <= 0.f)
+    {
+      return boost::none;
+    }
+
+    return _averages[z * _average_size + x] / weight;
+  }
+}
@@ -0,0 +1,52 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace noggit
+{
+  //! weighted average of the terrain heights around the vertices of a
+  //! blur brush, in a time independent of its radius.
+  //! vertices are gathered on a grid of half a unit, outer ones on cells
+  //! with even coordinates and inner ones on odd cells, and filtered by a
+  //! separable tent kernel of the brush radius computed from prefix sums.
+  class terrain_blur
+  {
+  public:
+    terrain_blur (glm::vec3 const& center, float radius);
+
+    //! vertices outside of twice the radius are ignored
+    void add_vertices (glm::vec3 const* vertices, std::size_t count);
+
+    //! to call once every vertex is added
+    void compute();
+
+    //! none for vertices outside of the radius or without any neighbor
+    boost::optional<float> average (glm::vec3 const& vertex) const;
+
+  private:
+    float _radius_in_cells;
+    int _kernel_size;
+
+    //! global cell coordinates of the first gathered and averaged cells
+    int _begin_x;
+    int _begin_z;
+    int _average_begin_x;
+    int _average_begin_z;
+
+    std::size_t _size;
+    std::size_t _average_size;
+
+    //! gathered heights, zero where there is no vertex, and vertex counts
+    std::vector<float> _heights;
+    std::vector<float> _weights;
+
+    std::vector<float> _averages;
+    std::vector<float> _average_weights;
+  };
+}
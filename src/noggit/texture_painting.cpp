@@ -0,0 +1,386 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/Brush.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/texture_painting.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+#endif
+
+namespace
+{
+  // the blend is done on a few texels at once, one lane per texel, each
+  // lane going through exactly the double operations blend_texel does on
+  // a single texel. branches become selects between the possible results.
+
+  struct scalar_lanes
+  {
+    static constexpr int width = 1;
+    using value = double;
+    using mask = bool;
+
+    static value set (double d) { return d; }
+    static value load (float const* p) { return *p; }
+    static void store (float* p, value v) { *p = static_cast<float> (v); }
+
+    static value add (value a, value b) { return a + b; }
+    static value sub (value a, value b) { return a - b; }
+    static value mul (value a, value b) { return a * b; }
+    static value div (value a, value b) { return a / b; }
+    static value abs (value v) { return std::abs (v); }
+    static value negate (value v) { return -v; }
+
+    static mask less (value a, value b) { return a < b; }
+    static mask less_equal (value a, value b) { return a <= b; }
+    static mask greater (value a, value b) { return a > b; }
+    static mask both (mask a, mask b) { return a && b; }
+    static mask but_not (mask a, mask b) { return a && !b; }
+    static value select (mask m, value a, value b) { return m ? a : b; }
+    static bool any (mask m) { return m; }
+
+    static mask float_equals (float const* p, float f) { return misc::float_equals (*p, f); }
+  };
+
+#if defined(__AVX__)
+  struct wide_lanes
+  {
+    static constexpr int width = 4;
+    using value = __m256d;
+    using mask = __m256d;
+
+    static value set (double d) { return _mm256_set1_pd (d); }
+    static value load (float const* p) { return _mm256_cvtps_pd (_mm_loadu_ps (p)); }
+    static void store (float* p, value v) { _mm_storeu_ps (p, _mm256_cvtpd_ps (v)); }
+
+    static value add (value a, value b) { return _mm256_add_pd (a, b); }
+    static value sub (value a, value b) { return _mm256_sub_pd (a, b); }
+    static value mul (value a, value b) { return _mm256_mul_pd (a, b); }
+    static value div (value a, value b) { return _mm256_div_pd (a, b); }
+    static value abs (value v) { return _mm256_andnot_pd (_mm256_set1_pd (-0.), v); }
+    static value negate (value v) { return _mm256_xor_pd (v, _mm256_set1_pd (-0.)); }
+
+    static mask less (value a, value b) { return _mm256_cmp_pd (a, b, _CMP_LT_OQ); }
+    static mask less_equal (value a, value b) { return _mm256_cmp_pd (a, b, _CMP_LE_OQ); }
+    static mask greater (value a, value b) { return _mm256_cmp_pd (a, b, _CMP_GT_OQ); }
+    static mask both (mask a, mask b) { return _mm256_and_pd (a, b); }
+    static mask but_not (mask a, mask b) { return _mm256_andnot_pd (b, a); }
+    static value select (mask m, value a, value b) { return _mm256_blendv_pd (b, a, m); }
+    static bool any (mask m) { return _mm256_movemask_pd (m) != 0; }
+
+    //! misc::float_equals, compared in float as it is
+    static mask float_equals (float const* p, float f)
+    {
+      __m128 const a (_mm_loadu_ps (p));
+      __m128 const b (_mm_set1_ps (f));
+      __m128 const difference (_mm_andnot_ps (_mm_set1_ps (-0.f), _mm_sub_ps (a, b)));
+      __m128 const limit ( _mm_mul_ps ( _mm_max_ps (_mm_set1_ps (1.f), _mm_max_ps (a, b))
+                                      , _mm_set1_ps (std::numeric_limits<float>::epsilon())
+                                      )
+                         );
+      __m128 const equal (_mm_cmplt_ps (difference, limit));
+      return _mm256_castps_pd (_mm256_set_m128 (_mm_unpackhi_ps (equal, equal), _mm_unpacklo_ps (equal, equal)));
+    }
+  };
+#elif defined(__SSE2__) || defined(_M_X64)
+  struct wide_lanes
+  {
+    static constexpr int width = 2;
+    using value = __m128d;
+    using mask = __m128d;
+
+    static __m128 load_floats (float const* p)
+    {
+      return _mm_castsi128_ps (_mm_loadl_epi64 (reinterpret_cast<__m128i const*> (p)));
+    }
+
+    static value set (double d) { return _mm_set1_pd (d); }
+    static value load (float const* p) { return _mm_cvtps_pd (load_floats (p)); }
+    static void store (float* p, value v)
+    {
+      _mm_storel_epi64 (reinterpret_cast<__m128i*> (p), _mm_castps_si128 (_mm_cvtpd_ps (v)));
+    }
+
+    static value add (value a, value b) { return _mm_add_pd (a, b); }
+    static value sub (value a, value b) { return _mm_sub_pd (a, b); }
+    static value mul (value a, value b) { return _mm_mul_pd (a, b); }
+    static value div (value a, value b) { return _mm_div_pd (a, b); }
+    static value abs (value v) { return _mm_andnot_pd (_mm_set1_pd (-0.), v); }
+    static value negate (value v) { return _mm_xor_pd (v, _mm_set1_pd (-0.)); }
+
+    static mask less (value a, value b) { return _mm_cmplt_pd (a, b); }
+    static mask less_equal (value a, value b) { return _mm_cmple_pd (a, b); }
+    static mask greater (value a, value b) { return _mm_cmpgt_pd (a, b); }
+    static mask both (mask a, mask b) { return _mm_and_pd (a, b); }
+    static mask but_not (mask a, mask b) { return _mm_andnot_pd (b, a); }
+    static value select (mask m, value a, value b) { return _mm_or_pd (_mm_and_pd (m, a), _mm_andnot_pd (m, b)); }
+    static bool any (mask m) { return _mm_movemask_pd (m) != 0; }
+
+    //! misc::float_equals, compared in float as it is
+    static mask float_equals (float const* p, float f)
+    {
+      __m128 const a (load_floats (p));
+      __m128 const b (_mm_set1_ps (f));
+      __m128 const difference (_mm_andnot_ps (_mm_set1_ps (-0.f), _mm_sub_ps (a, b)));
+      __m128 const limit ( _mm_mul_ps ( _mm_max_ps (_mm_set1_ps (1.f), _mm_max_ps (a, b))
+                                      , _mm_set1_ps (std::numeric_limits<float>::epsilon())
+                                      )
+                         );
+      __m128 const equal (_mm_cmplt_ps (difference, limit));
+      return _mm_castps_pd (_mm_unpacklo_ps (equal, equal));
+    }
+  };
+#else
+  using wide_lanes = scalar_lanes;
+#endif
+
+  //! blend_texel for Lanes::width texels of a row at once, the ones
+  //! further than radius from the brush center are left as they are.
+  //! returns true if any texel changed
+  template<typename Lanes>
+    bool blend_texels ( tmp_edit_alpha_values& amaps
+                      , std::size_t offset
+                      , float const* distances
+                      , float const* brush_values
+                      , float radius
+                      , float strength
+                      , float pressure
+                      , int tex_layer
+                      , std::size_t nTextures
+                      )
+  {
+    using value = typename Lanes::value;
+
+    value const zero (Lanes::set (0.));
+    value const one (Lanes::set (1.));
+    value const full (Lanes::set (255.));
+
+    auto const active
+      ( Lanes::but_not ( Lanes::less_equal (Lanes::load (distances), Lanes::set (radius))
+                       , Lanes::float_equals (&amaps[tex_layer][offset], strength)
+                       )
+      );
+
+    if (!Lanes::any (active))
+    {
+      return false;
+    }
+
+    value alpha_values[4];
+    value total (zero);
+
+    for (int n = 0; n < 4; ++n)
+    {
+      alpha_values[n] = Lanes::load (&amaps[n][offset]);
+      total = Lanes::add (total, alpha_values[n]);
+    }
+
+    value const current_alpha (alpha_values[tex_layer]);
+    value const sum_other_alphas (Lanes::sub (total, current_alpha));
+    value alpha_change
+      ( Lanes::mul ( Lanes::mul (Lanes::sub (Lanes::set (strength), current_alpha), Lanes::set (pressure))
+                   , Lanes::load (brush_values)
+                   )
+      );
+
+    // alpha too low, set it to 0 directly
+    alpha_change = Lanes::select
+      ( Lanes::both ( Lanes::less (alpha_change, zero)
+                    , Lanes::less (Lanes::add (current_alpha, alpha_change), one)
+                    )
+      , Lanes::negate (current_alpha)
+      , alpha_change
+      );
+
+    auto const saturated (Lanes::less (sum_other_alphas, one));
+    auto const filling (Lanes::both (saturated, Lanes::greater (alpha_change, zero)));
+
+    // the three ways blend_texel takes, each computed for all lanes if
+    // any needs it: the other textures amounting to less than 1/255 with
+    // the alpha rising (filled) or falling (drained), or the change spread
+    // over the other textures
+    auto const spreading (Lanes::but_not (active, saturated));
+
+    value drained[4];
+    value spread[4];
+    std::copy (std::begin (alpha_values), std::end (alpha_values), drained);
+    std::copy (std::begin (alpha_values), std::end (alpha_values), spread);
+
+    if (Lanes::any (Lanes::but_not (saturated, filling)))
+    {
+      bool change_applied = false;
+
+      for (int layer = 0; layer < nTextures; ++layer)
+      {
+        if (layer == tex_layer)
+        {
+          drained[layer] = Lanes::add (drained[layer], alpha_change);
+        }
+        else
+        {
+          if (!change_applied)
+          {
+            drained[layer] = Lanes::sub (drained[layer], alpha_change);
+          }
+          else
+          {
+            drained[tex_layer] = Lanes::add (drained[tex_layer], drained[layer]);
+            drained[layer] = zero;
+          }
+
+          change_applied = true;
+        }
+      }
+    }
+
+    if (Lanes::any (spreading))
+    {
+      for (int layer = 0; layer < nTextures; ++layer)
+      {
+        if (layer == tex_layer)
+        {
+          spread[layer] = Lanes::add (spread[layer], alpha_change);
+        }
+        else
+        {
+          spread[layer] = Lanes::sub
+            (spread[layer], Lanes::div (Lanes::mul (alpha_change, spread[layer]), sum_other_alphas));
+
+          // clear values too low to be visible
+          auto const invisible (Lanes::less (spread[layer], one));
+          spread[tex_layer] = Lanes::select (invisible, Lanes::add (spread[tex_layer], spread[layer]), spread[tex_layer]);
+          spread[layer] = Lanes::select (invisible, zero, spread[layer]);
+        }
+      }
+    }
+
+    value blended[4];
+    value total_final (zero);
+
+    for (int layer = 0; layer < 4; ++layer)
+    {
+      value const filled
+        (layer >= nTextures ? alpha_values[layer] : layer == tex_layer ? full : zero);
+
+      blended[layer] = Lanes::select (filling, filled, Lanes::select (saturated, drained[layer], spread[layer]));
+      total_final = Lanes::add (total_final, blended[layer]);
+    }
+
+    // failsafe in case the sum of all alpha values deviate
+    auto const deviates (Lanes::greater (Lanes::abs (Lanes::sub (total_final, full)), Lanes::set (0.001)));
+
+    if (Lanes::any (Lanes::both (active, deviates)))
+    {
+      for (value& alpha : blended)
+      {
+        alpha = Lanes::select (deviates, Lanes::div (Lanes::mul (alpha, full), total_final), alpha);
+      }
+    }
+
+    for (int layer = 0; layer < 4; ++layer)
+    {
+      Lanes::store (&amaps[layer][offset], Lanes::select (active, blended[layer], alpha_values[layer]));
+    }
+
+    return true;
+  }
+}
+
+namespace noggit
+{
+  std::array<float, 64> texel_positions (float base)
+  {
+    std::array<float, 64> positions;
+    float position (base);
+
+    for (float& texel : positions)
+    {
+      texel = position;
+      position += TEXDETAILSIZE;
+    }
+
+    return positions;
+  }
+
+  bool paint_alphamaps ( tmp_edit_alpha_values& amaps
+                       , float xbase
+                       , float zbase
+                       , float x
+                       , float z
+                       , Brush const& brush
+                       , float strength
+                       , float pressure
+                       , int tex_layer
+                       , std::size_t nTextures
+                       )
+  {
+    bool changed = false;
+    float const radius = brush.getRadius();
+
+    auto const x_positions (texel_positions (xbase));
+    auto const z_positions (texel_positions (zbase));
+    std::array<float, 64> distances;
+    std::array<float, 64> brush_values;
+
+    for (int j = 0; j < 64; j++)
+    {
+      float const zdiff (z_positions[j] + TEXDETAILSIZE / 2.0f - z);
+
+      // skip the rows and the parts of rows out of the brush, keeping a texel
+      // of margin so the exact distance test below decides at the edges
+      if (std::abs (zdiff) > radius + TEXDETAILSIZE)
+      {
+        continue;
+      }
+
+      float const reach (std::sqrt (std::max (0.f, radius * radius - zdiff * zdiff)) + TEXDETAILSIZE);
+      int const begin (std::clamp (static_cast<int> (std::floor ((x - reach - xbase) / TEXDETAILSIZE)), 0, 64));
+      int const end (std::clamp (static_cast<int> (std::ceil ((x + reach - xbase) / TEXDETAILSIZE)) + 1, 0, 64));
+
+      if (begin >= end)
+      {
+        continue;
+      }
+
+      for (int i = begin; i < end; ++i)
+      {
+        float const xdiff (x_positions[i] + TEXDETAILSIZE / 2.0f - x);
+        distances[i] = std::sqrt (xdiff * xdiff + zdiff * zdiff);
+      }
+
+      brush.getValues (&distances[begin], &brush_values[begin], end - begin);
+
+      int i = begin;
+
+      for (; i + wide_lanes::width <= end; i += wide_lanes::width)
+      {
+        if (blend_texels<wide_lanes> ( amaps, i + 64 * j, &distances[i], &brush_values[i]
+                                     , radius, strength, pressure, tex_layer, nTextures
+                                     )
+           )
+        {
+          changed = true;
+        }
+      }
+
+      for (; i < end; ++i)
+      {
+        if (blend_texels<scalar_lanes> ( amaps, i + 64 * j, &distances[i], &brush_values[i]
+                                       , radius, strength, pressure, tex_layer, nTextures
+                                       )
+           )
+        {
+          changed = true;
+        }
+      }
+    }
+
+    return changed;
+  }
+}
@@ -0,0 +1,164 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/Misc.h>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+class Brush;
+
+struct tmp_edit_alpha_values
+{
+  using alpha_layer = std::array<float, 64 * 64>;
+  // use 4 "alphamaps" for an easier editing
+  std::array<alpha_layer, 4> map;
+
+  alpha_layer& operator[](std::size_t i)
+  {
+    return map.at(i);
+  }
+};
+
+namespace noggit
+{
+  //! positions of the 64 texels of a chunk row or column, accumulated the
+  //! same way painting always did so results don't shift
+  std::array<float, 64> texel_positions (float base);
+
+  //! moves the texel toward strength on tex_layer by the change computed
+  //! from its current alpha, taken from the other layers in proportion.
+  //! works in double on the 4 layers for more precision, returns false if
+  //! the texel is already at strength. paint_alphamaps does the same on
+  //! several texels at once, this is for changes computed per texel
+  template<typename AlphaChange>
+    bool blend_texel ( tmp_edit_alpha_values& amaps
+                     , std::size_t offset
+                     , int tex_layer
+                     , std::size_t nTextures
+                     , float strength
+                     , AlphaChange&& get_alpha_change
+                     )
+  {
+    std::array<double,4> alpha_values;
+    double total = 0.;
+
+    for (int n = 0; n < 4; ++n)
+    {
+      total += alpha_values[n] = amaps[n][offset];
+    }
+
+    double current_alpha = alpha_values[tex_layer];
+    double sum_other_alphas = (total - current_alpha);
+    double alpha_change = get_alpha_change (current_alpha);
+
+    // alpha too low, set it to 0 directly
+    if (alpha_change < 0. && current_alpha + alpha_change < 1.)
+    {
+      alpha_change = -current_alpha;
+    }
+
+    if (misc::float_equals(current_alpha, strength))
+    {
+      return false;
+    }
+
+    if (sum_other_alphas < 1.)
+    {
+      // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
+      if (alpha_change > 0.f)
+      {
+        for (int layer = 0; layer < nTextures; ++layer)
+        {
+          alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
+        }
+      }
+      // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
+      else
+      {
+        bool change_applied = false;
+
+        for (int layer = 0; layer < nTextures; ++layer)
+        {
+          if (layer == tex_layer)
+          {
+            alpha_values[layer] += alpha_change;
+          }
+          else
+          {
+            if (!change_applied)
+            {
+              alpha_values[layer] -= alpha_change;
+            }
+            else
+            {
+              alpha_values[tex_layer] += alpha_values[layer];
+              alpha_values[layer] = 0.;
+            }
+
+            change_applied = true;
+          }
+        }
+      }
+    }
+    else
+    {
+      for (int layer = 0; layer < nTextures; ++layer)
+      {
+        if (layer == tex_layer)
+        {
+          alpha_values[layer] += alpha_change;
+        }
+        else
+        {
+          alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
+
+          // clear values too low to be visible
+          if (alpha_values[layer] < 1.)
+          {
+            alpha_values[tex_layer] += alpha_values[layer];
+            alpha_values[layer] = 0.f;
+          }
+        }
+      }
+    }
+
+    double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
+
+    // failsafe in case the sum of all alpha values deviate
+    if (std::abs(total_final - 255.) > 0.001)
+    {
+      for (double& d : alpha_values)
+      {
+        d = d * 255. / total_final;
+      }
+    }
+
+    for (int n = 0; n < 4; ++n)
+    {
+      amaps[n][offset] = static_cast<float>(alpha_values[n]);
+    }
+
+    return true;
+  }
+
+  //! paints tex_layer with the brush centered on x, z onto the chunk at
+  //! xbase, zbase. only the texels the brush reaches are visited, a few of
+  //! them at once with SSE2 or AVX where available. the layers are
+  //! bit-identical to blending the texels one by one. returns true if any
+  //! texel changed
+  bool paint_alphamaps ( tmp_edit_alpha_values& amaps
+                       , float xbase
+                       , float zbase
+                       , float x
+                       , float z
+                       , Brush const& brush
+                       , float strength
+                       , float pressure
+                       , int tex_layer
+                       , std::size_t nTextures
+                       );
+}
@@ -6,10 +6,13 @@
 #include <noggit/Misc.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/World.h>
+#include <noggit/texture_painting.hpp>
 #include <noggit/texture_set.hpp>
 
 #include <algorithm>    // std::min
 #include <array>
+#include <cmath>
+#include <numeric>
 #include <boost/format.hpp>
 
 #include <boost/utility/in_place_factory.hpp>
@@ -371,7 +374,7 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
 
   bool changed = false;
 
-  float zPos, xPos, dist, radius;
+  float zPos, xPos, radius;
 
   int tex_layer = get_texture_index_or_add (std::move (texture), strength);
 
@@ -385,21 +388,28 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
   create_temporary_alphamaps_if_needed();
   auto& amaps = tmp_edit_values.get();
 
-  zPos = zbase;
+  auto const x_positions (noggit::texel_positions (xbase));
+  auto const z_positions (noggit::texel_positions (zbase));
 
   for (int j = 0; j < 64; j++)
   {
-    xPos = xbase;
+    zPos = z_positions[j];
+
+    // the whole row is outside of the brush
+    if (std::abs(z - (zPos + TEXDETAILSIZE / 2.0f)) > radius)
+    {
+      continue;
+    }
+
     for (int i = 0; i < 64; ++i)
     {
-      if(std::abs(x - (xPos + TEXDETAILSIZE / 2.0)) > radius || std::abs(z - (zPos + TEXDETAILSIZE / 2.0f)) > radius)
+      xPos = x_positions[i];
+
+      if (std::abs(x - (xPos + TEXDETAILSIZE / 2.0)) > radius)
       {
-        xPos += TEXDETAILSIZE;
         continue;
       }
 
-      dist = misc::dist(x, z, xPos + TEXDETAILSIZE / 2.0f, zPos + TEXDETAILSIZE / 2.0f);
-
       glm::vec3 const diff{glm::vec3{xPos + TEXDETAILSIZE / 2.0f, 0.f, zPos + TEXDETAILSIZE / 2.0f} - glm::vec3{x, 0.f, z}};
 
       int pixel_x = std::round(((diff.x + radius) / (2.f * radius)) * image->width());
@@ -417,114 +427,17 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
         image_factor = 0;
       }
 
-      std::size_t offset = i + 64 * j;
-      // use double for more precision
-      std::array<double,4> alpha_values;
-      double total = 0.;
-
-      for (int n = 0; n < 4; ++n)
-      {
-        total += alpha_values[n] = amaps[n][i + 64 * j];
-      }
-
-      double current_alpha = alpha_values[tex_layer];
-      double sum_other_alphas = (total - current_alpha);
-      double alpha_change = image_factor * (strength - current_alpha) * pressure;
-
-      // alpha too low, set it to 0 directly
-      if (alpha_change < 0. && current_alpha + alpha_change < 1.)
-      {
-        alpha_change = -current_alpha;
-      }
-
-      if (misc::float_equals(current_alpha, strength))
-      {
-        xPos += TEXDETAILSIZE;
-        continue;
-      }
-
-      if (sum_other_alphas < 1.)
-      {
-        // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
-        if (alpha_change > 0.f)
-        {
-          for (int layer = 0; layer < nTextures; ++layer)
-          {
-            alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
-          }
-        }
-          // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
-        else
-        {
-          bool change_applied = false;
-
-          for (int layer = 0; layer < nTextures; ++layer)
-          {
-            if (layer == tex_layer)
-            {
-              alpha_values[layer] += alpha_change;
-            }
-            else
-            {
-              if (!change_applied)
-              {
-                alpha_values[layer] -= alpha_change;
-              }
-              else
-              {
-                alpha_values[tex_layer] += alpha_values[layer];
-                alpha_values[layer] = 0.;
-              }
-
-              change_applied = true;
-            }
-          }
-        }
-      }
-      else
-      {
-        for (int layer = 0; layer < nTextures; ++layer)
-        {
-          if (layer == tex_layer)
-          {
-            alpha_values[layer] += alpha_change;
-          }
-          else
-          {
-            alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
-
-            // clear values too low to be visible
-            if (alpha_values[layer] < 1.)
-            {
-              alpha_values[tex_layer] += alpha_values[layer];
-              alpha_values[layer] = 0.f;
-            }
-          }
-        }
-      }
-
-      double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
-
-      // failsafe in case the sum of all alpha values deviate
-      if (std::abs(total_final - 255.) > 0.001)
-      {
-        for (double& d : alpha_values)
-        {
-          d = d * 255. / total_final;
-        }
-      }
-
-      for (int n = 0; n < 4; ++n)
+      if (noggit::blend_texel ( amaps, i + 64 * j, tex_layer, nTextures, strength
+                              , [&] (double current_alpha)
+                                {
+                                  return image_factor * (strength - current_alpha) * pressure;
+                                }
+                              )
+         )
       {
-        amaps[n][i + 64 * j] = static_cast<float>(alpha_values[n]);
+        changed = true;
       }
-
-      changed = true;
-
-
-      xPos += TEXDETAILSIZE;
     }
-    zPos += TEXDETAILSIZE;
   }
 
   if (!changed)
@@ -656,9 +569,7 @@ bool TextureSet::stampTexture(float xbase, float zbase, float x, float z, Brush*
 
 bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush* brush, float strength, float pressure, scoped_blp_texture_reference texture)
 {
-  bool changed = false;
-
-  float zPos, xPos, dist, radius;
+  float radius;
 
   int tex_layer = get_texture_index_or_add (std::move (texture), strength);
 
@@ -671,131 +582,13 @@ bool TextureSet::paintTexture(float xbase, float zbase, float x, float z, Brush*
 
   if (misc::getShortestDist(x, z, xbase, zbase, CHUNKSIZE) > radius)
   {
-    return changed;
+    return false;
   }
 
   create_temporary_alphamaps_if_needed();
   auto& amaps = tmp_edit_values.get();
 
-  zPos = zbase;
-
-  for (int j = 0; j < 64; j++)
-  {
-    xPos = xbase;
-    for (int i = 0; i < 64; ++i)
-    {
-      dist = misc::dist(x, z, xPos + TEXDETAILSIZE / 2.0f, zPos + TEXDETAILSIZE / 2.0f);
-
-      if (dist <= radius)
-      {
-        std::size_t offset = i + 64 * j;
-        // use double for more precision
-        std::array<double,4> alpha_values;
-        double total = 0.;
-
-        for (int n = 0; n < 4; ++n)
-        {
-          total += alpha_values[n] = amaps[n][i + 64 * j];
-        }
-
-        double current_alpha = alpha_values[tex_layer];
-        double sum_other_alphas = (total - current_alpha);
-        double alpha_change = (strength - current_alpha) * pressure * brush->getValue(dist);
-
-        // alpha too low, set it to 0 directly
-        if (alpha_change < 0. && current_alpha + alpha_change < 1.)
-        {
-          alpha_change = -current_alpha;
-        }
-
-        if (!misc::float_equals(current_alpha, strength))
-        {
-          if (sum_other_alphas < 1.)
-          {
-            // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
-            if (alpha_change > 0.f)
-            {
-              for (int layer = 0; layer < nTextures; ++layer)
-              {
-                alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
-              }
-            }
-            // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
-            else
-            {
-              bool change_applied = false;
-
-              for (int layer = 0; layer < nTextures; ++layer)
-              {
-                if (layer == tex_layer)
-                {
-                  alpha_values[layer] += alpha_change;
-                }
-                else
-                {
-                  if (!change_applied)
-                  {
-                    alpha_values[layer] -= alpha_change;
-                  }
-                  else
-                  {
-                    alpha_values[tex_layer] += alpha_values[layer];
-                    alpha_values[layer] = 0.;
-                  }
-
-                  change_applied = true;
-                }
-              }
-            }
-          }
-          else
-          {
-            for (int layer = 0; layer < nTextures; ++layer)
-            {
-              if (layer == tex_layer)
-              {
-                alpha_values[layer] += alpha_change;
-              }
-              else
-              {
-                alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
-
-                // clear values too low to be visible
-                if (alpha_values[layer] < 1.)
-                {
-                  alpha_values[tex_layer] += alpha_values[layer];
-                  alpha_values[layer] = 0.f;
-                }
-              }
-            }
-          }
-
-          double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
-
-          // failsafe in case the sum of all alpha values deviate
-          if (std::abs(total_final - 255.) > 0.001)
-          {
-            for (double& d : alpha_values)
-            {
-              d = d * 255. / total_final;
-            }
-          }
-
-          for (int n = 0; n < 4; ++n)
-          {
-            amaps[n][i + 64 * j] = static_cast<float>(alpha_values[n]);
-          }
-
-          changed = true;
-        }
-      }
-
-      xPos += TEXDETAILSIZE;
-    }
-    zPos += TEXDETAILSIZE;
-  }
-
-  if (!changed)
+  if (!noggit::paint_alphamaps (amaps, xbase, zbase, x, z, *brush, strength, pressure, tex_layer, nTextures))
   {
     return false;
   }
@@ -1001,6 +794,12 @@ std::vector<std::vector<uint8_t>> TextureSet::save_alpha(bool big_alphamap)
   return amaps;
 }
 
+std::size_t TextureSet::memory_usage() const
+{
+  // the alphamaps and temporary edit values are held inline
+  return sizeof(TextureSet) + textures.capacity() * sizeof(scoped_blp_texture_reference);
+}
+
 scoped_blp_texture_reference TextureSet::texture(size_t id)
 {
   return textures[id];
@@ -1163,52 +962,56 @@ bool TextureSet::removeDuplicate()
   return changed;
 }
 
-void TextureSet::uploadAlphamapData()
+namespace
 {
-  // This method assumes tile's alphamap storage is currently bound to the current texture unit
+  inline std::uint8_t float_alpha_to_uint8(float a)
+  {
+    return static_cast<std::uint8_t>(std::max(0.f, std::min(255.f, std::round(a))));
+  }
+}
 
+bool TextureSet::writeAlphamapTexels(std::uint8_t* texels)
+{
   if (!(_chunk->getUpdateFlags() & ChunkUpdateFlags::ALPHAMAP) || !nTextures)
-    return;
-
-  static std::array<float, 3 * 64 * 64> amap{};
+    return false;
 
-  if (tmp_edit_values)
+  for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
   {
-    auto& tmp_amaps = tmp_edit_values.get();
+    std::uint8_t* texel = texels + alpha_id;
 
-    for (int i = 0; i < 64 * 64; ++i)
+    if (alpha_id >= nTextures - 1)
     {
-      for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
+      for (int i = 0; i < 64 * 64; ++i, texel += 4)
       {
-        amap[i * 3 + alpha_id] = (alpha_id < nTextures - 1) ? tmp_amaps[alpha_id + 1][i] / 255.f : 0.f;
+        *texel = 0;
       }
     }
-  }
-  else
-  {
-    uint8_t const* alpha_ptr[3];
-
-    for (int i = 0; i < nTextures - 1; ++i)
+    else if (tmp_edit_values)
     {
-      alpha_ptr[i] = alphamaps[i]->getAlpha();
-    }
+      auto const& layer = tmp_edit_values.get()[alpha_id + 1];
 
-    for (int i = 0; i < 64 * 64; ++i)
-    {
-      for (int alpha_id = 0; alpha_id < 3; ++alpha_id)
+      for (int i = 0; i < 64 * 64; ++i, texel += 4)
       {
-        amap[i * 3 + alpha_id] = (alpha_id < nTextures - 1)
-                               ? *(alpha_ptr[alpha_id]++) / 255.0f
-                               : 0.f
-                               ;
+        *texel = float_alpha_to_uint8(layer[i]);
       }
     }
+    else
+    {
+      uint8_t const* alpha = alphamaps[alpha_id]->getAlpha();
 
+      for (int i = 0; i < 64 * 64; ++i, texel += 4)
+      {
+        *texel = alpha[i];
+      }
+    }
   }
 
-  gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, _chunk->px * 16 + _chunk->py,
-                   64, 64, 1, GL_RGB, GL_FLOAT, amap.data());
+  for (int i = 0; i < 64 * 64; ++i)
+  {
+    texels[i * 4 + 3] = 0;
+  }
 
+  return true;
 }
 
 namespace
@@ -1271,9 +1074,31 @@ uint8_t TextureSet::sum_alpha(size_t offset) const
 
 namespace
 {
-  inline std::uint8_t float_alpha_to_uint8(float a)
+  template<typename Fun>
+    void quantize_alpha_layers(tmp_edit_alpha_values const& new_amaps, int nTextures, Fun&& fun)
   {
-    return static_cast<std::uint8_t>(std::max(0.f, std::min(255.f, std::round(a))));
+    std::array<std::uint16_t, 64 * 64> totals;
+    totals.fill(0);
+
+    for (int alpha_layer = 0; alpha_layer < nTextures - 1; ++alpha_layer)
+    {
+      std::array<std::uint8_t, 64 * 64> values;
+
+      for (int i = 0; i < 64 * 64; ++i)
+      {
+        values[i] = float_alpha_to_uint8(new_amaps.map[alpha_layer + 1][i]);
+        totals[i] += values[i];
+
+        // remove the possible overflow with rounding
+        // max 2 if all 4 values round up so it won't change the layer's alpha much
+        if (totals[i] > 255)
+        {
+          values[i] -= static_cast<std::uint8_t>(totals[i] - 255);
+        }
+      }
+
+      fun(alpha_layer, values);
+    }
   }
 }
 
@@ -1285,36 +1110,51 @@ bool TextureSet::apply_alpha_changes()
     return false;
   }
 
-  auto& new_amaps = tmp_edit_values.get();
-  std::array<std::uint16_t, 64 * 64> totals;
-  totals.fill(0);
+  quantize_alpha_layers
+    ( tmp_edit_values.get(), nTextures
+    , [&] (int alpha_layer, std::array<std::uint8_t, 64 * 64>& values)
+      {
+        alphamaps[alpha_layer]->setAlpha(values.data());
+      }
+    );
 
-  for (int alpha_layer = 0; alpha_layer < nTextures - 1; ++alpha_layer)
-  {
-    std::array<std::uint8_t, 64 * 64> values;
+  _chunk->registerChunkUpdate(ChunkUpdateFlags::ALPHAMAP); 
+  _need_lod_texture_map_update = true;
 
-    for (int i = 0; i < 64 * 64; ++i)
+  tmp_edit_values = boost::none;
+
+  return true;
+}
+
+std::array<boost::optional<std::array<std::uint8_t, 64 * 64>>, 3> TextureSet::applied_alphamaps() const
+{
+  std::array<boost::optional<std::array<std::uint8_t, 64 * 64>>, 3> result;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    if (alphamaps[i])
     {
-      values[i] = float_alpha_to_uint8(new_amaps[alpha_layer + 1][i]);
-      totals[i] += values[i];
+      auto& values = result[i].emplace();
 
-      // remove the possible overflow with rounding
-      // max 2 if all 4 values round up so it won't change the layer's alpha much
-      if (totals[i] > 255)
+      for (int j = 0; j < 64 * 64; ++j)
       {
-        values[i] -= static_cast<std::uint8_t>(totals[i] - 255);
+        values[j] = alphamaps[i]->getAlpha(j);
       }
     }
-
-    alphamaps[alpha_layer]->setAlpha(values.data());
   }
 
-  _chunk->registerChunkUpdate(ChunkUpdateFlags::ALPHAMAP); 
-  _need_lod_texture_map_update = true;
-
-  tmp_edit_values = boost::none;
+  if (tmp_edit_values && nTextures >= 2)
+  {
+    quantize_alpha_layers
+      ( tmp_edit_values.get(), nTextures
+      , [&] (int alpha_layer, std::array<std::uint8_t, 64 * 64> const& values)
+        {
+          result[alpha_layer] = values;
+        }
+      );
+  }
 
-  return true;
+  return result;
 }
 
 void TextureSet::create_temporary_alphamaps_if_needed()
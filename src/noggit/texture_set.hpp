@@ -6,6 +6,7 @@
 #include <noggit/alphamap.hpp>
 #include <noggit/MapHeaders.h>
 #include <noggit/ContextObject.hpp>
+#include <noggit/texture_painting.hpp>
 
 #include <cstdint>
 #include <array>
@@ -14,18 +15,6 @@ class Brush;
 class MapTile;
 class MapChunk;
 
-struct tmp_edit_alpha_values
-{
-  using alpha_layer = std::array<float, 64 * 64>;
-  // use 4 "alphamaps" for an easier editing
-  std::array<alpha_layer, 4> map;
-
-  alpha_layer& operator[](std::size_t i)
-  {
-    return map.at(i);
-  }
-};
-
 class TextureSet
 {
 public:
@@ -63,6 +52,8 @@ public:
 
   std::vector<std::vector<uint8_t>> save_alpha(bool big_alphamap);
 
+  std::size_t memory_usage() const;
+
   void convertToBigAlpha();
   void convertToOldAlpha();
 
@@ -73,10 +64,15 @@ public:
 
   int texture_id(scoped_blp_texture_reference const& texture);
 
-  void uploadAlphamapData();
+  //! writes the alpha layers as 64x64 RGBA8 texels, the 4th channel unused.
+  //! returns false if they have not changed since the last upload
+  bool writeAlphamapTexels(std::uint8_t* texels);
 
   bool apply_alpha_changes();
 
+  //! the alpha layers as apply_alpha_changes() would leave them
+  std::array<boost::optional<std::array<std::uint8_t, 64 * 64>>, 3> applied_alphamaps() const;
+
   void create_temporary_alphamaps_if_needed();
 
   void markDirty();
@@ -0,0 +1,258 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/thumbnail_cache.hpp>
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+#include <noggit/ModelHeaders.h>
+
+#include <QtCore/QBuffer>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSettings>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace noggit
+{
+  namespace thumbnail_cache
+  {
+    namespace
+    {
+      // bump when the way previews are rendered changes
+      constexpr int version = 3;
+
+      // the client does not load more groups, a corrupt count is not
+      // trusted beyond that either
+      constexpr std::uint32_t max_wmo_groups = 512;
+
+      QString path (QString const& key, QString const& extension)
+      {
+        QSettings settings;
+        return QDir (settings.value ("project/path").toString())
+          .filePath ("noggit_cache/thumbnails/" + key + extension);
+      }
+
+      bool has_dependencies (std::string const& name)
+      {
+        return boost::algorithm::ends_with (name, ".m2")
+          || boost::algorithm::ends_with (name, ".wmo");
+      }
+
+      //! skin and textures of a model, groups and textures of a wmo: the
+      //! other files its preview is rendered from
+      std::vector<std::string> dependencies (std::string const& filename, MPQFile const& file)
+      {
+        std::vector<std::string> files;
+
+        std::string const name (mpq::normalized_filename (filename));
+        char const* data (file.getBuffer());
+        std::size_t const size (file.getSize());
+
+        if (boost::algorithm::ends_with (name, ".m2") && size >= sizeof (ModelHeader))
+        {
+          ModelHeader header;
+          std::memcpy (&header, data, sizeof (ModelHeader));
+
+          if (header.nViews > 0)
+          {
+            files.emplace_back (name.substr (0, name.length() - 3) + "00.skin");
+          }
+
+          if (header.ofsTextures + std::uint64_t (header.nTextures) * sizeof (ModelTextureDef) <= size)
+          {
+            for (std::uint32_t i (0); i < header.nTextures; ++i)
+            {
+              ModelTextureDef texdef;
+              std::memcpy (&texdef, data + header.ofsTextures + i * sizeof (ModelTextureDef), sizeof (ModelTextureDef));
+
+              if (texdef.type == 0 && texdef.nameLen > 0 && texdef.nameOfs + std::uint64_t (texdef.nameLen) <= size)
+              {
+                files.emplace_back (std::string (data + texdef.nameOfs, strnlen (data + texdef.nameOfs, texdef.nameLen)));
+              }
+            }
+          }
+        }
+        else if (boost::algorithm::ends_with (name, ".wmo"))
+        {
+          // walk the root's chunks, only MOHD and MOTX matter
+          for (std::size_t pos (0); pos + 8 <= size;)
+          {
+            std::uint32_t fourcc, chunk_size;
+            std::memcpy (&fourcc, data + pos, 4);
+            std::memcpy (&chunk_size, data + pos + 4, 4);
+            pos += 8;
+
+            if (pos + chunk_size > size)
+            {
+              break;
+            }
+
+            if (fourcc == 'MOHD' && chunk_size >= 8)
+            {
+              std::uint32_t groups;
+              std::memcpy (&groups, data + pos + 4, 4);
+
+              for (std::uint32_t i (0); i < std::min (groups, max_wmo_groups); ++i)
+              {
+                std::stringstream group;
+                group << name.substr (0, name.length() - 4)
+                      << "_" << std::setw (3) << std::setfill ('0') << i << ".wmo";
+                files.emplace_back (group.str());
+
+                // groups are numbered without gaps, the missing one is kept
+                // so adding it misses
+                if (!MPQFile::exists (files.back()))
+                {
+                  break;
+                }
+              }
+            }
+            else if (fourcc == 'MOTX')
+            {
+              for (std::size_t ofs (0); ofs < chunk_size;)
+              {
+                std::size_t const length (strnlen (data + pos + ofs, chunk_size - ofs));
+                if (length)
+                {
+                  files.emplace_back (data + pos + ofs, length);
+                }
+                ofs += length + 1;
+              }
+            }
+
+            pos += chunk_size;
+          }
+        }
+
+        return files;
+      }
+
+      QByteArray file_version (std::string const& filename)
+      {
+        return QByteArray::fromStdString (MPQFile::version (filename).value_or ("missing"));
+      }
+
+      //! one line with the name and one with the version per dependency
+      QByteArray dependency_versions (std::string const& filename)
+      {
+        QByteArray versions;
+
+        if (!has_dependencies (mpq::normalized_filename (filename)))
+        {
+          return versions;
+        }
+
+        try
+        {
+          MPQFile const file (filename);
+
+          for (auto const& dependency : dependencies (filename, file))
+          {
+            versions += QByteArray::fromStdString (mpq::normalized_filename (dependency)) + '\n';
+            versions += file_version (dependency) + '\n';
+          }
+        }
+        catch (std::invalid_argument const&)
+        {
+          // removed since the key was made, the entry misses next time
+          versions += QByteArray::fromStdString (mpq::normalized_filename (filename)) + "\nmissing\n";
+        }
+
+        return versions;
+      }
+
+      bool dependencies_unchanged (QString const& filename)
+      {
+        QFile file (filename);
+
+        if (!file.open (QIODevice::ReadOnly))
+        {
+          return false;
+        }
+
+        QList<QByteArray> const lines (file.readAll().split ('\n'));
+
+        // the content ends with a line break, leaving an empty last line
+        for (int i (0); i + 1 < lines.size(); i += 2)
+        {
+          if (file_version (lines[i].toStdString()) != lines[i + 1])
+          {
+            return false;
+          }
+        }
+
+        return true;
+      }
+
+      bool write (QString const& filename, QByteArray const& data)
+      {
+        QSaveFile file (filename);
+        return file.open (QIODevice::WriteOnly) && file.write (data) == data.size() && file.commit();
+      }
+    }
+
+    boost::optional<entry> key (std::string const& filename, QString const& settings)
+    {
+      auto const file_version (MPQFile::version (filename));
+
+      if (!file_version)
+      {
+        return boost::none;
+      }
+
+      QCryptographicHash hash (QCryptographicHash::Sha1);
+      hash.addData (QByteArray::number (version));
+      hash.addData (QByteArray::fromStdString (mpq::normalized_filename (filename)));
+      hash.addData (QByteArray::fromStdString (*file_version));
+      hash.addData (settings.toUtf8());
+
+      return entry {filename, QString::fromLatin1 (hash.result().toHex())};
+    }
+
+    boost::optional<QPixmap> load (entry const& thumbnail)
+    {
+      QPixmap pixmap;
+      QString const filename (path (thumbnail.key, ".png"));
+
+      // a retextured model or an edited group changes the preview as well
+      if ( !QFile::exists (filename)
+        || !dependencies_unchanged (path (thumbnail.key, ".dependencies"))
+        || !pixmap.load (filename, "PNG")
+         )
+      {
+        return boost::none;
+      }
+
+      return pixmap;
+    }
+
+    void store (entry const& thumbnail, QPixmap const& pixmap)
+    {
+      QString const filename (path (thumbnail.key, ".png"));
+      QDir().mkpath (QFileInfo (filename).absolutePath());
+
+      QByteArray png;
+      QBuffer buffer (&png);
+
+      // written aside and renamed, a half written entry is never read. the
+      // dependencies go first, a preview is never read without them
+      if ( !buffer.open (QIODevice::WriteOnly) || !pixmap.save (&buffer, "PNG")
+        || !write (path (thumbnail.key, ".dependencies"), dependency_versions (thumbnail.filename))
+        || !write (filename, png)
+         )
+      {
+        LogError << "Could not write the thumbnail " << filename.toStdString() << std::endl;
+      }
+    }
+  }
+}
@@ -0,0 +1,38 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include <QtCore/QString>
+#include <QtGui/QPixmap>
+
+#include <string>
+
+namespace noggit
+{
+  //! previews rendered from game files, kept as png files in the project
+  //! directory across sessions. entries are named after a hash of the path,
+  //! the version of the file (see MPQFile::version) and the render
+  //! settings. the versions of the files it is rendered with (skins,
+  //! textures, wmo groups) are stored next to the preview and compared
+  //! when loading, so editing any of them or changing the settings just
+  //! misses, stale entries are never read. nothing is read from the
+  //! archives unless the entry misses.
+  namespace thumbnail_cache
+  {
+    struct entry
+    {
+      std::string filename;
+      QString key;
+    };
+
+    //! the entry of the current version of the file, none if it does not
+    //! exist.
+    //! settings: anything else the preview depends on, e.g. its size
+    boost::optional<entry> key (std::string const& filename, QString const& settings);
+
+    boost::optional<QPixmap> load (entry const& thumbnail);
+    void store (entry const& thumbnail, QPixmap const& pixmap);
+  }
+}
@@ -2,6 +2,8 @@
 
 #include <noggit/ui/SettingsPanel.h>
 #include <noggit/Log.h>
+#include <noggit/ActionManager.hpp>
+#include <noggit/MPQ.h>
 
 #include <noggit/TextureManager.h>
 #include <util/qt/overload.hpp>
@@ -216,13 +218,15 @@ namespace noggit
       ui->_vsync_cb->setChecked(_settings->value("vsync", false).toBool());
       ui->_anti_aliasing_cb->setChecked(_settings->value("anti_aliasing", false).toBool());
       ui->_fullscreen_cb->setChecked(_settings->value("fullscreen", false).toBool());
-      ui->_adt_unload_dist->setValue(_settings->value("unload_dist", 5).toInt());
+      ui->_adt_unload_memory_budget->setValue(_settings->value("unload_memory_budget", 2048).toInt());
       ui->_adt_unload_check_interval->setValue(_settings->value("unload_interval", 5).toInt());
+      ui->_undo_memory_budget->setValue(_settings->value("undo_memory_budget_mb", 512).toInt());
       ui->_uid_cb->setChecked(_settings->value("uid_startup_check", true).toBool());
       ui->_systemWindowFrame->setChecked(_settings->value("systemWindowFrame", true).toBool());
       ui->_nativeMenubar->setChecked(_settings->value("nativeMenubar", true).toBool());
       ui->_additional_file_loading_log->setChecked(
           _settings->value("additional_file_loading_log", false).toBool());
+      ui->_async_loader_threads->setValue(_settings->value("async_loader_threads", 0).toInt());
       ui->_theme->setCurrentText(_settings->value("theme", "Dark").toString());
 
       ui->assetBrowserBgCol->setColor(_settings->value("assetBrowser/background_color",
@@ -268,6 +272,7 @@ namespace noggit
     {
       _settings->setValue("project/game_path", ui->gamePathField->text());
       _settings->setValue("project/path", ui->projectPathField->text());
+      MPQFile::reload_project_files();
       _settings->setValue("project/import_file", ui->importPathField->text());
       _settings->setValue("project/wmv_log_file", ui->wmvLogPathField->text());
       _settings->setValue("farZ", ui->farZField->value());
@@ -278,10 +283,14 @@ namespace noggit
       _settings->setValue("vsync", ui->_vsync_cb->isChecked());
       _settings->setValue("anti_aliasing", ui->_anti_aliasing_cb->isChecked());
       _settings->setValue("fullscreen", ui->_fullscreen_cb->isChecked());
-      _settings->setValue("unload_dist", ui->_adt_unload_dist->value());
+      _settings->setValue("unload_memory_budget", ui->_adt_unload_memory_budget->value());
       _settings->setValue("unload_interval", ui->_adt_unload_check_interval->value());
+      _settings->setValue("undo_memory_budget_mb", ui->_undo_memory_budget->value());
+      noggit::ActionManager::instance()->setMemoryBudget
+        (static_cast<std::size_t> (ui->_undo_memory_budget->value()) * 1024 * 1024);
       _settings->setValue("uid_startup_check", ui->_uid_cb->isChecked());
       _settings->setValue("additional_file_loading_log", ui->_additional_file_loading_log->isChecked());
+      _settings->setValue("async_loader_threads", ui->_async_loader_threads->value());
       _settings->setValue("systemWindowFrame", ui->_systemWindowFrame->isChecked());
       _settings->setValue("nativeMenubar", ui->_nativeMenubar->isChecked());
 
@@ -6,8 +6,30 @@
 #include <noggit/ActionManager.hpp>
 #include <noggit/Action.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace noggit
 {
+  namespace
+  {
+    constexpr float grid_cell_size = TILESIZE / 8.f;
+    constexpr int grid_size = 64 * 8;
+    // larger instances are tested for every ray instead
+    constexpr int grid_max_cells_per_instance = 64;
+
+    int grid_cell (float pos)
+    {
+      return static_cast<int> (std::floor (pos / grid_cell_size));
+    }
+
+    std::uint32_t grid_cell_key (int x, int z)
+    {
+      return static_cast<std::uint32_t> (z * grid_size + x);
+    }
+  }
+
   world_model_instances_storage::world_model_instances_storage(World* world)
     : _world(world)
   {
@@ -49,7 +71,7 @@ namespace noggit
     {
       if (noggit::ActionManager::instance()->getCurrentAction())
         noggit::ActionManager::instance()->getCurrentAction()->registerObjectAdded(&instance);
-      _m2s.emplace(uid, instance);
+      unsafe_grid_add(&_m2s.emplace(uid, instance).first->second);
       _instance_count_per_uid[uid] = 1;
       return uid;
     }
@@ -98,7 +120,7 @@ namespace noggit
     {
       if (noggit::ActionManager::instance()->getCurrentAction())
         noggit::ActionManager::instance()->getCurrentAction()->registerObjectAdded(&instance);
-      _wmos.emplace(uid, instance);
+      unsafe_grid_add(&_wmos.emplace(uid, instance).first->second);
       _instance_count_per_uid[uid] = 1;
       return uid;
     }
@@ -121,6 +143,7 @@ namespace noggit
         if (noggit::ActionManager::instance()->getCurrentAction())
           noggit::ActionManager::instance()->getCurrentAction()->registerObjectRemoved(&it->second);
         _world->updateTilesModel(&it->second, model_update::remove);
+        unsafe_grid_remove(&it->second);
         _instance_count_per_uid.erase(it->first);
         it = _m2s.erase(it);
       }
@@ -136,6 +159,7 @@ namespace noggit
         if (noggit::ActionManager::instance()->getCurrentAction())
           noggit::ActionManager::instance()->getCurrentAction()->registerObjectRemoved(&it->second);
         _world->updateTilesWMO(&it->second, model_update::remove);
+        unsafe_grid_remove(&it->second);
         _instance_count_per_uid.erase(it->first);
         it = _wmos.erase(it);
       }
@@ -165,6 +189,7 @@ namespace noggit
         auto instance = static_cast<ModelInstance*>(obj);
         
         _world->updateTilesModel(instance, model_update::remove);
+        unsafe_grid_remove(instance);
 
         _instance_count_per_uid.erase(instance->uid);
         _m2s.erase(instance->uid);
@@ -174,6 +199,7 @@ namespace noggit
         auto instance = static_cast<WMOInstance*>(obj);
 
         _world->updateTilesWMO(instance, model_update::remove);
+        unsafe_grid_remove(instance);
 
         _instance_count_per_uid.erase(instance->uid);
         _wmos.erase(instance->uid);
@@ -195,6 +221,7 @@ namespace noggit
       }
     }
 
+    unsafe_grid_remove(uid);
     _instance_count_per_uid.erase(uid);
     _m2s.erase(uid);
     _wmos.erase(uid);
@@ -214,6 +241,7 @@ namespace noggit
     {
       _world->remove_from_selection(uid);
 
+      unsafe_grid_remove(uid);
       _instance_count_per_uid.erase(uid);
       _m2s.erase(uid);
       _wmos.erase(uid);
@@ -224,6 +252,17 @@ namespace noggit
   {
     std::unique_lock<std::mutex> const lock (_mutex);
 
+    {
+      std::lock_guard<std::mutex> const grid_lock (_grid_mutex);
+
+      _grid_records.clear();
+      _grid_cells.clear();
+      _grid_oversized.clear();
+      _grid_pending.clear();
+    }
+
+    _world->render_lists().clear();
+
     _instance_count_per_uid.clear();
     _m2s.clear();
     _wmos.clear();
@@ -312,6 +351,7 @@ namespace noggit
         if (lhs->second.isDuplicateOf(rhs->second))
         {
           _world->updateTilesWMO(&rhs->second, model_update::remove);
+          unsafe_grid_remove(&rhs->second);
 
           _instance_count_per_uid.erase(rhs->second.uid);
           if (noggit::ActionManager::instance()->getCurrentAction())
@@ -335,6 +375,7 @@ namespace noggit
         if (lhs->second.isDuplicateOf(rhs->second))
         {
           _world->updateTilesModel(&rhs->second, model_update::remove);
+          unsafe_grid_remove(&rhs->second);
 
           _instance_count_per_uid.erase(rhs->second.uid);
 
@@ -353,6 +394,291 @@ namespace noggit
     Log << "Deleted " << deleted_uids << " duplicate Model/WMO" << std::endl;
   }
 
+  void world_model_instances_storage::unsafe_grid_add(SceneObject* instance)
+  {
+    std::lock_guard<std::mutex> const lock (_grid_mutex);
+    _grid_pending.emplace(instance);
+  }
+
+  void world_model_instances_storage::unsafe_grid_remove(SceneObject* instance)
+  {
+    // every removal of an instance goes through here
+    _world->render_lists().remove(instance);
+
+    std::lock_guard<std::mutex> const lock (_grid_mutex);
+
+    grid_erase(instance);
+    _grid_pending.erase(instance);
+  }
+
+  void world_model_instances_storage::unsafe_grid_remove(std::uint32_t uid)
+  {
+    if (auto instance = unsafe_get_model_instance(uid))
+    {
+      unsafe_grid_remove(instance.get());
+    }
+    if (auto instance = unsafe_get_wmo_instance(uid))
+    {
+      unsafe_grid_remove(instance.get());
+    }
+  }
+
+  void world_model_instances_storage::update_instance_bounds(SceneObject* instance)
+  {
+    std::lock_guard<std::mutex> const lock (_grid_mutex);
+
+    // instances not stored (yet) are ignored, pending ones stay pending
+    if (_grid_records.find(instance) != _grid_records.end())
+    {
+      grid_erase(instance);
+      _grid_pending.emplace(instance);
+    }
+  }
+
+  void world_model_instances_storage::grid_insert(SceneObject* instance)
+  {
+    grid_record& record (_grid_records[instance]);
+
+    record.instance = instance;
+    record.extents = instance->extents;
+    record.min_x = grid_cell(record.extents[0].x);
+    record.min_z = grid_cell(record.extents[0].z);
+    record.max_x = grid_cell(record.extents[1].x);
+    record.max_z = grid_cell(record.extents[1].z);
+    record.oversized = record.min_x < 0 || record.min_z < 0
+                    || record.max_x >= grid_size || record.max_z >= grid_size
+                    || (record.max_x - record.min_x + 1) * (record.max_z - record.min_z + 1) > grid_max_cells_per_instance;
+
+    if (record.oversized)
+    {
+      _grid_oversized.emplace(&record);
+      return;
+    }
+
+    for (int z = record.min_z; z <= record.max_z; ++z)
+    {
+      for (int x = record.min_x; x <= record.max_x; ++x)
+      {
+        _grid_cells[grid_cell_key(x, z)].push_back(&record);
+      }
+    }
+  }
+
+  void world_model_instances_storage::grid_erase(SceneObject* instance)
+  {
+    auto const it (_grid_records.find(instance));
+
+    if (it == _grid_records.end())
+    {
+      return;
+    }
+
+    grid_record* record = &it->second;
+
+    if (record->oversized)
+    {
+      _grid_oversized.erase(record);
+    }
+    else
+    {
+      for (int z = record->min_z; z <= record->max_z; ++z)
+      {
+        for (int x = record->min_x; x <= record->max_x; ++x)
+        {
+          auto const cell_it (_grid_cells.find(grid_cell_key(x, z)));
+          auto& cell (cell_it->second);
+
+          *std::find(cell.begin(), cell.end(), record) = cell.back();
+          cell.pop_back();
+
+          if (cell.empty())
+          {
+            _grid_cells.erase(cell_it);
+          }
+        }
+      }
+    }
+
+    _grid_records.erase(it);
+  }
+
+  void world_model_instances_storage::intersect
+    ( math::ray const& ray
+    , selection_result* results
+    , std::function<void (SceneObject&)> const& intersect_instance
+    )
+  {
+    std::unique_lock<std::mutex> const lock (_mutex);
+    std::unique_lock<std::mutex> const grid_lock (_grid_mutex);
+
+    if (++_grid_stamp == 0)
+    {
+      for (auto& record : _grid_records)
+      {
+        record.second.stamp = 0;
+      }
+      _grid_stamp = 1;
+    }
+
+    float nearest = std::numeric_limits<float>::max();
+
+    for (auto const& result : *results)
+    {
+      nearest = std::min(nearest, result.first);
+    }
+
+    auto const test
+    ( [&] (SceneObject& instance)
+      {
+        std::size_t const first_new_result = results->size();
+
+        intersect_instance(instance);
+
+        for (std::size_t i = first_new_result; i < results->size(); ++i)
+        {
+          nearest = std::min(nearest, (*results)[i].first);
+        }
+      }
+    );
+
+    // move the instances whose model finished loading to the grid, the
+    // others are tested for every ray until then
+    for (auto it = _grid_pending.begin(); it != _grid_pending.end();)
+    {
+      SceneObject* instance = *it;
+
+      if (instance->finishedLoading())
+      {
+        // the wmo extents are stored in the adt, the m2 ones need the model
+        if (instance->which() == eMODEL)
+        {
+          instance->ensureExtents();
+        }
+
+        grid_insert(instance);
+        it = _grid_pending.erase(it);
+      }
+      else
+      {
+        test(*instance);
+        ++it;
+      }
+    }
+
+    for (grid_record* record : _grid_oversized)
+    {
+      record->stamp = _grid_stamp;
+      test(*record->instance);
+    }
+
+    // walk the cells crossed by the ray front to back, clipped to the grid
+    glm::vec3 const& origin = ray.origin();
+    glm::vec3 const& direction = ray.direction();
+    float const grid_end = grid_size * grid_cell_size;
+
+    float t_start = 0.f;
+    float t_end = std::numeric_limits<float>::max();
+
+    for (int axis : {0, 2})
+    {
+      if (direction[axis] != 0.f)
+      {
+        float const t0 ((0.f - origin[axis]) / direction[axis]);
+        float const t1 ((grid_end - origin[axis]) / direction[axis]);
+
+        t_start = std::max(t_start, std::min(t0, t1));
+        t_end = std::min(t_end, std::max(t0, t1));
+      }
+      else if (origin[axis] < 0.f || origin[axis] > grid_end)
+      {
+        return;
+      }
+    }
+
+    if (t_start > t_end)
+    {
+      return;
+    }
+
+    glm::vec3 const start = ray.position(t_start);
+    int x = std::clamp(grid_cell(start.x), 0, grid_size - 1);
+    int z = std::clamp(grid_cell(start.z), 0, grid_size - 1);
+
+    int const step_x = direction.x > 0.f ? 1 : -1;
+    int const step_z = direction.z > 0.f ? 1 : -1;
+
+    float const infinity = std::numeric_limits<float>::infinity();
+    float const t_delta_x = direction.x != 0.f ? grid_cell_size / std::abs(direction.x) : infinity;
+    float const t_delta_z = direction.z != 0.f ? grid_cell_size / std::abs(direction.z) : infinity;
+    float t_next_x = direction.x != 0.f ? ((x + (step_x > 0 ? 1 : 0)) * grid_cell_size - origin.x) / direction.x : infinity;
+    float t_next_z = direction.z != 0.f ? ((z + (step_z > 0 ? 1 : 0)) * grid_cell_size - origin.z) / direction.z : infinity;
+
+    float t_enter = t_start;
+    std::vector<std::pair<float, grid_record*>> candidates;
+
+    // a hit is inside the cells of its instance, once the ray enters the
+    // cells behind the nearest hit there's nothing closer left
+    while (t_enter <= nearest)
+    {
+      auto const cell (_grid_cells.find(grid_cell_key(x, z)));
+
+      if (cell != _grid_cells.end())
+      {
+        candidates.clear();
+
+        for (grid_record* record : cell->second)
+        {
+          if (record->stamp == _grid_stamp)
+          {
+            continue;
+          }
+
+          record->stamp = _grid_stamp;
+
+          if (auto const distance = ray.intersect_bounds(record->extents[0], record->extents[1]))
+          {
+            candidates.emplace_back(distance.get(), record);
+          }
+        }
+
+        std::sort ( candidates.begin(), candidates.end()
+                  , [] (auto const& lhs, auto const& rhs)
+                    {
+                      return lhs.first < rhs.first;
+                    }
+                  );
+
+        for (auto const& candidate : candidates)
+        {
+          if (candidate.first > nearest)
+          {
+            break;
+          }
+
+          test(*candidate.second->instance);
+        }
+      }
+
+      if (t_next_x < t_next_z)
+      {
+        t_enter = t_next_x;
+        t_next_x += t_delta_x;
+        x += step_x;
+      }
+      else
+      {
+        t_enter = t_next_z;
+        t_next_z += t_delta_z;
+        z += step_z;
+      }
+
+      if (t_enter > t_end || x < 0 || z < 0 || x >= grid_size || z >= grid_size)
+      {
+        break;
+      }
+    }
+  }
+
   void world_model_instances_storage::upload()
   {
     if (_transform_storage_uploaded)
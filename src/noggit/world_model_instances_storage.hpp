@@ -6,12 +6,15 @@
 #include <noggit/Selection.h>
 #include <noggit/tile_index.hpp>
 #include <noggit/WMOInstance.h>
+#include <math/ray.hpp>
 #include <opengl/scoped.hpp>
 
+#include <array>
 #include <atomic>
 #include <functional>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class World;
@@ -58,6 +61,18 @@ namespace noggit
     void upload();
     void unload();
 
+    //! to call whenever an instance is moved, rotated or scaled
+    void update_instance_bounds(SceneObject* instance);
+
+    //! calls intersect_instance for the instances whose bounds are crossed by
+    //! the ray, nearest first, until the next ones are farther than the
+    //! nearest hit in results. the callback adds its hits to results.
+    void intersect
+      ( math::ray const& ray
+      , selection_result* results
+      , std::function<void (SceneObject&)> const& intersect_instance
+      );
+
   private: // private functions aren't thread safe
     inline bool unsafe_uid_is_used(std::uint32_t uid) const;
 
@@ -66,6 +81,12 @@ namespace noggit
     boost::optional<ModelInstance*> unsafe_get_model_instance(std::uint32_t uid);
     boost::optional<WMOInstance*> unsafe_get_wmo_instance(std::uint32_t uid);
 
+    // the grid has its own mutex as the world notifies the bound changes
+    // while _mutex is held by some of the functions above
+    void unsafe_grid_add(SceneObject* instance);
+    void unsafe_grid_remove(SceneObject* instance);
+    void unsafe_grid_remove(std::uint32_t uid);
+
   public:
     template<typename Fun>
       void for_each_wmo_instance(Fun&& function)
@@ -121,5 +142,29 @@ namespace noggit
     bool _transform_storage_uploaded = false;
 
     std::unordered_map<std::uint32_t, int> _instance_count_per_uid;
+
+    //! uniform grid of the instance bounding boxes in x/z used for picking
+    struct grid_record
+    {
+      SceneObject* instance;
+      std::array<glm::vec3, 2> extents;
+      int min_x, min_z, max_x, max_z;
+      //! not in _grid_cells but in _grid_oversized
+      bool oversized;
+      //! last intersect() that tested it, instances can span several cells
+      std::uint32_t stamp = 0;
+    };
+
+    void grid_insert(SceneObject* instance);
+    void grid_erase(SceneObject* instance);
+
+    std::mutex _grid_mutex;
+    std::unordered_map<SceneObject*, grid_record> _grid_records;
+    std::unordered_map<std::uint32_t, std::vector<grid_record*>> _grid_cells;
+    //! too large to be worth putting in every cell they cover
+    std::unordered_set<grid_record*> _grid_oversized;
+    //! not in the grid until their model is loaded and their extents known
+    std::unordered_set<SceneObject*> _grid_pending;
+    std::uint32_t _grid_stamp = 0;
   };
 }
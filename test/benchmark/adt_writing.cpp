@@ -0,0 +1,106 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// saves a tile through MapTile::saveTile, the way the editor writes adts:
+// MapChunk::prepare_save and save_size compute the size of the file, then
+// MapChunk::save writes every chunk into the buffer allocated once. the
+// tile is created empty and saved as the editor creates new tiles, then
+// loaded back and given textures, so every chunk writes layers and alpha
+// maps. the time includes writing the file to a temporary project
+// directory. the textures don't exist, saving only needs their names.
+//
+// usage: adt_writing.benchmark [textures per chunk = 4] [repetitions = 20]
+
+#include "benchmark.hpp"
+
+#include <noggit/MPQ.h>
+#include <noggit/MapChunk.h>
+#include <noggit/MapTile.h>
+#include <noggit/TextureManager.h>
+#include <noggit/World.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QSettings>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+int main (int argc, char** argv)
+{
+  std::size_t const textures (std::min<std::size_t> (noggit::benchmark::argument (argc, argv, 1, 4), 4));
+  std::size_t const repetitions (noggit::benchmark::argument (argc, argv, 2, 20));
+
+  // settings of its own, the editor's project path is left alone
+  QCoreApplication application (argc, argv);
+  application.setOrganizationName ("Noggit");
+  application.setApplicationName ("adt_writing.benchmark");
+
+  boost::filesystem::path const project
+    (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+  boost::filesystem::create_directories (project);
+
+  QSettings settings;
+  settings.setValue ("project/path", QString::fromStdString (project.string() + "/"));
+  MPQFile::reload_project_files();
+
+  auto const context (noggit::NoggitRenderContext::MAP_VIEW);
+  World world ("benchmark", 0, context, true);
+  tile_index const index (32, 32);
+
+  // as MapIndex::saveChanged does for a new tile, the file has to exist
+  world.mapIndex.addTile (index);
+  MapTile* const empty_tile (world.mapIndex.getTile (index));
+  std::string const filename (empty_tile->filename);
+  boost::filesystem::path const path (project / noggit::mpq::normalized_filename (filename));
+
+  boost::filesystem::create_directories (path.parent_path());
+  std::ofstream (path.string());
+  MPQFile::project_file_created (filename);
+
+  empty_tile->initEmptyChunks();
+  if (!empty_tile->saveTile (&world))
+  {
+    std::printf ("the empty tile could not be saved\n");
+    return 1;
+  }
+
+  MapTile tile (index.x, index.z, filename, true, false, false, false, &world, context);
+  tile.finishLoading();
+
+  for (unsigned z (0); z < 16; ++z)
+  {
+    for (unsigned x (0); x < 16; ++x)
+    {
+      for (std::size_t layer (0); layer < textures; ++layer)
+      {
+        tile.getChunk (x, z)->addTexture
+          (scoped_blp_texture_reference ("tileset/benchmark/layer_" + std::to_string (layer) + ".blp", context));
+      }
+    }
+  }
+
+  bool saved (true);
+  double const time (noggit::benchmark::median_milliseconds (repetitions, [&]
+  {
+    saved = tile.saveTile (&world) && saved;
+  }));
+
+  std::printf ( "%zu textures per chunk, %ju bytes per tile\n"
+              , textures, static_cast<std::uintmax_t> (boost::filesystem::file_size (path))
+              );
+  noggit::benchmark::report ("MapTile::saveTile", time, time);
+
+  boost::system::error_code error;
+  boost::filesystem::remove_all (project, error);
+
+  if (!saved)
+  {
+    std::printf ("the tile could not be saved\n");
+    return 1;
+  }
+}
@@ -0,0 +1,130 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// looks up the keys of generated animation tracks at the times a model
+// playing at 60 fps evaluates them, once with the linear scan M2Value
+// used before, once through Animation::find_key. a second run jumps to
+// random times, the case the cursor does not help with.
+//
+// usage: animation_keys.benchmark [keys per track = 32] [tracks = 2000]
+
+#include "benchmark.hpp"
+
+#include <noggit/animation_keys.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  // the lookup getValue did before
+  std::size_t linear_key (std::uint32_t const* times, std::size_t count, std::uint32_t time)
+  {
+    for (std::size_t i (0); i + 1 < count; ++i)
+    {
+      if (time >= times[i] && time < times[i + 1])
+      {
+        return i;
+      }
+    }
+    return 0;
+  }
+}
+
+int main (int argc, char** argv)
+{
+  std::size_t const keys (noggit::benchmark::argument (argc, argv, 1, 32));
+  std::size_t const track_count (noggit::benchmark::argument (argc, argv, 2, 2000));
+
+  // tracks of increasing timestamps a few dozen ms apart, as exported
+  // animations have them, some of them repeated
+  std::mt19937 engine (42);
+  std::uniform_int_distribution<std::uint32_t> step (0, 100);
+  std::vector<std::vector<std::uint32_t>> tracks (track_count);
+  for (auto& track : tracks)
+  {
+    std::uint32_t time (0);
+    for (std::size_t i (0); i < keys; ++i)
+    {
+      track.emplace_back (time);
+      time += step (engine);
+    }
+  }
+
+  std::uint32_t const length (tracks.front().back());
+
+  // two seconds of playback at 60 fps, wrapping as getValue does
+  std::vector<std::uint32_t> playback;
+  for (std::uint32_t frame (0); frame < 120; ++frame)
+  {
+    playback.emplace_back (length ? frame * 1000 / 60 % length : 0);
+  }
+
+  std::uniform_int_distribution<std::uint32_t> any_time (0, length ? length - 1 : 0);
+  std::vector<std::uint32_t> jumps;
+  for (std::size_t i (0); i < playback.size(); ++i)
+  {
+    jumps.emplace_back (any_time (engine));
+  }
+
+  std::printf ("%zu tracks of %zu keys, %zu lookups per track\n", tracks.size(), keys, playback.size());
+
+  std::pair<char const*, std::vector<std::uint32_t> const*> const runs[]
+    = {{"playback", &playback}, {"random jumps", &jumps}};
+
+  for (auto const& run : runs)
+  {
+    auto const& times (*run.second);
+
+    // same key for every lookup, cursors carried over as in playback
+    std::vector<std::uint32_t> cursors (tracks.size(), 0);
+    for (auto const& time : times)
+    {
+      for (std::size_t t (0); t < tracks.size(); ++t)
+      {
+        auto const expected (linear_key (tracks[t].data(), tracks[t].size(), time));
+        auto const found (Animation::find_key (tracks[t].data(), tracks[t].size(), time, cursors[t]));
+        if (expected != found)
+        {
+          std::printf ("mismatch: key %zu instead of %zu at time %u\n", found, expected, time);
+          return 1;
+        }
+      }
+    }
+
+    std::size_t linear_sum (0);
+    double const linear (noggit::benchmark::median_milliseconds (5, [&]
+    {
+      linear_sum = 0;
+      for (auto const& time : times)
+      {
+        for (auto const& track : tracks)
+        {
+          linear_sum += linear_key (track.data(), track.size(), time);
+        }
+      }
+    }));
+
+    std::size_t cursor_sum (0);
+    double const cursor (noggit::benchmark::median_milliseconds (5, [&]
+    {
+      cursor_sum = 0;
+      for (auto const& time : times)
+      {
+        for (std::size_t t (0); t < tracks.size(); ++t)
+        {
+          cursor_sum += Animation::find_key (tracks[t].data(), tracks[t].size(), time, cursors[t]);
+        }
+      }
+    }));
+
+    std::printf ("%s\n", run.first);
+    noggit::benchmark::report ("  linear scan", linear, linear);
+    noggit::benchmark::report ("  cursor and binary search", cursor, linear);
+
+    noggit::benchmark::keep (linear_sum + cursor_sum);
+  }
+}
@@ -0,0 +1,59 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace noggit
+{
+  namespace benchmark
+  {
+    //! runs the function `repetitions` times after one warmup run and
+    //! returns the median wall clock time in milliseconds
+    template<typename Function>
+      double median_milliseconds (std::size_t repetitions, Function&& function)
+    {
+      function();
+
+      std::vector<double> times;
+      for (std::size_t i (0); i < repetitions; ++i)
+      {
+        auto const start (std::chrono::steady_clock::now());
+        function();
+        times.emplace_back ( std::chrono::duration<double, std::milli>
+                               (std::chrono::steady_clock::now() - start).count()
+                           );
+      }
+
+      std::nth_element (times.begin(), times.begin() + times.size() / 2, times.end());
+      return times[times.size() / 2];
+    }
+
+    //! the n-th command line argument as number, `fallback` if absent
+    inline std::size_t argument (int argc, char** argv, int n, std::size_t fallback)
+    {
+      return argc > n ? std::strtoull (argv[n], nullptr, 10) : fallback;
+    }
+
+    inline void report (std::string const& name, double milliseconds, double baseline)
+    {
+      std::printf ( "%-40s %10.3f ms %8.2fx\n"
+                  , name.c_str(), milliseconds, baseline / milliseconds
+                  );
+    }
+
+    //! keeps the compiler from optimizing away a result
+    template<typename T>
+      void keep (T const& value)
+    {
+      [[maybe_unused]] static T volatile sink;
+      sink = value;
+    }
+  }
+}
@@ -0,0 +1,144 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// culls a generated scene of model and wmo instances from several cameras,
+// testing them one at a time as World::draw did before, then through
+// noggit::instance_culling. both have to agree on every instance.
+//
+// usage: instance_culling.benchmark [instances = 100000]
+
+#include "benchmark.hpp"
+
+#include <math/frustum.hpp>
+#include <noggit/instance_culling.hpp>
+#include <noggit/tool_enums.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct instance
+  {
+    std::array<glm::vec3, 2> extents;
+    glm::vec3 pos;
+    bool model;
+    float radius;
+    float size_cat;
+  };
+
+  // ModelInstance::isInRenderDist
+  bool in_render_distance ( instance const& i
+                          , float cull_distance
+                          , glm::vec3 const& camera
+                          , display_mode display
+                          )
+  {
+    float const dist ( display == display_mode::in_3D
+                     ? glm::distance (camera, i.pos) - i.radius
+                     : std::abs (i.pos.y - camera.y) - i.radius
+                     );
+
+    return dist < cull_distance
+      && !(i.size_cat < 1.f && dist > 300.f)
+      && !(i.size_cat < 4.f && dist > 500.f)
+      && !(i.size_cat < 25.f && dist > 1000.f);
+  }
+}
+
+int main (int argc, char** argv)
+{
+  std::size_t const count (noggit::benchmark::argument (argc, argv, 1, 100000));
+
+  // spread over a 3x3 tiles area, a tenth of them wmos
+  std::mt19937 engine (42);
+  std::uniform_real_distribution<float> horizontal (0.f, 1600.f);
+  std::uniform_real_distribution<float> height (0.f, 100.f);
+  std::uniform_real_distribution<float> size (0.5f, 30.f);
+  std::uniform_real_distribution<float> unit (0.f, 1.f);
+
+  std::vector<instance> instances;
+  for (std::size_t n (0); n < count; ++n)
+  {
+    bool const model (unit (engine) > 0.1f);
+    glm::vec3 const pos (horizontal (engine), height (engine), horizontal (engine));
+    float const half_size (model ? size (engine) : 4.f * size (engine));
+
+    instances.push_back ( { {pos - glm::vec3 (half_size), pos + glm::vec3 (half_size)}
+                          , pos, model, half_size, half_size * half_size / 10.f
+                          }
+                        );
+  }
+
+  float const cull_distance (1000.f);
+  glm::mat4x4 const projection (glm::perspective (glm::radians (54.f), 16.f / 9.f, 1.f, cull_distance));
+
+  std::vector<std::uint8_t> reference (count);
+  noggit::instance_culling culling;
+
+  for (glm::vec3 const target : { glm::vec3 (800.f, 0.f, 800.f)
+                                , glm::vec3 (1600.f, 0.f, 0.f)
+                                , glm::vec3 (-800.f, 300.f, 800.f)
+                                }
+      )
+  {
+    glm::vec3 const camera (800.f, 150.f, 0.f);
+    math::frustum const frustum (projection * glm::lookAt (camera, target, glm::vec3 (0.f, 1.f, 0.f)));
+
+    double const one_at_a_time (noggit::benchmark::median_milliseconds (10, [&]
+    {
+      for (std::size_t n (0); n < count; ++n)
+      {
+        instance const& i (instances[n]);
+        bool const in_frustum (frustum.intersects (i.extents[1], i.extents[0]));
+
+        reference[n] = i.model
+          ? in_frustum && in_render_distance (i, cull_distance, camera, display_mode::in_3D)
+          : in_frustum;
+      }
+    }));
+
+    auto const fill ([&]
+    {
+      culling.reset();
+      for (instance const& i : instances)
+      {
+        culling.add (nullptr, i.extents, i.pos, false, i.model, i.radius, i.size_cat);
+      }
+    });
+
+    double const add (noggit::benchmark::median_milliseconds (10, fill));
+    double const compute (noggit::benchmark::median_milliseconds (10, [&]
+    {
+      culling.compute (frustum, cull_distance, camera, display_mode::in_3D);
+    }));
+
+    std::size_t visible (0);
+    std::size_t mismatches (0);
+    for (std::size_t n (0); n < count; ++n)
+    {
+      visible += culling.visible (n);
+      mismatches += culling.visible (n) != bool (reference[n]);
+    }
+
+    std::printf ("%zu of %zu instances visible\n", visible, count);
+    noggit::benchmark::report ("one at a time", one_at_a_time, one_at_a_time);
+    noggit::benchmark::report ("batched, add", add, one_at_a_time);
+    noggit::benchmark::report ("batched, compute", compute, one_at_a_time);
+    noggit::benchmark::report ("batched, add and compute", add + compute, one_at_a_time);
+
+    if (mismatches)
+    {
+      std::printf ("mismatch: %zu instances culled differently\n", mismatches);
+      return 1;
+    }
+  }
+}
@@ -0,0 +1,83 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// reads every file of a generated archive from a growing number of
+// threads. a single thread is what loading was limited to while one
+// global mutex guarded every StormLib read.
+//
+// usage: mpq_readers.benchmark [files = 512] [file size in KiB = 128]
+
+#include "benchmark.hpp"
+#include "../noggit/temporary_archives.hpp"
+
+#include <noggit/AsyncLoader.h>
+#include <noggit/MPQ.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main (int argc, char** argv)
+{
+  std::size_t const file_count (noggit::benchmark::argument (argc, argv, 1, 512));
+  std::size_t const file_size (noggit::benchmark::argument (argc, argv, 2, 128) * 1024);
+
+  noggit::test::temporary_archives archives;
+
+  // few distinct bytes, so zlib has real work to do on both ends
+  std::mt19937 engine (42);
+  std::uniform_int_distribution<int> byte ('a', 'h');
+
+  noggit::test::archive_content files;
+  for (std::size_t i (0); i < file_count; ++i)
+  {
+    std::string data (file_size, '\0');
+    for (char& c : data)
+    {
+      c = static_cast<char> (byte (engine));
+    }
+    files.emplace_back ("benchmark\\" + std::to_string (i) + ".bin", std::move (data));
+  }
+
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), archives.create ("benchmark.mpq", true, files), true);
+  noggit::test::finish_loading_concurrently();
+
+  auto const read_all ([&] (unsigned thread_count)
+  {
+    std::atomic<std::size_t> next (0);
+    std::atomic<std::uint64_t> bytes (0);
+
+    std::vector<std::thread> threads;
+    for (unsigned t (0); t < thread_count; ++t)
+    {
+      threads.emplace_back ([&]
+      {
+        for (std::size_t i (next++); i < file_count; i = next++)
+        {
+          MPQFile file (files[i].first);
+          bytes += file.getSize();
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    noggit::benchmark::keep (bytes.load());
+  });
+
+  double baseline (0.);
+  for (unsigned threads (1); threads <= std::max (1u, std::thread::hardware_concurrency()); threads *= 2)
+  {
+    double const time
+      (noggit::benchmark::median_milliseconds (5, [&] { read_all (threads); }));
+    baseline = threads == 1 ? time : baseline;
+
+    noggit::benchmark::report ("read, " + std::to_string (threads) + " threads", time, baseline);
+  }
+}
@@ -0,0 +1,284 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// paints random brush dabs on a chunk's alphamaps with a verbatim copy of
+// the loop TextureSet::paintTexture had before, which visited all 4096
+// texels and blended them one by one, and with noggit::paint_alphamaps.
+// the resulting layers have to be identical.
+//
+// usage: texture_painting.benchmark [dabs per brush size = 2000]
+
+#include "benchmark.hpp"
+
+#include <noggit/Brush.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/texture_painting.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct dab
+  {
+    float x;
+    float z;
+    float strength;
+    float pressure;
+    int layer;
+  };
+
+  namespace misc
+  {
+    using namespace ::misc;
+
+    // as in Misc.cpp, which pulls in most of noggit
+    float dist(float x1, float z1, float x2, float z2)
+    {
+      float xdiff = x2 - x1, zdiff = z2 - z1;
+      return std::sqrt(xdiff*xdiff + zdiff*zdiff);
+    }
+  }
+
+  // the loop of TextureSet::paintTexture before brush spans and lanes,
+  // from the distance check on. choosing the layer, the chunk distance
+  // early out and the cleanup afterwards are left to the caller as they
+  // are for paint_alphamaps
+  bool paint_every_texel ( tmp_edit_alpha_values& amaps
+                         , float xbase
+                         , float zbase
+                         , float x
+                         , float z
+                         , Brush* brush
+                         , float strength
+                         , float pressure
+                         , int tex_layer
+                         , int nTextures
+                         )
+  {
+    bool changed = false;
+
+    float zPos, xPos, dist, radius;
+
+    radius = brush->getRadius();
+
+    zPos = zbase;
+
+    for (int j = 0; j < 64; j++)
+    {
+      xPos = xbase;
+      for (int i = 0; i < 64; ++i)
+      {
+        dist = misc::dist(x, z, xPos + TEXDETAILSIZE / 2.0f, zPos + TEXDETAILSIZE / 2.0f);
+
+        if (dist <= radius)
+        {
+          std::size_t offset = i + 64 * j;
+          // use double for more precision
+          std::array<double,4> alpha_values;
+          double total = 0.;
+
+          for (int n = 0; n < 4; ++n)
+          {
+            total += alpha_values[n] = amaps[n][i + 64 * j];
+          }
+
+          double current_alpha = alpha_values[tex_layer];
+          double sum_other_alphas = (total - current_alpha);
+          double alpha_change = (strength - current_alpha) * pressure * brush->getValue(dist);
+
+          // alpha too low, set it to 0 directly
+          if (alpha_change < 0. && current_alpha + alpha_change < 1.)
+          {
+            alpha_change = -current_alpha;
+          }
+
+          if (!misc::float_equals(current_alpha, strength))
+          {
+            if (sum_other_alphas < 1.)
+            {
+              // alpha is currently at 254/255 -> set it at 255 and clear the rest of the values
+              if (alpha_change > 0.f)
+              {
+                for (int layer = 0; layer < nTextures; ++layer)
+                {
+                  alpha_values[layer] = layer == tex_layer ? 255. : 0.f;
+                }
+              }
+              // all the other textures amount for less an 1/255 -> add the alpha_change (negative) to current texture and remove it from the first non current texture, clear the rest
+              else
+              {
+                bool change_applied = false;
+
+                for (int layer = 0; layer < nTextures; ++layer)
+                {
+                  if (layer == tex_layer)
+                  {
+                    alpha_values[layer] += alpha_change;
+                  }
+                  else
+                  {
+                    if (!change_applied)
+                    {
+                      alpha_values[layer] -= alpha_change;
+                    }
+                    else
+                    {
+                      alpha_values[tex_layer] += alpha_values[layer];
+                      alpha_values[layer] = 0.;
+                    }
+
+                    change_applied = true;
+                  }
+                }
+              }
+            }
+            else
+            {
+              for (int layer = 0; layer < nTextures; ++layer)
+              {
+                if (layer == tex_layer)
+                {
+                  alpha_values[layer] += alpha_change;
+                }
+                else
+                {
+                  alpha_values[layer] -= alpha_change * alpha_values[layer] / sum_other_alphas;
+
+                  // clear values too low to be visible
+                  if (alpha_values[layer] < 1.)
+                  {
+                    alpha_values[tex_layer] += alpha_values[layer];
+                    alpha_values[layer] = 0.f;
+                  }
+                }
+              }
+            }
+
+            double total_final = std::accumulate(alpha_values.begin(), alpha_values.end(), 0.);
+
+            // failsafe in case the sum of all alpha values deviate
+            if (std::abs(total_final - 255.) > 0.001)
+            {
+              for (double& d : alpha_values)
+              {
+                d = d * 255. / total_final;
+              }
+            }
+
+            for (int n = 0; n < 4; ++n)
+            {
+              amaps[n][i + 64 * j] = static_cast<float>(alpha_values[n]);
+            }
+
+            changed = true;
+          }
+        }
+
+        xPos += TEXDETAILSIZE;
+      }
+      zPos += TEXDETAILSIZE;
+    }
+
+    return changed;
+  }
+}
+
+int main (int argc, char** argv)
+{
+  std::size_t const dab_count (noggit::benchmark::argument (argc, argv, 1, 2000));
+
+  std::mt19937 engine (42);
+  std::uniform_real_distribution<float> unit (0.f, 1.f);
+
+  tmp_edit_alpha_values initial;
+  for (std::size_t texel (0); texel < 64 * 64; ++texel)
+  {
+    std::array<float, 4> weights;
+    float total (0.f);
+    for (float& weight : weights)
+    {
+      total += weight = unit (engine);
+    }
+    for (std::size_t layer (0); layer < 4; ++layer)
+    {
+      initial[layer][texel] = weights[layer] * 255.f / total;
+    }
+  }
+
+  float const xbase (0.f);
+  float const zbase (0.f);
+
+  for (float const radius : {CHUNKSIZE / 8.f, CHUNKSIZE / 2.f, CHUNKSIZE * 2.f})
+  {
+    Brush brush;
+    brush.init();
+    brush.setRadius (radius);
+    brush.setHardness (0.5f);
+
+    // centers around the chunk so that the brush touches it
+    std::uniform_real_distribution<float> position (-radius, CHUNKSIZE + radius);
+    std::vector<dab> dabs;
+    for (std::size_t i (0); i < dab_count; ++i)
+    {
+      dabs.push_back ( { position (engine), position (engine), 255.f * unit (engine)
+                       , unit (engine), static_cast<int> (engine() % 4)
+                       }
+                     );
+    }
+
+    tmp_edit_alpha_values reference;
+    double const every_texel (noggit::benchmark::median_milliseconds (5, [&]
+    {
+      reference = initial;
+      for (dab const& d : dabs)
+      {
+        paint_every_texel (reference, xbase, zbase, d.x, d.z, &brush, d.strength, d.pressure, d.layer, 4);
+      }
+    }));
+
+    tmp_edit_alpha_values painted;
+    double const brush_span (noggit::benchmark::median_milliseconds (5, [&]
+    {
+      painted = initial;
+      for (dab const& d : dabs)
+      {
+        noggit::paint_alphamaps (painted, xbase, zbase, d.x, d.z, brush, d.strength, d.pressure, d.layer, 4);
+      }
+    }));
+
+    std::string const name ("radius " + std::to_string (static_cast<int> (radius)));
+    noggit::benchmark::report (name + ", every texel", every_texel, every_texel);
+    noggit::benchmark::report (name + ", brush span", brush_span, every_texel);
+
+    if (reference.map != painted.map)
+    {
+      std::printf ("mismatch: the layers painted by both kernels differ\n");
+      return 1;
+    }
+
+    // chunks with fewer textures take other ways through the blend
+    for (int const textures : {2, 3})
+    {
+      reference = initial;
+      painted = initial;
+      for (dab const& d : dabs)
+      {
+        int const layer (d.layer % textures);
+        paint_every_texel (reference, xbase, zbase, d.x, d.z, &brush, d.strength, d.pressure, layer, textures);
+        noggit::paint_alphamaps (painted, xbase, zbase, d.x, d.z, brush, d.strength, d.pressure, layer, textures);
+      }
+
+      if (reference.map != painted.map)
+      {
+        std::printf ("mismatch: the layers painted by both kernels differ with %d textures\n", textures);
+        return 1;
+      }
+    }
+  }
+}
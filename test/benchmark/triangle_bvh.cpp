@@ -0,0 +1,120 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+// picks a generated model sized mesh with random rays, testing every
+// triangle as model and wmo group intersection did before, then through
+// math::triangle_bvh.
+//
+// usage: triangle_bvh.benchmark [grid size = 128] [rays = 10000]
+
+#include "benchmark.hpp"
+
+#include <math/ray.hpp>
+#include <math/triangle_bvh.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+int main (int argc, char** argv)
+{
+  std::size_t const grid (noggit::benchmark::argument (argc, argv, 1, 128));
+  std::size_t const ray_count (noggit::benchmark::argument (argc, argv, 2, 10000));
+
+  // a bumpy heightfield of 2 * grid^2 triangles over [0, 100]^2
+  auto const vertex ([&] (std::size_t x, std::size_t z)
+  {
+    float const fx (100.f * x / grid);
+    float const fz (100.f * z / grid);
+    return glm::vec3 (fx, 5.f * std::sin (fx * 0.3f) * std::cos (fz * 0.2f), fz);
+  });
+
+  std::vector<std::array<glm::vec3, 3>> triangles;
+  for (std::size_t z (0); z < grid; ++z)
+  {
+    for (std::size_t x (0); x < grid; ++x)
+    {
+      triangles.push_back ({vertex (x, z), vertex (x + 1, z), vertex (x, z + 1)});
+      triangles.push_back ({vertex (x + 1, z), vertex (x + 1, z + 1), vertex (x, z + 1)});
+    }
+  }
+
+  // rays from above towards random points, some of them missing the mesh
+  std::mt19937 engine (42);
+  std::uniform_real_distribution<float> coordinate (-10.f, 110.f);
+  std::vector<math::ray> rays;
+  for (std::size_t i (0); i < ray_count; ++i)
+  {
+    glm::vec3 const origin (coordinate (engine), 50.f, coordinate (engine));
+    glm::vec3 const target (coordinate (engine), 0.f, coordinate (engine));
+    rays.emplace_back (origin, target - origin);
+  }
+
+  math::triangle_bvh bvh;
+  double const build_time (noggit::benchmark::median_milliseconds (5, [&]
+  {
+    bvh = {};
+    for (auto const& triangle : triangles)
+    {
+      bvh.add_triangle (triangle[0], triangle[1], triangle[2]);
+    }
+    bvh.build();
+  }));
+
+  std::printf ("%zu triangles, %zu rays, bvh built in %.3f ms\n", triangles.size(), rays.size(), build_time);
+
+  std::size_t brute_force_hits (0);
+  double const brute_force (noggit::benchmark::median_milliseconds (5, [&]
+  {
+    brute_force_hits = 0;
+    for (auto const& ray : rays)
+    {
+      for (auto const& triangle : triangles)
+      {
+        if (ray.intersect_triangle (triangle[0], triangle[1], triangle[2]))
+        {
+          ++brute_force_hits;
+        }
+      }
+    }
+  }));
+
+  std::size_t bvh_hits (0);
+  std::vector<float> results;
+  double const all_hits (noggit::benchmark::median_milliseconds (5, [&]
+  {
+    bvh_hits = 0;
+    for (auto const& ray : rays)
+    {
+      results.clear();
+      bvh.intersect (ray, &results);
+      bvh_hits += results.size();
+    }
+  }));
+
+  float nearest_sum (0.f);
+  double const nearest (noggit::benchmark::median_milliseconds (5, [&]
+  {
+    nearest_sum = 0.f;
+    for (auto const& ray : rays)
+    {
+      nearest_sum += bvh.intersect_nearest (ray).get_value_or (0.f);
+    }
+  }));
+  noggit::benchmark::keep (nearest_sum);
+
+  noggit::benchmark::report ("every triangle", brute_force, brute_force);
+  noggit::benchmark::report ("bvh, every hit", all_hits, brute_force);
+  noggit::benchmark::report ("bvh, nearest hit", nearest, brute_force);
+
+  if (brute_force_hits != bvh_hits)
+  {
+    std::printf ("mismatch: %zu hits testing every triangle, %zu through the bvh\n", brute_force_hits, bvh_hits);
+    return 1;
+  }
+}
@@ -0,0 +1,141 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#define BOOST_TEST_MODULE mpq
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/AsyncLoader.h>
+#include <noggit/MPQ.h>
+
+#include "temporary_archives.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using noggit::test::content;
+using noggit::test::finish_loading_concurrently;
+
+BOOST_AUTO_TEST_CASE (archives_loaded_concurrently_are_all_found)
+{
+  noggit::test::temporary_archives archives;
+
+  std::string const base
+    (archives.create ("base.mpq", true, {{"base\\a.txt", "a"}, {"shared.txt", "base"}}));
+  std::string const patch
+    (archives.create ("patch.mpq", true, {{"patch\\b.txt", "b"}, {"shared.txt", "patch"}}));
+
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), base, true);
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), patch, true);
+  finish_loading_concurrently();
+
+  BOOST_CHECK_EQUAL (content ("base/a.txt"), "a");
+  BOOST_CHECK_EQUAL (content ("patch/b.txt"), "b");
+  BOOST_CHECK_EQUAL (content ("shared.txt"), "patch");
+}
+
+BOOST_AUTO_TEST_CASE (loading_another_archive_keeps_the_files_already_loaded)
+{
+  noggit::test::temporary_archives archives;
+
+  std::string const base (archives.create ("base.mpq", true, {{"base\\a.txt", "a"}}));
+  std::string const patch (archives.create ("patch.mpq", true, {{"patch\\b.txt", "b"}}));
+
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), base, true);
+  finish_loading_concurrently();
+  BOOST_CHECK_EQUAL (content ("base/a.txt"), "a");
+
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), patch, true);
+  finish_loading_concurrently();
+
+  BOOST_CHECK_EQUAL (content ("base/a.txt"), "a");
+  BOOST_CHECK_EQUAL (content ("patch/b.txt"), "b");
+}
+
+BOOST_AUTO_TEST_CASE (files_missing_from_listfiles_are_still_found)
+{
+  noggit::test::temporary_archives archives;
+
+  std::string const base
+    (archives.create ("base.mpq", true, {{"base\\a.txt", "a"}, {"shared.txt", "base"}}));
+  std::string const patch
+    (archives.create ("patch.mpq", false, {{"patch\\b.txt", "b"}, {"shared.txt", "patch"}}));
+
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), base, true);
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), patch, true);
+  finish_loading_concurrently();
+
+  BOOST_CHECK (MPQFile::exists ("patch/b.txt"));
+  BOOST_CHECK_EQUAL (content ("patch/b.txt"), "b");
+  // the patch has no listfile but still has a higher priority than the base archive
+  BOOST_CHECK_EQUAL (content ("shared.txt"), "patch");
+
+  BOOST_CHECK (!MPQFile::exists ("missing.txt"));
+  BOOST_CHECK_THROW (MPQFile ("missing.txt"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE (loose_project_files_are_listed_once)
+{
+  noggit::test::temporary_archives archives;
+
+  std::string const base (archives.create ("base.mpq", true, {{"world\\a.txt", "archive"}}));
+  MPQArchive::loadMPQ (&AsyncLoader::instance(), base, true);
+  finish_loading_concurrently();
+
+  BOOST_CHECK (!MPQFile::existsOnDisk ("world/a.txt"));
+
+  // written behind the listing's back, so only seen once announced
+  boost::filesystem::path const on_disk (archives.path / "project" / "world" / "a.txt");
+  boost::filesystem::create_directories (on_disk.parent_path());
+  std::ofstream (on_disk.string()) << "loose";
+
+  BOOST_CHECK_EQUAL (content ("world/a.txt"), "archive");
+
+  MPQFile::project_file_created ("World\\A.txt");
+  BOOST_CHECK (MPQFile::existsOnDisk ("world/a.txt"));
+  BOOST_CHECK_EQUAL (content ("world/a.txt"), "loose");
+
+  boost::filesystem::remove (on_disk);
+  MPQFile::project_file_removed ("world/a.txt");
+  BOOST_CHECK (!MPQFile::existsOnDisk ("world/a.txt"));
+  BOOST_CHECK_EQUAL (content ("world/a.txt"), "archive");
+
+  std::ofstream (on_disk.string()) << "loose";
+  MPQFile::reload_project_files();
+  BOOST_CHECK (MPQFile::existsOnDisk ("WORLD\\A.TXT"));
+}
+
+BOOST_AUTO_TEST_CASE (saving_reports_whether_the_file_was_written)
+{
+  noggit::test::temporary_archives archives;
+
+  // files are only saved over an existing one, as tiles are
+  boost::filesystem::path const on_disk (archives.path / "project" / "world" / "saved.txt");
+  boost::filesystem::create_directories (on_disk.parent_path());
+  std::ofstream (on_disk.string()) << "old";
+
+  {
+    MPQFile file ("world\\saved.txt");
+    file.setBuffer (std::vector<char> {'n', 'e', 'w'});
+    BOOST_CHECK (file.SaveFile());
+  }
+  BOOST_CHECK_EQUAL (content ("world\\saved.txt"), "new");
+
+  // a directory in the way can't be replaced by the file
+  MPQFile file ("world\\saved.txt");
+  boost::filesystem::remove (on_disk);
+  boost::filesystem::create_directories (on_disk / "in the way");
+
+  file.setBuffer (std::vector<char> {'l', 'o', 's', 't'});
+  BOOST_CHECK (!file.SaveFile());
+  BOOST_CHECK (boost::filesystem::is_directory (on_disk));
+
+  // and nothing written aside is left behind
+  BOOST_CHECK_EQUAL
+    ( std::distance ( boost::filesystem::directory_iterator (on_disk.parent_path())
+                    , boost::filesystem::directory_iterator()
+                    )
+    , 1
+    );
+}
@@ -0,0 +1,127 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#define BOOST_TEST_MODULE object_selection
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/object_selection.hpp>
+
+#include <boost/variant.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace glm
+{
+  std::ostream& operator<< (std::ostream& os, vec3 const& v)
+  {
+    return os << '(' << v.x << ", " << v.y << ", " << v.z << ')';
+  }
+}
+
+namespace
+{
+  struct object
+  {
+    std::uint32_t uid;
+    glm::vec3 pos;
+  };
+
+  struct chunk
+  {
+    int index;
+
+    bool operator== (chunk const& other) const { return index == other.index; }
+  };
+
+  using entry = boost::variant<object*, chunk>;
+
+  struct object_of
+  {
+    object* operator() (entry const& e) const
+    {
+      auto const o (boost::get<object*> (&e));
+      return o ? *o : nullptr;
+    }
+  };
+
+  using selection = noggit::object_selection<entry, object_of>;
+
+  struct three_objects
+  {
+    object a {1, {0.f, 0.f, 0.f}};
+    object b {2, {3.f, 0.f, 0.f}};
+    object c {3, {0.f, 6.f, 0.f}};
+    selection selected;
+  };
+}
+
+BOOST_FIXTURE_TEST_CASE (pivot_is_the_average_of_the_selected_objects, three_objects)
+{
+  selected.add (std::vector<entry> {&a, &b, chunk {0}, &c});
+
+  BOOST_CHECK_EQUAL (selected.object_count(), 3);
+  BOOST_CHECK_EQUAL (selected.entries().size(), 4u);
+  BOOST_REQUIRE (selected.pivot());
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (1.f, 2.f, 0.f));
+
+  selected.remove (entry (chunk {0}));
+  BOOST_CHECK_EQUAL (selected.entries().size(), 3u);
+
+  selected.remove (std::vector<std::uint32_t> {c.uid});
+  BOOST_REQUIRE (selected.pivot());
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (1.5f, 0.f, 0.f));
+
+  selected.remove (std::vector<std::uint32_t> {b.uid});
+  BOOST_CHECK (!selected.pivot());
+  BOOST_CHECK_EQUAL (selected.object_count(), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE (selecting_twice_counts_once, three_objects)
+{
+  selected.add (&a);
+  selected.add (&b);
+  selected.add (&a);
+
+  BOOST_CHECK_EQUAL (selected.object_count(), 2);
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (1.5f, 0.f, 0.f));
+}
+
+// select, move, undo, deselect: undoing writes the positions back behind
+// the selection's back, the pivot must not keep the moved positions
+BOOST_FIXTURE_TEST_CASE (pivot_follows_undone_moves, three_objects)
+{
+  selected.add (std::vector<entry> {&a, &b, &c});
+
+  // moving goes through World, which updates the pivot
+  a.pos += glm::vec3 (30.f, 0.f, 0.f);
+  selected.update_pivot();
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (11.f, 2.f, 0.f));
+
+  // undo restores the position, then updates the pivot
+  a.pos = glm::vec3 (0.f, 0.f, 0.f);
+  selected.update_pivot();
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (1.f, 2.f, 0.f));
+
+  selected.remove (std::vector<std::uint32_t> {c.uid});
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (1.5f, 0.f, 0.f));
+}
+
+BOOST_FIXTURE_TEST_CASE (deselecting_uses_the_current_positions, three_objects)
+{
+  selected.add (std::vector<entry> {&a, &b, &c});
+
+  // moved by something which doesn't update the pivot
+  a.pos = glm::vec3 (30.f, 0.f, 0.f);
+  b.pos = glm::vec3 (0.f, 0.f, 9.f);
+
+  selected.remove (std::vector<std::uint32_t> {c.uid});
+  BOOST_REQUIRE (selected.pivot());
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (15.f, 0.f, 4.5f));
+
+  selected.clear();
+  selected.add (&a);
+  selected.add (&c);
+  BOOST_CHECK_EQUAL (*selected.pivot(), glm::vec3 (15.f, 3.f, 0.f));
+}
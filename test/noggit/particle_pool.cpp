@@ -0,0 +1,173 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#define BOOST_TEST_MODULE particle_pool
+#include <boost/test/unit_test.hpp>
+
+#include <noggit/particle_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+  //! a particle whose every field is derived from id
+  Particle particle (int id)
+  {
+    float const f (static_cast<float> (id));
+
+    Particle p;
+    p.pos = glm::vec3 (f, 0.f, 0.f);
+    p.speed = glm::vec3 (0.f, f, 0.f);
+    p.down = glm::vec3 (0.f, 0.f, f);
+    p.origin = glm::vec3 (f, f, 0.f);
+    p.dir = glm::vec3 (0.f, f, f);
+    for (int c (0); c < 4; ++c)
+    {
+      p.corners[c] = glm::vec3 (f, static_cast<float> (c), 0.f);
+    }
+    p.size = f;
+    p.life = f;
+    p.maxlife = f + 1.f;
+    p.tile = static_cast<unsigned int> (id);
+    p.color = glm::vec4 (f);
+    return p;
+  }
+
+  //! the ids in the pool, after checking every field of each particle
+  //! still belongs to the same one
+  std::vector<int> ids (ParticlePool const& pool)
+  {
+    std::size_t const count (pool.count());
+    BOOST_REQUIRE_EQUAL (pool.speed.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.down.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.origin.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.dir.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.corners.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.size.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.life.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.maxlife.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.tile.size(), count);
+    BOOST_REQUIRE_EQUAL (pool.color.size(), count);
+
+    std::vector<int> result;
+    for (std::size_t i (0); i < count; ++i)
+    {
+      Particle const expected (particle (static_cast<int> (pool.tile[i])));
+
+      BOOST_CHECK (pool.pos[i] == expected.pos);
+      BOOST_CHECK (pool.speed[i] == expected.speed);
+      BOOST_CHECK (pool.down[i] == expected.down);
+      BOOST_CHECK (pool.origin[i] == expected.origin);
+      BOOST_CHECK (pool.dir[i] == expected.dir);
+      for (int c (0); c < 4; ++c)
+      {
+        BOOST_CHECK (pool.corners[i][c] == expected.corners[c]);
+      }
+      BOOST_CHECK_EQUAL (pool.size[i], expected.size);
+      BOOST_CHECK_EQUAL (pool.life[i], expected.life);
+      BOOST_CHECK_EQUAL (pool.maxlife[i], expected.maxlife);
+      BOOST_CHECK (pool.color[i] == expected.color);
+
+      result.push_back (static_cast<int> (pool.tile[i]));
+    }
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_CASE (pushed_particles_keep_their_fields_together)
+{
+  ParticlePool pool;
+  BOOST_CHECK (pool.empty());
+
+  for (int id (0); id < 5; ++id)
+  {
+    pool.push_back (particle (id));
+  }
+
+  BOOST_CHECK (!pool.empty());
+  std::vector<int> const expected {0, 1, 2, 3, 4};
+  auto const found (ids (pool));
+  BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE (removing_a_particle_moves_the_last_one_in_its_place)
+{
+  ParticlePool pool;
+  for (int id (0); id < 5; ++id)
+  {
+    pool.push_back (particle (id));
+  }
+
+  pool.swap_remove (1);
+  {
+    std::vector<int> const expected {0, 4, 2, 3};
+    auto const found (ids (pool));
+    BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), expected.begin(), expected.end());
+  }
+
+  // the last one just goes away
+  pool.swap_remove (3);
+  {
+    std::vector<int> const expected {0, 4, 2};
+    auto const found (ids (pool));
+    BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE (update_moves_ages_and_kills_off_particles)
+{
+  ParticlePool pool;
+  for (int id (0); id < 10; ++id)
+  {
+    Particle p (particle (id));
+    p.pos = glm::vec3 (0.f);
+    p.speed = glm::vec3 (1.f, 0.f, 0.f);
+    p.life = 0.1f * static_cast<float> (id);
+    p.maxlife = 1.f;
+    pool.push_back (p);
+  }
+
+  std::array<float, 3> const sizes {1.f, 2.f, 3.f};
+  std::array<glm::vec4, 3> const colors {glm::vec4 (0.f), glm::vec4 (0.5f), glm::vec4 (1.f)};
+
+  // no gravity, deacceleration or slowdown: particles keep their speed
+  pool.update (0.35f, 0.f, 0.f, 0.f, 0.5f, sizes, colors);
+
+  // the ones aged past their lifespan are gone, each survivor once
+  std::vector<int> found (pool.tile.begin(), pool.tile.end());
+  std::sort (found.begin(), found.end());
+  std::vector<int> const alive {0, 1, 2, 3, 4, 5, 6};
+  BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), alive.begin(), alive.end());
+
+  BOOST_REQUIRE_EQUAL (pool.speed.size(), alive.size());
+  BOOST_REQUIRE_EQUAL (pool.maxlife.size(), alive.size());
+  BOOST_REQUIRE_EQUAL (pool.corners.size(), alive.size());
+
+  for (std::size_t i (0); i < pool.count(); ++i)
+  {
+    float const life (0.1f * static_cast<float> (pool.tile[i]) + 0.35f);
+
+    BOOST_CHECK_CLOSE (pool.life[i], life, 1e-3f);
+    BOOST_CHECK_CLOSE (pool.pos[i].x, 0.35f, 1e-3f);
+    BOOST_CHECK (pool.speed[i] == glm::vec3 (1.f, 0.f, 0.f));
+
+    // mid life at half the lifespan
+    float const expected_size (life <= 0.5f ? 1.f + life / 0.5f : 2.f + (life - 0.5f) / 0.5f);
+    BOOST_CHECK_CLOSE (pool.size[i], expected_size, 1e-3f);
+    BOOST_CHECK_CLOSE (pool.color[i].r, (expected_size - 1.f) / 2.f, 1e-3f);
+
+    // the fields the update does not touch still belong to the particle
+    Particle const expected (particle (static_cast<int> (pool.tile[i])));
+    BOOST_CHECK (pool.down[i] == expected.down);
+    BOOST_CHECK (pool.origin[i] == expected.origin);
+    BOOST_CHECK (pool.dir[i] == expected.dir);
+    BOOST_CHECK (pool.corners[i][0] == expected.corners[0]);
+  }
+
+  // all of them die eventually
+  pool.update (1.f, 0.f, 0.f, 0.f, 0.5f, sizes, colors);
+  BOOST_CHECK (pool.empty());
+  BOOST_CHECK (ids (pool).empty());
+}
@@ -0,0 +1,117 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/AsyncLoader.h>
+#include <noggit/MPQ.h>
+
+#include <boost/filesystem.hpp>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QSettings>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace noggit
+{
+  namespace test
+  {
+    using archive_content = std::vector<std::pair<std::string, std::string>>;
+
+    //! a temporary directory to create archives in, with an empty project
+    //! configured so nothing is read from disk instead of the archives.
+    //! unloads every archive and removes the directory when destroyed.
+    struct temporary_archives
+    {
+      temporary_archives()
+        : path ( boost::filesystem::temp_directory_path()
+               / boost::filesystem::unique_path ("noggit-mpq-%%%%-%%%%")
+               )
+      {
+        boost::filesystem::create_directories (path / "project");
+
+        QCoreApplication::setOrganizationName ("noggit-test");
+        QCoreApplication::setApplicationName ("mpq");
+        QSettings::setDefaultFormat (QSettings::IniFormat);
+        QSettings::setPath ( QSettings::IniFormat, QSettings::UserScope
+                           , QString::fromStdString ((path / "settings").string())
+                           );
+        QSettings().setValue ("project/path", QString::fromStdString ((path / "project").string()));
+        MPQFile::reload_project_files();
+      }
+
+      ~temporary_archives()
+      {
+        MPQArchive::unloadAllMPQs();
+
+        boost::system::error_code ec;
+        boost::filesystem::remove_all (path, ec);
+      }
+
+      //! files are zlib compressed so reading them goes through StormLib
+      std::string create (std::string const& name, bool listfile, archive_content const& files)
+      {
+        std::string const filename ((path / name).string());
+
+        HANDLE archive;
+        if (!SFileCreateArchive ( filename.c_str()
+                                , MPQ_CREATE_ARCHIVE_V1 | (listfile ? MPQ_CREATE_LISTFILE : 0)
+                                , static_cast<DWORD> (files.size() + 16)
+                                , &archive
+                                )
+           )
+        {
+          throw std::runtime_error ("could not create " + filename);
+        }
+
+        for (auto const& file : files)
+        {
+          HANDLE handle;
+          if ( !SFileCreateFile ( archive, file.first.c_str(), 0, static_cast<DWORD> (file.second.size())
+                                , 0, MPQ_FILE_COMPRESS | MPQ_FILE_REPLACEEXISTING, &handle
+                                )
+            || !SFileWriteFile ( handle, file.second.data(), static_cast<DWORD> (file.second.size())
+                               , MPQ_COMPRESSION_ZLIB
+                               )
+            || !SFileFinishFile (handle)
+             )
+          {
+            SFileCloseArchive (archive);
+            throw std::runtime_error ("could not add " + file.first + " to " + filename);
+          }
+        }
+
+        SFileCloseArchive (archive);
+
+        return filename;
+      }
+
+      boost::filesystem::path path;
+    };
+
+    //! finishes the loading archives from this and another thread while
+    //! the loader does as well, then waits for all of them
+    inline void finish_loading_concurrently()
+    {
+      std::thread other (&MPQArchive::allFinishLoading);
+      MPQArchive::allFinishLoading();
+      other.join();
+
+      while (!MPQArchive::allFinishedLoading())
+      {
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+      }
+    }
+
+    inline std::string content (std::string const& filename)
+    {
+      MPQFile file (filename);
+      return {file.getBuffer(), file.getSize()};
+    }
+  }
+}